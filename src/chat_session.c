@@ -29,6 +29,7 @@
 
 #include "config/preferences.h"
 #include "log.h"
+#include "tools/pool.h"
 
 #define PAUSED_TIMOUT 10.0
 #define INACTIVE_TIMOUT 30.0
@@ -57,10 +58,13 @@ static GHashTable *sessions;
 
 static void _chat_session_free(ChatSession session);
 
+// sessions come and go with every conversation, so reuse their memory
+static Pool session_pool = NULL;
+
 void
 chat_sessions_init(void)
 {
-    sessions = g_hash_table_new_full(g_str_hash, g_str_equal, g_free,
+    sessions = g_hash_table_new_full(g_str_hash, g_str_equal, NULL,
         (GDestroyNotify)_chat_session_free);
 }
 
@@ -74,13 +78,16 @@ chat_sessions_clear(void)
 void
 chat_session_start(const char * const recipient, gboolean recipient_supports)
 {
-    ChatSession new_session = malloc(sizeof(struct chat_session_t));
+    if (session_pool == NULL) {
+        session_pool = pool_new(sizeof(struct chat_session_t));
+    }
+    ChatSession new_session = pool_alloc(session_pool);
     new_session->recipient = strdup(recipient);
     new_session->recipient_supports = recipient_supports;
     new_session->state = CHAT_STATE_STARTED;
     new_session->active_timer = g_timer_new();
     new_session->sent = FALSE;
-    g_hash_table_insert(sessions, strdup(recipient), new_session);
+    g_hash_table_replace(sessions, new_session->recipient, new_session);
 }
 
 gboolean
@@ -271,6 +278,6 @@ _chat_session_free(ChatSession session)
             g_timer_destroy(session->active_timer);
             session->active_timer = NULL;
         }
-        free(session);
+        pool_free(session_pool, session);
     }
 }
@@ -39,6 +39,7 @@
 #include "log.h"
 #include "muc.h"
 #include "profanity.h"
+#include "room_list.h"
 #include "tools/autocomplete.h"
 #include "tools/parser.h"
 #include "tools/tinyurl.h"
@@ -87,12 +88,17 @@ static char * _group_autocomplete(char *input, int *size);
 static char * _bookmark_autocomplete(char *input, int *size);
 
 static int _strtoi(char *str, int *saveptr, int min, int max);
+static gboolean _is_pattern(const char * const str);
+static char * _unescape_pattern(char *str);
+static void _show_occupants(const char * const description, GList *nicks);
+static void _rooms_show_page(gint page);
 
 // command prototypes
 static gboolean _cmd_about(gchar **args, struct cmd_help_t help);
 static gboolean _cmd_account(gchar **args, struct cmd_help_t help);
 static gboolean _cmd_autoaway(gchar **args, struct cmd_help_t help);
 static gboolean _cmd_autoping(gchar **args, struct cmd_help_t help);
+static gboolean _cmd_autojoin(gchar **args, struct cmd_help_t help);
 static gboolean _cmd_away(gchar **args, struct cmd_help_t help);
 static gboolean _cmd_beep(gchar **args, struct cmd_help_t help);
 static gboolean _cmd_caps(gchar **args, struct cmd_help_t help);
@@ -122,6 +128,10 @@ static gboolean _cmd_log(gchar **args, struct cmd_help_t help);
 static gboolean _cmd_mouse(gchar **args, struct cmd_help_t help);
 static gboolean _cmd_msg(gchar **args, struct cmd_help_t help);
 static gboolean _cmd_nick(gchar **args, struct cmd_help_t help);
+static gboolean _cmd_highlight(gchar **args, struct cmd_help_t help);
+static gboolean _cmd_digest(gchar **args, struct cmd_help_t help);
+static gboolean _cmd_occupants(gchar **args, struct cmd_help_t help);
+static gboolean _cmd_lurk(gchar **args, struct cmd_help_t help);
 static gboolean _cmd_notify(gchar **args, struct cmd_help_t help);
 static gboolean _cmd_online(gchar **args, struct cmd_help_t help);
 static gboolean _cmd_outtype(gchar **args, struct cmd_help_t help);
@@ -223,6 +233,8 @@ static struct cmd_t command_defs[] =
           "Passing no arguments lists all contacts in your roster.",
           "The 'add' command will add a new item, the jid is required, the handle is an optional nickname",
           "The 'remove' command removes a contact, the jid is required.",
+          "The jid for 'remove' may be a pattern using * and ?, to remove all matching contacts,",
+          "prefix it with \\ to remove a single contact whose jid or nickname contains * or ?.",
           "The 'nick' command changes a contacts nickname, the jid is required,",
           "if no handle is supplied, the current one is removed.",
           "",
@@ -230,6 +242,7 @@ static struct cmd_t command_defs[] =
           "Example : /roster add someone@contacts.org (add the contact)",
           "Example : /roster add someone@contacts.org Buddy (add the contact with nickname 'Buddy')",
           "Example : /roster remove someone@contacts.org (remove the contact)",
+          "Example : /roster remove *@oldserver.org (remove all contacts on a server)",
           "Example : /roster nick myfriend@chat.org My Friend",
           "Example : /roster nick kai@server.com (clears handle)",
           NULL } } },
@@ -244,12 +257,16 @@ static struct cmd_t command_defs[] =
           "The 'show' command takes 'group' as an argument, and lists all roster items in that group.",
           "The 'add' command takes 'group' and 'contact' arguments, and adds the contact to the group.",
           "The 'remove' command takes 'group' and 'contact' arguments and removes the contact from the group,",
+          "For 'add' and 'remove' the contact may be a pattern using * and ?, matching jids and nicknames,",
+          "prefix the contact with \\ to use a nickname containing * or ? literally.",
           "",
           "Example : /group",
           "Example : /group show friends",
           "Example : /group add friends newfriend@server.org",
           "Example : /group add family Brother (using contacts nickname)",
           "Example : /group remove colleagues boss@work.com",
+          "Example : /group add colleagues *@work.com",
+          "Example : /group add friends \\Star* (contact with nickname 'Star*')",
           NULL } } },
 
     { "/info",
@@ -359,15 +376,23 @@ static struct cmd_t command_defs[] =
           NULL } } },
 
     { "/rooms",
-        _cmd_rooms, parse_args, 0, 1, NULL,
-        { "/rooms [conference-service]", "List chat rooms.",
-        { "/rooms [conference-service]",
-          "---------------------------",
-          "List the chat rooms available at the specified conference service",
-          "If no argument is supplied, the account preference 'muc.service' is used, which is 'conference.<domain-part>' by default.",
+        _cmd_rooms, parse_args, 0, 3, NULL,
+        { "/rooms [refresh|search text|next|prev] [conference-service]", "List chat rooms.",
+        { "/rooms [refresh|search text|next|prev] [conference-service]",
+          "-----------------------------------------------------------",
+          "List the chat rooms available at the specified conference service in the room list window.",
+          "If no conference service is supplied, the account preference 'muc.service' is used, which is 'conference.<domain-part>' by default.",
+          "Large listings are fetched a page at a time, and kept on disk for a day,",
+          "after which they are fetched again. Rooms are shown 100 at a time.",
+          "refresh     : Fetch the listing again, even if one is kept.",
+          "search text : Show only the rooms whose address or name contains the text.",
+          "next        : Show the next page of the rooms listed.",
+          "prev        : Show the previous page of the rooms listed.",
           "",
           "Example : /rooms conference.jabber.org",
           "Example : /rooms (if logged in as me@server.org, is equivalent to /rooms conference.server.org)",
+          "Example : /rooms refresh",
+          "Example : /rooms search linux conference.jabber.org",
           NULL } } },
 
     { "/bookmark",
@@ -409,6 +434,35 @@ static struct cmd_t command_defs[] =
           "Example : /nick bob",
           NULL } } },
 
+    { "/highlight",
+        _cmd_highlight, parse_args_with_freetext, 0, 2, NULL,
+        { "/highlight [add|remove] [word]", "Highlight words in chat rooms.",
+        { "/highlight [add|remove] [word]",
+          "------------------------------",
+          "Manage the words highlighted in chat room messages.",
+          "Your nickname is always highlighted, messages containing any highlighted",
+          "word count as mentions, see /notify mention.",
+          "Matching ignores case. With no arguments, the current words are listed.",
+          "",
+          "Example : /highlight add profanity",
+          "Example : /highlight remove profanity",
+          NULL } } },
+
+    { "/digest",
+        _cmd_digest, parse_args, 1, 2, NULL,
+        { "/digest on|off|interval [seconds]", "Summarise busy chat rooms.",
+        { "/digest on|off|interval [seconds]",
+          "---------------------------------",
+          "Switch digest mode on or off for the current chat room.",
+          "While a room in digest mode is not focused, its messages are logged but",
+          "not shown. Instead a summary of who spoke and the last few messages is",
+          "shown at each interval. The full stream is shown while the room is focused.",
+          "interval : How often summaries are shown, in seconds, for all rooms.",
+          "",
+          "Example : /digest on",
+          "Example : /digest interval 300",
+          NULL } } },
+
     { "/win",
         _cmd_win, parse_args, 1, 1, NULL,
         { "/win num", "View a window.",
@@ -487,6 +541,32 @@ static struct cmd_t command_defs[] =
           "any         : Contacts with any status (same as calling with no argument.",
           NULL } } },
 
+    { "/occupants",
+        _cmd_occupants, parse_args, 0, 2, NULL,
+        { "/occupants [role|affiliation|jid barejid]", "Show chat room occupants by role.",
+        { "/occupants [role|affiliation|jid barejid]",
+          "-----------------------------------------",
+          "Show the occupants of the current chat room with a role or affiliation,",
+          "no argument shows the occupants grouped by role.",
+          "Roles are: moderators, participants, visitors.",
+          "Affiliations are: owners, admins, members.",
+          "jid barejid : Show the rooms and nicks the user is in, where the rooms reveal their jid.",
+          "",
+          "Example : /occupants moderators",
+          "Example : /occupants jid someone@server.org",
+          NULL } } },
+
+    { "/lurk",
+        _cmd_lurk, parse_args, 1, 1, NULL,
+        { "/lurk on|off", "Keep only a count of chat room occupants.",
+        { "/lurk on|off",
+          "------------",
+          "Switch lurk mode on or off for the current chat room, for very large rooms.",
+          "While lurking, occupants are only counted and their presence changes are",
+          "not shown. Only the most recent speakers are offered for nick completion.",
+          "Switching lurk mode off takes full effect after rejoining the room.",
+          NULL } } },
+
     { "/close",
         _cmd_close, parse_args, 0, 1, NULL,
         { "/close [win|read|all]", "Close windows.",
@@ -543,6 +623,8 @@ static struct cmd_t command_defs[] =
           "        : on|off",
           "sub     : Notifications for subscription requests.",
           "        : on|off",
+          "mention : Notifications for chat room messages mentioning you.",
+          "        : on|off",
           "",
           "Example : /notify message on (enable message notifications)",
           "Example : /notify remind 10  (remind every 10 seconds)",
@@ -658,12 +740,18 @@ static struct cmd_t command_defs[] =
           NULL } } },
 
     { "/history",
-        _cmd_history, parse_args, 1, 1, cons_history_setting,
-        { "/history on|off", "Chat history in message windows.",
-        { "/history on|off",
-          "---------------",
+        _cmd_history, parse_args, 1, 2, cons_history_setting,
+        { "/history on|off|inputsize [value]", "Chat history in message windows, and input history size.",
+        { "/history on|off|inputsize [value]",
+          "---------------------------------",
           "Switch chat history on or off, /chlog will automatically be enabled when this setting is on.",
           "When history is enabled, previous messages are shown in chat windows.",
+          "inputsize : The number of lines of input history kept, default 100000.",
+          "            Takes effect on the next start, when the input history file",
+          "            is also trimmed to this many lines.",
+          "",
+          "Example : /history on",
+          "Example : /history inputsize 5000",
           NULL } } },
 
     { "/log",
@@ -693,6 +781,16 @@ static struct cmd_t command_defs[] =
           "A value of 0 will switch off autopinging the server.",
           NULL } } },
 
+    { "/autojoin",
+        _cmd_autojoin, parse_args, 1, 1, cons_autojoin_setting,
+        { "/autojoin rooms", "Bookmarked rooms joined at once.",
+        { "/autojoin rooms",
+          "---------------",
+          "Set how many autojoin bookmarks are joined at the same time after connecting.",
+          "Further rooms are joined as earlier joins complete, rooms you have recently",
+          "sent messages to are joined first.",
+          NULL } } },
+
     { "/autoaway",
         _cmd_autoaway, parse_args_with_freetext, 2, 2, cons_autoaway_setting,
         { "/autoaway setting value", "Set auto idle/away properties.",
@@ -874,11 +972,18 @@ static Autocomplete theme_load_ac;
 static Autocomplete account_ac;
 static Autocomplete disco_ac;
 static Autocomplete close_ac;
+static Autocomplete occupants_ac;
+static Autocomplete rooms_ac;
 static Autocomplete wins_ac;
 static Autocomplete roster_ac;
 static Autocomplete group_ac;
 static Autocomplete bookmark_ac;
 
+// the listing shown in the room list window, for /rooms next and prev
+static char *rooms_service = NULL;
+static char *rooms_search = NULL;
+static gint rooms_page = 0;
+
 /*
  * Initialise command autocompleter and history
  */
@@ -929,6 +1034,7 @@ cmd_init(void)
     autocomplete_add(notify_ac, "remind");
     autocomplete_add(notify_ac, "invite");
     autocomplete_add(notify_ac, "sub");
+    autocomplete_add(notify_ac, "mention");
 
     sub_ac = autocomplete_new();
     autocomplete_add(sub_ac, "request");
@@ -976,6 +1082,21 @@ cmd_init(void)
     autocomplete_add(close_ac, "read");
     autocomplete_add(close_ac, "all");
 
+    occupants_ac = autocomplete_new();
+    autocomplete_add(occupants_ac, "moderators");
+    autocomplete_add(occupants_ac, "participants");
+    autocomplete_add(occupants_ac, "visitors");
+    autocomplete_add(occupants_ac, "owners");
+    autocomplete_add(occupants_ac, "admins");
+    autocomplete_add(occupants_ac, "members");
+    autocomplete_add(occupants_ac, "jid");
+
+    rooms_ac = autocomplete_new();
+    autocomplete_add(rooms_ac, "refresh");
+    autocomplete_add(rooms_ac, "search");
+    autocomplete_add(rooms_ac, "next");
+    autocomplete_add(rooms_ac, "prev");
+
     wins_ac = autocomplete_new();
     autocomplete_add(wins_ac, "prune");
     autocomplete_add(wins_ac, "tidy");
@@ -1031,10 +1152,15 @@ cmd_close(void)
     autocomplete_free(account_ac);
     autocomplete_free(disco_ac);
     autocomplete_free(close_ac);
+    autocomplete_free(occupants_ac);
+    autocomplete_free(rooms_ac);
+    FREE_SET_NULL(rooms_service);
+    FREE_SET_NULL(rooms_search);
     autocomplete_free(wins_ac);
     autocomplete_free(roster_ac);
     autocomplete_free(group_ac);
     autocomplete_free(bookmark_ac);
+    cmd_history_close();
 }
 
 // Command autocompletion functions
@@ -1101,6 +1227,8 @@ cmd_reset_autocomplete()
     autocomplete_reset(account_ac);
     autocomplete_reset(disco_ac);
     autocomplete_reset(close_ac);
+    autocomplete_reset(occupants_ac);
+    autocomplete_reset(rooms_ac);
     autocomplete_reset(wins_ac);
     autocomplete_reset(roster_ac);
     autocomplete_reset(group_ac);
@@ -1155,6 +1283,8 @@ cmd_execute_default(const char * const inp)
                 ui_current_print_line("You are not currently connected.");
             } else {
                 message_send_groupchat(inp, recipient);
+                // rooms spoken in are joined first on the next autojoin
+                prefs_set_room_active(recipient);
             }
             break;
 
@@ -1300,8 +1430,10 @@ _cmd_complete_parameters(char *input, int *size)
         return;
     }
 
-    gchar *cmds[] = { "/help", "/prefs", "/log", "/disco", "/close", "/wins" };
-    Autocomplete completers[] = { help_ac, prefs_ac, log_ac, disco_ac, close_ac, wins_ac };
+    gchar *cmds[] = { "/help", "/prefs", "/log", "/disco", "/close", "/wins",
+        "/occupants", "/rooms" };
+    Autocomplete completers[] = { help_ac, prefs_ac, log_ac, disco_ac, close_ac, wins_ac,
+        occupants_ac, rooms_ac };
 
     for (i = 0; i < ARRAY_SIZE(cmds); i++) {
         result = autocomplete_param_with_ac(input, size, cmds[i], completers[i]);
@@ -1790,7 +1922,8 @@ _cmd_help(gchar **args, struct cmd_help_t help)
     } else if (strcmp(args[0], "groupchat") == 0) {
         gchar *filter[] = { "/close", "/clear", "/decline", "/grlog",
             "/invite", "/invites", "/join", "/leave", "/notify", "/msg",
-            "/rooms", "/tiny", "/who", "/nick" };
+            "/rooms", "/tiny", "/who", "/nick", "/highlight", "/digest",
+            "/occupants", "/lurk" };
         _cmd_show_filtered_help("Groupchat commands", filter, ARRAY_SIZE(filter));
 
     } else if (strcmp(args[0], "presence") == 0) {
@@ -1808,8 +1941,8 @@ _cmd_help(gchar **args, struct cmd_help_t help)
         _cmd_show_filtered_help("Service discovery commands", filter, ARRAY_SIZE(filter));
 
     } else if (strcmp(args[0], "settings") == 0) {
-        gchar *filter[] = { "/account", "/autoaway", "/autoping", "/beep",
-            "/chlog", "/flash", "/gone", "/grlog", "/history", "/intype",
+        gchar *filter[] = { "/account", "/autoaway", "/autojoin", "/autoping",
+            "/beep", "/chlog", "/flash", "/gone", "/grlog", "/history", "/intype",
             "/log", "/mouse", "/notify", "/outtype", "/prefs", "/priority",
             "/reconnect", "/roster", "/splash", "/states", "/statuses", "/theme",
             "/titlebar", "/vercheck" };
@@ -1962,6 +2095,11 @@ _cmd_who(gchar **args, struct cmd_help_t help)
                 }
 
                 char *room = ui_current_recipient();
+                if (muc_get_lurk(room)) {
+                    ui_room_lurking(room);
+                    return TRUE;
+                }
+
                 GList *list = muc_get_roster(room);
 
                 // no arg, show all contacts
@@ -2043,116 +2181,43 @@ _cmd_who(gchar **args, struct cmd_help_t help)
             } else {
                 cons_show("");
                 GSList *list = NULL;
-                if (group != NULL) {
-                    list = roster_get_group(group);
-                } else {
-                    list = roster_get_contacts();
-                }
 
                 // no arg, show all contacts
                 if ((presence == NULL) || (g_strcmp0(presence, "any") == 0)) {
                     if (group != NULL) {
                         cons_show("%s:", group);
+                        list = roster_get_group(group);
                     } else {
                         cons_show("All contacts:");
+                        list = roster_get_contacts();
                     }
-                    cons_show_contacts(list);
-
-                // available
-                } else if (strcmp("available", presence) == 0) {
-                    if (group != NULL) {
-                        cons_show("%s (%s):", group, presence);
-                    } else {
-                        cons_show("Contacts (%s):", presence);
-                    }
-                    GSList *filtered = NULL;
-
-                    while (list != NULL) {
-                        PContact contact = list->data;
-                        if (p_contact_is_available(contact)) {
-                            filtered = g_slist_append(filtered, contact);
-                        }
-                        list = g_slist_next(list);
-                    }
-
-                    cons_show_contacts(filtered);
-
-                // unavailable
-                } else if (strcmp("unavailable", presence) == 0) {
-                    if (group != NULL) {
-                        cons_show("%s (%s):", group, presence);
-                    } else {
-                        cons_show("Contacts (%s):", presence);
-                    }
-                    GSList *filtered = NULL;
-
-                    while (list != NULL) {
-                        PContact contact = list->data;
-                        if (!p_contact_is_available(contact)) {
-                            filtered = g_slist_append(filtered, contact);
-                        }
-                        list = g_slist_next(list);
-                    }
-
-                    cons_show_contacts(filtered);
-
-                // online, available resources
-                } else if (strcmp("online", presence) == 0) {
-                    if (group != NULL) {
-                        cons_show("%s (%s):", group, presence);
-                    } else {
-                        cons_show("Contacts (%s):", presence);
-                    }
-                    GSList *filtered = NULL;
-
-                    while (list != NULL) {
-                        PContact contact = list->data;
-                        if (p_contact_has_available_resource(contact)) {
-                            filtered = g_slist_append(filtered, contact);
-                        }
-                        list = g_slist_next(list);
-                    }
-
-                    cons_show_contacts(filtered);
-
-                // offline, no available resources
-                } else if (strcmp("offline", presence) == 0) {
-                    if (group != NULL) {
-                        cons_show("%s (%s):", group, presence);
-                    } else {
-                        cons_show("Contacts (%s):", presence);
-                    }
-                    GSList *filtered = NULL;
-
-                    while (list != NULL) {
-                        PContact contact = list->data;
-                        if (!p_contact_has_available_resource(contact)) {
-                            filtered = g_slist_append(filtered, contact);
-                        }
-                        list = g_slist_next(list);
-                    }
-
-                    cons_show_contacts(filtered);
 
-                // show specific status
+                // filter on presence, then on group
                 } else {
                     if (group != NULL) {
                         cons_show("%s (%s):", group, presence);
                     } else {
                         cons_show("Contacts (%s):", presence);
                     }
-                    GSList *filtered = NULL;
 
-                    while (list != NULL) {
-                        PContact contact = list->data;
-                        if (strcmp(p_contact_presence(contact), presence) == 0) {
-                            filtered = g_slist_append(filtered, contact);
+                    list = roster_get_contacts_by_presence(presence);
+                    if (group != NULL) {
+                        GSList *filtered = NULL;
+                        GSList *curr = list;
+                        while (curr != NULL) {
+                            PContact contact = curr->data;
+                            if (p_contact_in_group(contact, group)) {
+                                filtered = g_slist_prepend(filtered, contact);
+                            }
+                            curr = g_slist_next(curr);
                         }
-                        list = g_slist_next(list);
+                        g_slist_free(list);
+                        list = g_slist_reverse(filtered);
                     }
-
-                    cons_show_contacts(filtered);
                 }
+
+                cons_show_contacts(list);
+                g_slist_free(list);
             }
         }
     }
@@ -2289,6 +2354,18 @@ _cmd_group(gchar **args, struct cmd_help_t help)
             return TRUE;
         }
 
+        if (_is_pattern(contact)) {
+            int count = roster_add_to_group_matching(group, contact);
+            if (count == 0) {
+                cons_show("No contacts matching %s to add to group %s", contact,
+                    group);
+            } else {
+                cons_show("Adding %d contacts to group %s...", count, group);
+            }
+            return TRUE;
+        }
+
+        contact = _unescape_pattern(contact);
         char *barejid = roster_barejid_from_name(contact);
         if (barejid == NULL) {
             barejid = contact;
@@ -2315,6 +2392,17 @@ _cmd_group(gchar **args, struct cmd_help_t help)
             return TRUE;
         }
 
+        if (_is_pattern(contact)) {
+            int count = roster_remove_from_group_matching(group, contact);
+            if (count == 0) {
+                cons_show("No contacts matching %s in group %s", contact, group);
+            } else {
+                cons_show("Removing %d contacts from group %s...", count, group);
+            }
+            return TRUE;
+        }
+
+        contact = _unescape_pattern(contact);
         char *barejid = roster_barejid_from_name(contact);
         if (barejid == NULL) {
             barejid = contact;
@@ -2378,7 +2466,23 @@ _cmd_roster(gchar **args, struct cmd_help_t help)
 
         char *jid = args[1];
 
-        roster_remove(jid);
+        if (_is_pattern(jid)) {
+            int count = roster_remove_matching(jid);
+            if (count == 0) {
+                cons_show("No contacts matching %s", jid);
+            } else {
+                cons_show("Removing %d contacts from roster...", count);
+            }
+            return TRUE;
+        }
+
+        jid = _unescape_pattern(jid);
+        char *barejid = roster_barejid_from_name(jid);
+        if (barejid == NULL) {
+            barejid = jid;
+        }
+
+        roster_remove(barejid);
 
         return TRUE;
     }
@@ -2849,16 +2953,109 @@ _cmd_rooms(gchar **args, struct cmd_help_t help)
         return TRUE;
     }
 
-    if (args[0] == NULL) {
+    if ((g_strcmp0(args[0], "next") == 0) || (g_strcmp0(args[0], "prev") == 0)) {
+        if (args[1] != NULL) {
+            cons_show("Usage: %s", help.usage);
+        } else if (rooms_service == NULL) {
+            cons_show("No chat rooms listed, use /rooms to list them.");
+        } else if (g_strcmp0(args[0], "next") == 0) {
+            _rooms_show_page(rooms_page + 1);
+        } else {
+            _rooms_show_page(rooms_page - 1);
+        }
+        return TRUE;
+    }
+
+    gboolean refresh = FALSE;
+    char *search = NULL;
+    char *service_arg = args[0];
+    if (g_strcmp0(args[0], "refresh") == 0) {
+        refresh = TRUE;
+        service_arg = args[1];
+    } else if (g_strcmp0(args[0], "search") == 0) {
+        if (args[1] == NULL) {
+            cons_show("Usage: %s", help.usage);
+            return TRUE;
+        }
+        search = args[1];
+        service_arg = args[2];
+    } else if (args[1] != NULL) {
+        cons_show("Usage: %s", help.usage);
+        return TRUE;
+    }
+
+    char *service = NULL;
+    if (service_arg == NULL) {
         ProfAccount *account = accounts_get_account(jabber_get_account_name());
-        iq_room_list_request(account->muc_service);
+        service = strdup(account->muc_service);
+        accounts_free_account(account);
     } else {
-        iq_room_list_request(args[0]);
+        service = strdup(service_arg);
     }
 
+    // the service also names the file its listing is kept in
+    Jid *service_jid = jid_create(service);
+    if ((service_jid == NULL) || (service_jid->resourcepart != NULL) ||
+            (service[0] == '.')) {
+        cons_show("Invalid conference service: %s", service);
+        jid_destroy(service_jid);
+        free(service);
+        return TRUE;
+    }
+    jid_destroy(service_jid);
+
+    // searches use whatever listing is kept, even if it is out of date
+    gboolean use_kept = FALSE;
+    if (!refresh) {
+        if (search != NULL) {
+            use_kept = (room_list_count(service) > 0);
+        } else {
+            use_kept = room_list_is_fresh(service);
+        }
+    }
+
+    FREE_SET_NULL(rooms_service);
+    FREE_SET_NULL(rooms_search);
+    rooms_service = service;
+    rooms_page = 0;
+
+    if (use_kept) {
+        if (search != NULL) {
+            rooms_search = strdup(search);
+        }
+        _rooms_show_page(0);
+        return TRUE;
+    }
+
+    // the first page is shown when the listing completes
+    if (search != NULL) {
+        cons_show("No room list kept for %s, fetching it, search again when it completes.",
+            service);
+    }
+    room_list_start(service);
+    ui_room_list_start(service);
+    iq_room_list_request(service);
+
     return TRUE;
 }
 
+static void
+_rooms_show_page(gint page)
+{
+    gint total = 0;
+    GList *rooms = room_list_get_page(rooms_service, rooms_search, page,
+        &total);
+
+    if ((rooms == NULL) && (page != 0)) {
+        cons_show("No more chat rooms to show.");
+        return;
+    }
+
+    rooms_page = page;
+    ui_room_list_results(rooms_service, rooms, rooms_search, page, total);
+    g_list_free(rooms);
+}
+
 static gboolean
 _cmd_bookmark(gchar **args, struct cmd_help_t help)
 {
@@ -2971,6 +3168,195 @@ _cmd_nick(gchar **args, struct cmd_help_t help)
     return TRUE;
 }
 
+static gboolean
+_cmd_highlight(gchar **args, struct cmd_help_t help)
+{
+    char *subcmd = args[0];
+
+    if (subcmd == NULL) {
+        GSList *words = prefs_get_highlight_words();
+        if (words == NULL) {
+            cons_show("No highlight words set.");
+        } else {
+            cons_show("Highlight words:");
+            GSList *curr = words;
+            while (curr != NULL) {
+                cons_show("  %s", curr->data);
+                curr = g_slist_next(curr);
+            }
+        }
+        g_slist_free_full(words, free);
+        return TRUE;
+    }
+
+    char *word = args[1];
+    if (word == NULL) {
+        cons_show("Usage: %s", help.usage);
+    } else if (strcmp(subcmd, "add") == 0) {
+        if (prefs_add_highlight_word(word)) {
+            muc_highlights_changed();
+            cons_show("Highlighting \"%s\" in chat rooms.", word);
+        } else {
+            cons_show("Already highlighting \"%s\".", word);
+        }
+    } else if (strcmp(subcmd, "remove") == 0) {
+        if (prefs_remove_highlight_word(word)) {
+            muc_highlights_changed();
+            cons_show("Stopped highlighting \"%s\".", word);
+        } else {
+            cons_show("Not highlighting \"%s\".", word);
+        }
+    } else {
+        cons_show("Usage: %s", help.usage);
+    }
+
+    return TRUE;
+}
+
+static gboolean
+_cmd_digest(gchar **args, struct cmd_help_t help)
+{
+    if (strcmp(args[0], "interval") == 0) {
+        if (args[1] == NULL) {
+            cons_show("Usage: %s", help.usage);
+            return TRUE;
+        }
+        gint interval = atoi(args[1]);
+        if (interval <= 0) {
+            cons_show("Digest interval must be a positive number of seconds.");
+        } else {
+            prefs_set_digest_interval(interval);
+            cons_show("Digest interval set to %d seconds.", interval);
+        }
+        return TRUE;
+    }
+
+    if ((strcmp(args[0], "on") != 0) && (strcmp(args[0], "off") != 0)) {
+        cons_show("Usage: %s", help.usage);
+        return TRUE;
+    }
+
+    if (ui_current_win_type() != WIN_MUC) {
+        cons_show("You can only set digest mode in a chat room window.");
+        return TRUE;
+    }
+
+    char *room = ui_current_recipient();
+    gboolean digest = (strcmp(args[0], "on") == 0);
+    muc_set_digest(room, digest);
+    prefs_set_room_digest(room, digest);
+
+    if (digest) {
+        ui_current_print_line("Digest mode enabled for %s.", room);
+    } else {
+        ui_current_print_line("Digest mode disabled for %s.", room);
+    }
+
+    return TRUE;
+}
+
+static gboolean
+_cmd_occupants(gchar **args, struct cmd_help_t help)
+{
+    jabber_conn_status_t conn_status = jabber_get_connection_status();
+
+    if (conn_status != JABBER_CONNECTED) {
+        cons_show("You are not currently connected.");
+        return TRUE;
+    }
+
+    // search every room for the real jid
+    if ((args[0] != NULL) && (strcmp(args[0], "jid") == 0)) {
+        if (args[1] == NULL) {
+            cons_show("Usage: %s", help.usage);
+            return TRUE;
+        }
+
+        GList *occupants = muc_get_occupants_by_real_jid(args[1]);
+        if (occupants == NULL) {
+            cons_show("%s is not in any chat room that shows real jids.", args[1]);
+        } else {
+            cons_show("%s is in:", args[1]);
+            GList *curr = occupants;
+            while (curr != NULL) {
+                cons_show("  %s", curr->data);
+                curr = g_list_next(curr);
+            }
+        }
+        g_list_free_full(occupants, free);
+        return TRUE;
+    }
+
+    if (ui_current_win_type() != WIN_MUC) {
+        cons_show("You can only list occupants in a chat room window.");
+        return TRUE;
+    }
+
+    char *room = ui_current_recipient();
+    gchar *roles[] = { "moderator", "participant", "visitor" };
+    gchar *affiliations[] = { "owner", "admin", "member" };
+    int i;
+
+    if (args[0] == NULL) {
+        for (i = 0; i < ARRAY_SIZE(roles); i++) {
+            GList *nicks = muc_get_occupants_by_role(room, roles[i]);
+            _show_occupants(roles[i], nicks);
+            g_list_free(nicks);
+        }
+        return TRUE;
+    }
+
+    // accept the plural of a role or affiliation
+    for (i = 0; i < ARRAY_SIZE(roles); i++) {
+        if (g_str_has_prefix(args[0], roles[i])) {
+            GList *nicks = muc_get_occupants_by_role(room, roles[i]);
+            _show_occupants(roles[i], nicks);
+            g_list_free(nicks);
+            return TRUE;
+        }
+    }
+    for (i = 0; i < ARRAY_SIZE(affiliations); i++) {
+        if (g_str_has_prefix(args[0], affiliations[i])) {
+            GList *nicks = muc_get_occupants_by_affiliation(room,
+                affiliations[i]);
+            _show_occupants(affiliations[i], nicks);
+            g_list_free(nicks);
+            return TRUE;
+        }
+    }
+
+    cons_show("Usage: %s", help.usage);
+    return TRUE;
+}
+
+static gboolean
+_cmd_lurk(gchar **args, struct cmd_help_t help)
+{
+    if ((strcmp(args[0], "on") != 0) && (strcmp(args[0], "off") != 0)) {
+        cons_show("Usage: %s", help.usage);
+        return TRUE;
+    }
+
+    if (ui_current_win_type() != WIN_MUC) {
+        cons_show("You can only set lurk mode in a chat room window.");
+        return TRUE;
+    }
+
+    char *room = ui_current_recipient();
+    gboolean lurk = (strcmp(args[0], "on") == 0);
+    muc_set_lurk(room, lurk);
+    prefs_set_room_lurk(room, lurk);
+
+    if (lurk) {
+        ui_current_print_line("Lurking in %s.", room);
+    } else {
+        ui_current_print_line("Stopped lurking in %s, rejoin the room to see all occupants.",
+            room);
+    }
+
+    return TRUE;
+}
+
 static gboolean
 _cmd_tiny(gchar **args, struct cmd_help_t help)
 {
@@ -3008,6 +3394,7 @@ _cmd_tiny(gchar **args, struct cmd_help_t help)
             } else { // groupchat
                 char *recipient = ui_current_recipient();
                 message_send_groupchat(tiny, recipient);
+                prefs_set_room_active(recipient);
             }
             free(tiny);
         } else {
@@ -3195,7 +3582,7 @@ _cmd_notify(gchar **args, struct cmd_help_t help)
     // bad kind
     if ((strcmp(kind, "message") != 0) && (strcmp(kind, "typing") != 0) &&
             (strcmp(kind, "remind") != 0) && (strcmp(kind, "invite") != 0) &&
-            (strcmp(kind, "sub") != 0)) {
+            (strcmp(kind, "sub") != 0) && (strcmp(kind, "mention") != 0)) {
         cons_show("Usage: %s", help.usage);
 
     // set message setting
@@ -3246,6 +3633,18 @@ _cmd_notify(gchar **args, struct cmd_help_t help)
             cons_show("Usage: /notify sub on|off");
         }
 
+    // set mention setting
+    } else if (strcmp(kind, "mention") == 0) {
+        if (strcmp(value, "on") == 0) {
+            cons_show("Chat room mention notifications enabled.");
+            prefs_set_boolean(PREF_NOTIFY_MENTION, TRUE);
+        } else if (strcmp(value, "off") == 0) {
+            cons_show("Chat room mention notifications disabled.");
+            prefs_set_boolean(PREF_NOTIFY_MENTION, FALSE);
+        } else {
+            cons_show("Usage: /notify mention on|off");
+        }
+
     // set remind setting
     } else if (strcmp(kind, "remind") == 0) {
         gint period = atoi(value);
@@ -3306,6 +3705,26 @@ _cmd_reconnect(gchar **args, struct cmd_help_t help)
     return TRUE;
 }
 
+static gboolean
+_cmd_autojoin(gchar **args, struct cmd_help_t help)
+{
+    char *value = args[0];
+    int intval;
+
+    if (_strtoi(value, &intval, 1, INT_MAX) == 0) {
+        prefs_set_autojoin_max(intval);
+        if (intval == 1) {
+            cons_show("Autojoining 1 room at a time.");
+        } else {
+            cons_show("Autojoining %d rooms at a time.", intval);
+        }
+    } else {
+        cons_show("Usage: %s", help.usage);
+    }
+
+    return TRUE;
+}
+
 static gboolean
 _cmd_autoping(gchar **args, struct cmd_help_t help)
 {
@@ -3479,6 +3898,18 @@ _cmd_mouse(gchar **args, struct cmd_help_t help)
 static gboolean
 _cmd_history(gchar **args, struct cmd_help_t help)
 {
+    if (strcmp(args[0], "inputsize") == 0) {
+        int intval;
+        if (args[1] == NULL) {
+            cons_show("Usage: %s", help.usage);
+        } else if (_strtoi(args[1], &intval, PREFS_MIN_INPHIST_SIZE, INT_MAX) == 0) {
+            prefs_set_max_inphist_size(intval);
+            cons_show("Input history size set to %d lines, applied on the next start.",
+                intval);
+        }
+        return TRUE;
+    }
+
     gboolean result = _cmd_set_boolean_preference(args[0], help,
         "Chat history", PREF_HISTORY);
 
@@ -3719,7 +4150,7 @@ _notify_autocomplete(char *input, int *size)
     char *result = NULL;
 
     gchar *boolean_choices[] = { "/notify message", "/notify typing",
-        "/notify invite", "/notify sub" };
+        "/notify invite", "/notify sub", "/notify mention" };
     for (i = 0; i < ARRAY_SIZE(boolean_choices); i++) {
         result = autocomplete_param_with_func(input, size, boolean_choices[i],
             prefs_autocomplete_boolean_choice);
@@ -3847,3 +4278,48 @@ _strtoi(char *str, int *saveptr, int min, int max)
 
     return 0;
 }
+
+// contact arguments containing glob characters apply to all matching contacts
+static gboolean
+_is_pattern(const char * const str)
+{
+    if (str[0] == '\\') {
+        return FALSE;
+    }
+    return (strpbrk(str, "*?") != NULL);
+}
+
+/*
+ * A leading backslash marks an argument as a literal jid or nickname, so that
+ * names containing * or ? can still be addressed individually.
+ */
+static char *
+_unescape_pattern(char *str)
+{
+    if (str[0] == '\\') {
+        return &str[1];
+    }
+    return str;
+}
+
+static void
+_show_occupants(const char * const description, GList *nicks)
+{
+    if (nicks == NULL) {
+        ui_current_print_line("No occupants are %ss.", description);
+        return;
+    }
+
+    GString *line = g_string_new("");
+    g_string_printf(line, "%ss (%d): ", description, g_list_length(nicks));
+    GList *curr = nicks;
+    while (curr != NULL) {
+        g_string_append(line, curr->data);
+        if (g_list_next(curr) != NULL) {
+            g_string_append(line, ", ");
+        }
+        curr = g_list_next(curr);
+    }
+    ui_current_print_line("%s", line->str);
+    g_string_free(line, TRUE);
+}
@@ -48,5 +48,9 @@ GSList * cmd_get_presence_help(void);
 void cmd_history_append(char *inp);
 char *cmd_history_previous(char *inp, int *size);
 char *cmd_history_next(char *inp, int *size);
+void cmd_history_search_start(void);
+char *cmd_history_search(const char * const query);
+char *cmd_history_search_older(void);
+void cmd_history_search_end(void);
 
 #endif
@@ -20,24 +20,123 @@
  *
  */
 
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include <glib.h>
+
+#include "common.h"
+#include "log.h"
+#include "config/preferences.h"
 #include "tools/history.h"
+#include "tools/history_index.h"
 
-#define MAX_HISTORY 100
+// rewrite the history file when it averages more than this per item
+#define COMPACT_BYTES_PER_ITEM 128
 
 static History history;
+static GMappedFile *history_map;
+static FILE *history_fp;
+static HistoryIndex search_index;
 
 void _stringify_input(char *inp, int size, char *string);
+static gchar * _get_history_file(void);
+static GMappedFile * _map_history_file(const char * const filename,
+    guint max_size);
+static HistoryIndex _create_search_index(void);
 
 void
 cmd_history_init(void)
 {
-    history = history_new(MAX_HISTORY);
+    guint max_size = prefs_get_max_inphist_size();
+    history = history_new(max_size);
+    search_index = NULL;
+
+    gchar *filename = _get_history_file();
+
+    history_map = _map_history_file(filename, max_size);
+    if (history_map != NULL) {
+        history_load_lazy(history, g_mapped_file_get_contents(history_map),
+            g_mapped_file_get_length(history_map));
+    }
+
+    history_fp = NULL;
+    int fd = open(filename, O_WRONLY | O_APPEND | O_CREAT, S_IRUSR | S_IWUSR);
+    if (fd != -1) {
+        history_fp = fdopen(fd, "a");
+    }
+    if (history_fp == NULL) {
+        log_error("Could not open input history file %s", filename);
+    }
+
+    g_free(filename);
+}
+
+void
+cmd_history_close(void)
+{
+    if (history_fp != NULL) {
+        fclose(history_fp);
+        history_fp = NULL;
+    }
+    if (history_map != NULL) {
+        g_mapped_file_unref(history_map);
+        history_map = NULL;
+    }
+    history_index_free(search_index);
+    search_index = NULL;
 }
 
 void
 cmd_history_append(char *inp)
 {
     history_append(history, inp);
+
+    if ((history_fp != NULL) && (inp != NULL)) {
+        fprintf(history_fp, "%s\n", inp);
+        fflush(history_fp);
+    }
+
+    if (search_index != NULL) {
+        history_index_update(search_index);
+    }
+}
+
+/*
+ * Start a reverse search, the search index is built over the history on
+ * first use
+ */
+void
+cmd_history_search_start(void)
+{
+    if (search_index == NULL) {
+        search_index = _create_search_index();
+    } else {
+        history_index_reset_search(search_index);
+    }
+}
+
+char *
+cmd_history_search(const char * const query)
+{
+    return history_index_search(search_index, query);
+}
+
+char *
+cmd_history_search_older(void)
+{
+    return history_index_search_older(search_index);
+}
+
+void
+cmd_history_search_end(void)
+{
+    if (search_index != NULL) {
+        history_index_reset_search(search_index);
+    }
 }
 
 char *
@@ -67,3 +166,68 @@ _stringify_input(char *inp, int size, char *string)
     }
     string[size] = '\0';
 }
+
+static gchar *
+_get_history_file(void)
+{
+    gchar *xdg_data = xdg_get_data_home();
+    GString *history_file = g_string_new(xdg_data);
+    g_string_append(history_file, "/profanity/inputhistory");
+    gchar *result = strdup(history_file->str);
+    g_free(xdg_data);
+    g_string_free(history_file, TRUE);
+
+    return result;
+}
+
+static HistoryIndex
+_create_search_index(void)
+{
+    HistoryIndex index = history_index_new(history);
+
+    log_debug("Input history search index created with %d items",
+        history_index_length(index));
+
+    return index;
+}
+
+/*
+ * Map the history file, first dropping all but the last max_size items
+ * if the file has grown too large
+ */
+static GMappedFile *
+_map_history_file(const char * const filename, guint max_size)
+{
+    GMappedFile *map = g_mapped_file_new(filename, FALSE, NULL);
+    if (map == NULL) {
+        return NULL;
+    }
+
+    gsize len = g_mapped_file_get_length(map);
+    if (len <= (gsize)max_size * COMPACT_BYTES_PER_ITEM) {
+        return map;
+    }
+
+    const char *contents = g_mapped_file_get_contents(map);
+    gsize start = len - 1;
+    guint count = 0;
+    while (start > 0) {
+        if ((contents[start - 1] == '\n') && (++count == max_size)) {
+            break;
+        }
+        start--;
+    }
+
+    log_info("Compacting input history file %s", filename);
+    gboolean compacted = g_file_set_contents(filename, &contents[start],
+        len - start, NULL);
+    g_mapped_file_unref(map);
+
+    if (compacted) {
+        chmod(filename, S_IRUSR | S_IWUSR);
+    } else {
+        log_error("Error compacting input history file %s", filename);
+    }
+
+    return g_mapped_file_new(filename, FALSE, NULL);
+}
@@ -24,5 +24,6 @@
 #define COMMAND_HISTORY_H
 
 void cmd_history_init(void);
+void cmd_history_close(void);
 
 #endif
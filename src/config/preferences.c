@@ -47,6 +47,8 @@
 static gchar *prefs_loc;
 static GKeyFile *prefs;
 gint log_maxsize = 0;
+// recent rooms change with every room spoken in, so are saved lazily
+static gboolean recent_rooms_changed = FALSE;
 
 static Autocomplete boolean_choice_ac;
 
@@ -56,6 +58,12 @@ static const char * _get_group(preference_t pref);
 static const char * _get_key(preference_t pref);
 static gboolean _get_default_boolean(preference_t pref);
 static char * _get_default_string(preference_t pref);
+static gboolean _string_list_contains(const char * const group,
+    const char * const key, const char * const value);
+static gboolean _string_list_add(const char * const group,
+    const char * const key, const char * const value);
+static gboolean _string_list_remove(const char * const group,
+    const char * const key, const char * const value);
 
 void
 prefs_load(void)
@@ -84,6 +92,7 @@ prefs_load(void)
 void
 prefs_close(void)
 {
+    prefs_flush();
     autocomplete_free(boolean_choice_ac);
     g_key_file_free(prefs);
 }
@@ -199,6 +208,25 @@ prefs_set_max_log_size(gint value)
     _save_prefs();
 }
 
+gint
+prefs_get_max_inphist_size(void)
+{
+    gint result = g_key_file_get_integer(prefs, PREF_GROUP_UI, "inphist.maxsize", NULL);
+
+    if (result <= 0) {
+        return PREFS_DEFAULT_INPHIST_SIZE;
+    } else {
+        return result;
+    }
+}
+
+void
+prefs_set_max_inphist_size(gint value)
+{
+    g_key_file_set_integer(prefs, PREF_GROUP_UI, "inphist.maxsize", value);
+    _save_prefs();
+}
+
 gint
 prefs_get_priority(void)
 {
@@ -238,6 +266,80 @@ prefs_set_autoping(gint value)
     _save_prefs();
 }
 
+gint
+prefs_get_autojoin_max(void)
+{
+    gint result = g_key_file_get_integer(prefs, PREF_GROUP_CONNECTION,
+        "autojoin.max", NULL);
+    if (result <= 0) {
+        return PREFS_DEFAULT_AUTOJOIN_MAX;
+    } else {
+        return result;
+    }
+}
+
+void
+prefs_set_autojoin_max(gint value)
+{
+    g_key_file_set_integer(prefs, PREF_GROUP_CONNECTION, "autojoin.max", value);
+    _save_prefs();
+}
+
+/*
+ * Return the rooms the user has most recently sent messages to, most
+ * recent first, the list and its strings must be freed by the caller
+ */
+GSList *
+prefs_get_recent_rooms(void)
+{
+    GSList *result = NULL;
+    gsize length = 0;
+    gchar **rooms = g_key_file_get_string_list(prefs, PREF_GROUP_CONNECTION,
+        "rooms.recent", &length, NULL);
+
+    gsize i;
+    for (i = 0; i < length; i++) {
+        result = g_slist_append(result, strdup(rooms[i]));
+    }
+    g_strfreev(rooms);
+
+    return result;
+}
+
+/*
+ * Move the room to the front of the recent rooms, the change is saved by
+ * prefs_flush or with the next preference saved
+ */
+void
+prefs_set_room_active(const char * const room)
+{
+    gsize length = 0;
+    gchar **rooms = g_key_file_get_string_list(prefs, PREF_GROUP_CONNECTION,
+        "rooms.recent", &length, NULL);
+
+    if ((length > 0) && (g_strcmp0(rooms[0], room) == 0)) {
+        g_strfreev(rooms);
+        return;
+    }
+
+    gchar **new_rooms = g_new0(gchar *, PREFS_MAX_RECENT_ROOMS + 1);
+    gsize new_length = 0;
+    new_rooms[new_length++] = (gchar *)room;
+    gsize i;
+    for (i = 0; i < length && new_length < PREFS_MAX_RECENT_ROOMS; i++) {
+        if (g_strcmp0(rooms[i], room) != 0) {
+            new_rooms[new_length++] = rooms[i];
+        }
+    }
+
+    g_key_file_set_string_list(prefs, PREF_GROUP_CONNECTION, "rooms.recent",
+        (const gchar * const *)new_rooms, new_length);
+    recent_rooms_changed = TRUE;
+
+    g_free(new_rooms);
+    g_strfreev(rooms);
+}
+
 gint
 prefs_get_autoaway_time(void)
 {
@@ -257,12 +359,204 @@ prefs_set_autoaway_time(gint value)
     _save_prefs();
 }
 
+/*
+ * Return the words highlighted in chat room messages, the list and its
+ * strings must be freed by the caller
+ */
+GSList *
+prefs_get_highlight_words(void)
+{
+    GSList *result = NULL;
+    gsize length = 0;
+    gchar **words = g_key_file_get_string_list(prefs, PREF_GROUP_UI,
+        "highlight", &length, NULL);
+
+    gsize i;
+    for (i = 0; i < length; i++) {
+        result = g_slist_append(result, strdup(words[i]));
+    }
+    g_strfreev(words);
+
+    return result;
+}
+
+gboolean
+prefs_add_highlight_word(const char * const word)
+{
+    return _string_list_add(PREF_GROUP_UI, "highlight", word);
+}
+
+gboolean
+prefs_remove_highlight_word(const char * const word)
+{
+    return _string_list_remove(PREF_GROUP_UI, "highlight", word);
+}
+
+/*
+ * Returns TRUE if messages in the room are summarised rather than shown
+ * while its window is not focused
+ */
+gboolean
+prefs_get_room_digest(const char * const room)
+{
+    return _string_list_contains(PREF_GROUP_UI, "digest.rooms", room);
+}
+
+void
+prefs_set_room_digest(const char * const room, gboolean digest)
+{
+    if (digest) {
+        _string_list_add(PREF_GROUP_UI, "digest.rooms", room);
+    } else {
+        _string_list_remove(PREF_GROUP_UI, "digest.rooms", room);
+    }
+}
+
+/*
+ * Returns TRUE if only a count of the room's occupants and its recent
+ * speakers are kept, rather than its full roster
+ */
+gboolean
+prefs_get_room_lurk(const char * const room)
+{
+    return _string_list_contains(PREF_GROUP_UI, "lurk.rooms", room);
+}
+
+void
+prefs_set_room_lurk(const char * const room, gboolean lurk)
+{
+    if (lurk) {
+        _string_list_add(PREF_GROUP_UI, "lurk.rooms", room);
+    } else {
+        _string_list_remove(PREF_GROUP_UI, "lurk.rooms", room);
+    }
+}
+
+gint
+prefs_get_digest_interval(void)
+{
+    gint result = g_key_file_get_integer(prefs, PREF_GROUP_UI,
+        "digest.interval", NULL);
+    if (result <= 0) {
+        return PREFS_DEFAULT_DIGEST_INTERVAL;
+    } else {
+        return result;
+    }
+}
+
+void
+prefs_set_digest_interval(gint value)
+{
+    g_key_file_set_integer(prefs, PREF_GROUP_UI, "digest.interval", value);
+    _save_prefs();
+}
+
+static gboolean
+_string_list_contains(const char * const group, const char * const key,
+    const char * const value)
+{
+    gsize length = 0;
+    gchar **values = g_key_file_get_string_list(prefs, group, key, &length,
+        NULL);
+
+    gboolean result = FALSE;
+    gsize i;
+    for (i = 0; i < length; i++) {
+        if (g_ascii_strcasecmp(values[i], value) == 0) {
+            result = TRUE;
+            break;
+        }
+    }
+    g_strfreev(values);
+
+    return result;
+}
+
+/*
+ * Add the value to the string list stored at the key unless already present,
+ * comparing without case
+ */
+static gboolean
+_string_list_add(const char * const group, const char * const key,
+    const char * const value)
+{
+    if (_string_list_contains(group, key, value)) {
+        return FALSE;
+    }
+
+    gsize length = 0;
+    gchar **values = g_key_file_get_string_list(prefs, group, key, &length,
+        NULL);
+
+    gchar **new_values = g_new0(gchar *, length + 2);
+    gsize i;
+    for (i = 0; i < length; i++) {
+        new_values[i] = values[i];
+    }
+    new_values[length] = (gchar *)value;
+
+    g_key_file_set_string_list(prefs, group, key,
+        (const gchar * const *)new_values, length + 1);
+    _save_prefs();
+
+    g_free(new_values);
+    g_strfreev(values);
+
+    return TRUE;
+}
+
+static gboolean
+_string_list_remove(const char * const group, const char * const key,
+    const char * const value)
+{
+    gsize length = 0;
+    gchar **values = g_key_file_get_string_list(prefs, group, key, &length,
+        NULL);
+
+    gchar **new_values = g_new0(gchar *, length + 1);
+    gsize new_length = 0;
+    gsize i;
+    for (i = 0; i < length; i++) {
+        if (g_ascii_strcasecmp(values[i], value) != 0) {
+            new_values[new_length++] = values[i];
+        }
+    }
+
+    gboolean removed = (new_length < length);
+    if (removed) {
+        if (new_length == 0) {
+            g_key_file_remove_key(prefs, group, key, NULL);
+        } else {
+            g_key_file_set_string_list(prefs, group, key,
+                (const gchar * const *)new_values, new_length);
+        }
+        _save_prefs();
+    }
+
+    g_free(new_values);
+    g_strfreev(values);
+
+    return removed;
+}
+
+/*
+ * Save any preferences not saved when they were set
+ */
+void
+prefs_flush(void)
+{
+    if (recent_rooms_changed) {
+        _save_prefs();
+    }
+}
+
 static void
 _save_prefs(void)
 {
     gsize g_data_size;
     char *g_prefs_data = g_key_file_to_data(prefs, &g_data_size, NULL);
     g_file_set_contents(prefs_loc, g_prefs_data, g_data_size, NULL);
+    recent_rooms_changed = FALSE;
 }
 
 static gchar *
@@ -301,6 +595,7 @@ _get_group(preference_t pref)
         case PREF_NOTIFY_MESSAGE:
         case PREF_NOTIFY_INVITE:
         case PREF_NOTIFY_SUB:
+        case PREF_NOTIFY_MENTION:
             return "notifications";
         case PREF_CHLOG:
         case PREF_GRLOG:
@@ -351,6 +646,8 @@ _get_key(preference_t pref)
             return "invite";
         case PREF_NOTIFY_SUB:
             return "sub";
+        case PREF_NOTIFY_MENTION:
+            return "mention";
         case PREF_CHLOG:
             return "chlog";
         case PREF_GRLOG:
@@ -373,6 +670,7 @@ _get_default_boolean(preference_t pref)
     {
         case PREF_STATUSES:
         case PREF_AUTOAWAY_CHECK:
+        case PREF_NOTIFY_MENTION:
             return TRUE;
         default:
             return FALSE;
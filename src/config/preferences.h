@@ -34,6 +34,11 @@
 
 #define PREFS_MIN_LOG_SIZE 64
 #define PREFS_MAX_LOG_SIZE 1048580
+#define PREFS_MIN_INPHIST_SIZE 10
+#define PREFS_DEFAULT_INPHIST_SIZE 100000
+#define PREFS_DEFAULT_DIGEST_INTERVAL 60
+#define PREFS_DEFAULT_AUTOJOIN_MAX 5
+#define PREFS_MAX_RECENT_ROOMS 50
 
 typedef enum {
     PREF_SPLASH,
@@ -52,6 +57,7 @@ typedef enum {
     PREF_NOTIFY_MESSAGE,
     PREF_NOTIFY_INVITE,
     PREF_NOTIFY_SUB,
+    PREF_NOTIFY_MENTION,
     PREF_CHLOG,
     PREF_GRLOG,
     PREF_AUTOAWAY_CHECK,
@@ -61,6 +67,7 @@ typedef enum {
 
 void prefs_load(void);
 void prefs_close(void);
+void prefs_flush(void);
 
 char * prefs_find_login(char *prefix);
 void prefs_reset_login_search(void);
@@ -74,18 +81,35 @@ void prefs_set_notify_remind(gint period);
 gint prefs_get_notify_remind(void);
 void prefs_set_max_log_size(gint value);
 gint prefs_get_max_log_size(void);
+gint prefs_get_max_inphist_size(void);
+void prefs_set_max_inphist_size(gint value);
 void prefs_set_priority(gint value);
 gint prefs_get_priority(void);
 void prefs_set_reconnect(gint value);
 gint prefs_get_reconnect(void);
 void prefs_set_autoping(gint value);
 gint prefs_get_autoping(void);
+void prefs_set_autojoin_max(gint value);
+gint prefs_get_autojoin_max(void);
+GSList * prefs_get_recent_rooms(void);
+void prefs_set_room_active(const char * const room);
 
 gint prefs_get_autoaway_time(void);
 void prefs_set_autoaway_time(gint value);
 
 void prefs_add_login(const char *jid);
 
+GSList * prefs_get_highlight_words(void);
+gboolean prefs_add_highlight_word(const char * const word);
+gboolean prefs_remove_highlight_word(const char * const word);
+
+gboolean prefs_get_room_digest(const char * const room);
+void prefs_set_room_digest(const char * const room, gboolean digest);
+gint prefs_get_digest_interval(void);
+gboolean prefs_get_room_lurk(const char * const room);
+void prefs_set_room_lurk(const char * const room, gboolean lurk);
+void prefs_set_digest_interval(gint value);
+
 gboolean prefs_get_boolean(preference_t pref);
 void prefs_set_boolean(preference_t pref, gboolean value);
 char * prefs_get_string(preference_t pref);
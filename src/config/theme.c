@@ -87,6 +87,7 @@ static struct colours_t {
         NCURSES_COLOR_T roominfo;
         NCURSES_COLOR_T me;
         NCURSES_COLOR_T them;
+        NCURSES_COLOR_T highlight;
 } colour_prefs;
 
 static NCURSES_COLOR_T _lookup_colour(const char * const colour);
@@ -207,6 +208,7 @@ theme_init_colours(void)
     // chat
     init_pair(30, colour_prefs.me, colour_prefs.bkgnd);
     init_pair(31, colour_prefs.them, colour_prefs.bkgnd);
+    init_pair(32, colour_prefs.highlight, colour_prefs.bkgnd);
 
     // room chat
     init_pair(40, colour_prefs.roominfo, colour_prefs.bkgnd);
@@ -371,6 +373,10 @@ _load_colours(void)
     gchar *them_val = g_key_file_get_string(theme, "colours", "them", NULL);
     _set_colour(them_val, &colour_prefs.them, COLOR_GREEN);
     g_free(them_val);
+
+    gchar *highlight_val = g_key_file_get_string(theme, "colours", "highlight", NULL);
+    _set_colour(highlight_val, &colour_prefs.highlight, COLOR_MAGENTA);
+    g_free(highlight_val);
 }
 
 static gchar *
@@ -46,6 +46,7 @@
 #define COLOUR_STATUS_NEW       COLOR_PAIR(23)
 #define COLOUR_ME               COLOR_PAIR(30)
 #define COLOUR_THEM             COLOR_PAIR(31)
+#define COLOUR_HIGHLIGHT        COLOR_PAIR(32)
 #define COLOUR_ROOMINFO         COLOR_PAIR(40)
 #define COLOUR_ONLINE           COLOR_PAIR(50)
 #define COLOUR_OFFLINE          COLOR_PAIR(51)
@@ -29,38 +29,71 @@
 #include "contact.h"
 #include "common.h"
 #include "resource.h"
+#include "tools/intern.h"
+#include "tools/pool.h"
+
+// resources held in the contact itself, before spilling to a hash table
+#define CONTACT_INLINE_RESOURCES 2
+
+typedef enum {
+    SUBSCRIPTION_NONE,
+    SUBSCRIPTION_TO,
+    SUBSCRIPTION_FROM,
+    SUBSCRIPTION_BOTH
+} contact_subscription_t;
+
+static const char * const subscription_strings[] = {
+    "none",
+    "to",
+    "from",
+    "both"
+};
 
 struct p_contact_t {
-    char *barejid;
-    char *name;
+    const char *barejid;
+    const char *name;
+    char *collate_key;
     GSList *groups;
-    char *subscription;
     char *offline_message;
-    gboolean pending_out;
     GDateTime *last_activity;
-    GHashTable *available_resources;
+    Resource *resources[CONTACT_INLINE_RESOURCES];
+    GHashTable *spilled_resources;
+    Resource *most_available;
+    guint8 resource_count;
+    guint8 subscription;
+    gboolean pending_out;
 };
 
+// contacts are created for every room occupant, so reuse their memory
+static Pool contact_pool = NULL;
+
+static void _update_collate_key(const PContact contact);
+static void _update_most_available_resource(const PContact contact);
+static int _find_inline_resource(const PContact contact, const char * const name);
+static void _spill_resources(const PContact contact);
+static void _free_resources(const PContact contact);
+static contact_subscription_t _subscription_from_string(const char * const subscription);
+static GSList * _intern_groups(GSList *groups);
+static void _free_groups(GSList *groups);
+
 PContact
 p_contact_new(const char * const barejid, const char * const name,
     GSList *groups, const char * const subscription,
     const char * const offline_message, gboolean pending_out)
 {
-    PContact contact = malloc(sizeof(struct p_contact_t));
-    contact->barejid = strdup(barejid);
-
-    if (name != NULL) {
-        contact->name = strdup(name);
-    } else {
-        contact->name = NULL;
+    if (contact_pool == NULL) {
+        contact_pool = pool_new(sizeof(struct p_contact_t));
     }
+    PContact contact = pool_alloc(contact_pool);
+    contact->barejid = intern_str(barejid);
 
-    contact->groups = groups;
+    contact->name = intern_str(name);
 
-    if (subscription != NULL)
-        contact->subscription = strdup(subscription);
-    else
-        contact->subscription = strdup("none");
+    contact->collate_key = NULL;
+    _update_collate_key(contact);
+
+    contact->groups = _intern_groups(groups);
+    contact->subscription = _subscription_from_string(subscription);
 
     if (offline_message != NULL)
         contact->offline_message = strdup(offline_message);
@@ -70,8 +103,9 @@ p_contact_new(const char * const barejid, const char * const name,
     contact->pending_out = pending_out;
     contact->last_activity = NULL;
 
-    contact->available_resources = g_hash_table_new_full(g_str_hash, g_str_equal, free,
-        (GDestroyNotify)resource_destroy);
+    contact->resource_count = 0;
+    contact->spilled_resources = NULL;
+    contact->most_available = NULL;
 
     return contact;
 }
@@ -79,35 +113,32 @@ p_contact_new(const char * const barejid, const char * const name,
 void
 p_contact_set_name(const PContact contact, const char * const name)
 {
-    FREE_SET_NULL(contact->name);
-    if (name != NULL) {
-        contact->name = strdup(name);
-    }
+    const char *new_name = intern_str(name);
+    intern_release(contact->name);
+    contact->name = new_name;
+    _update_collate_key(contact);
 }
 
 void
 p_contact_set_groups(const PContact contact, GSList *groups)
 {
-    if (contact->groups != NULL) {
-        g_slist_free_full(contact->groups, g_free);
-        contact->groups = NULL;
-    }
-
-    contact->groups = groups;
+    _free_groups(contact->groups);
+    contact->groups = _intern_groups(groups);
 }
 
+/*
+ * Groups are interned, so membership is a pointer comparison against the
+ * group's interned copy
+ */
 gboolean
 p_contact_in_group(const PContact contact, const char * const group)
 {
-    GSList *groups = contact->groups;
-    while (groups != NULL) {
-        if (strcmp(groups->data, group) == 0) {
-            return TRUE;
-        }
-        groups = g_slist_next(groups);
+    const char *group_id = intern_lookup(group);
+    if (group_id == NULL) {
+        return FALSE;
     }
 
-    return FALSE;
+    return (g_slist_find(contact->groups, group_id) != NULL);
 }
 
 GSList *
@@ -119,28 +150,54 @@ p_contact_groups(const PContact contact)
 gboolean
 p_contact_remove_resource(PContact contact, const char * const resource)
 {
-    return g_hash_table_remove(contact->available_resources, resource);
+    gboolean result = FALSE;
+
+    if (contact->spilled_resources != NULL) {
+        result = g_hash_table_remove(contact->spilled_resources, resource);
+        if (g_hash_table_size(contact->spilled_resources) == 0) {
+            g_hash_table_destroy(contact->spilled_resources);
+            contact->spilled_resources = NULL;
+        }
+    } else {
+        int index = _find_inline_resource(contact, resource);
+        if (index != -1) {
+            // keep the array packed by moving the last resource into the gap
+            resource_destroy(contact->resources[index]);
+            contact->resource_count--;
+            contact->resources[index] = contact->resources[contact->resource_count];
+            contact->resources[contact->resource_count] = NULL;
+            result = TRUE;
+        }
+    }
+
+    _update_most_available_resource(contact);
+
+    return result;
+}
+
+void
+p_contact_remove_all_resources(PContact contact)
+{
+    _free_resources(contact);
+    contact->most_available = NULL;
 }
 
 void
 p_contact_free(PContact contact)
 {
     if (contact != NULL) {
-        free(contact->barejid);
-        free(contact->name);
-        free(contact->subscription);
+        intern_release(contact->barejid);
+        intern_release(contact->name);
+        g_free(contact->collate_key);
         free(contact->offline_message);
-
-        if (contact->groups != NULL) {
-            g_slist_free_full(contact->groups, g_free);
-        }
+        _free_groups(contact->groups);
 
         if (contact->last_activity != NULL) {
             g_date_time_unref(contact->last_activity);
         }
 
-        g_hash_table_destroy(contact->available_resources);
-        free(contact);
+        _free_resources(contact);
+        pool_free(contact_pool, contact);
     }
 }
 
@@ -156,6 +213,16 @@ p_contact_name(const PContact contact)
     return contact->name;
 }
 
+/*
+ * Collation key for the contact's name, or barejid if no name is set,
+ * for sorting contacts with strcmp
+ */
+const char *
+p_contact_collate_key(const PContact contact)
+{
+    return contact->collate_key;
+}
+
 const char *
 p_contact_name_or_jid(const PContact contact)
 {
@@ -166,6 +233,113 @@ p_contact_name_or_jid(const PContact contact)
     }
 }
 
+static void
+_update_collate_key(const PContact contact)
+{
+    g_free(contact->collate_key);
+    if (contact->name != NULL) {
+        contact->collate_key = g_utf8_collate_key(contact->name, -1);
+    } else {
+        contact->collate_key = g_utf8_collate_key(contact->barejid, -1);
+    }
+}
+
+/*
+ * Replace each group name in the list, which the contact takes ownership of,
+ * with its interned copy, dropping groups listed more than once
+ */
+static GSList *
+_intern_groups(GSList *groups)
+{
+    GSList *result = NULL;
+    GSList *curr = groups;
+    while (curr != NULL) {
+        char *group = curr->data;
+        const char *interned = intern_str(group);
+        free(group);
+
+        if (g_slist_find(result, interned) == NULL) {
+            result = g_slist_prepend(result, (char *)interned);
+        } else {
+            intern_release(interned);
+        }
+        curr = g_slist_next(curr);
+    }
+    g_slist_free(groups);
+
+    return g_slist_reverse(result);
+}
+
+static void
+_free_groups(GSList *groups)
+{
+    g_slist_free_full(groups, (GDestroyNotify)intern_release);
+}
+
+static contact_subscription_t
+_subscription_from_string(const char * const subscription)
+{
+    if (g_strcmp0(subscription, "to") == 0) {
+        return SUBSCRIPTION_TO;
+    } else if (g_strcmp0(subscription, "from") == 0) {
+        return SUBSCRIPTION_FROM;
+    } else if (g_strcmp0(subscription, "both") == 0) {
+        return SUBSCRIPTION_BOTH;
+    } else {
+        return SUBSCRIPTION_NONE;
+    }
+}
+
+static int
+_find_inline_resource(const PContact contact, const char * const name)
+{
+    int i;
+    for (i = 0; i < contact->resource_count; i++) {
+        if (g_strcmp0(contact->resources[i]->name, name) == 0) {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+/*
+ * Move the inline resources into a hash table, used once the contact has
+ * more resources than fit inline
+ */
+static void
+_spill_resources(const PContact contact)
+{
+    // keys are the interned names owned by the resources
+    contact->spilled_resources = g_hash_table_new_full(g_str_hash, g_str_equal,
+        NULL, (GDestroyNotify)resource_destroy);
+
+    int i;
+    for (i = 0; i < contact->resource_count; i++) {
+        Resource *resource = contact->resources[i];
+        g_hash_table_insert(contact->spilled_resources, (char *)resource->name,
+            resource);
+        contact->resources[i] = NULL;
+    }
+    contact->resource_count = 0;
+}
+
+static void
+_free_resources(const PContact contact)
+{
+    if (contact->spilled_resources != NULL) {
+        g_hash_table_destroy(contact->spilled_resources);
+        contact->spilled_resources = NULL;
+    }
+
+    int i;
+    for (i = 0; i < contact->resource_count; i++) {
+        resource_destroy(contact->resources[i]);
+        contact->resources[i] = NULL;
+    }
+    contact->resource_count = 0;
+}
+
 static Resource *
 _highest_presence(Resource *first, Resource *second)
 {
@@ -190,8 +364,26 @@ _highest_presence(Resource *first, Resource *second)
     }
 }
 
-Resource *
-_get_most_available_resource(PContact contact)
+static Resource *
+_more_available(Resource *highest, Resource *current)
+{
+    if (highest == NULL) {
+        return current;
+
+    // priority is same as current highest, choose presence
+    } else if (current->priority == highest->priority) {
+        return _highest_presence(highest, current);
+
+    // priority higher than current highest, set new presence
+    } else if (current->priority > highest->priority) {
+        return current;
+    } else {
+        return highest;
+    }
+}
+
+static void
+_update_most_available_resource(const PContact contact)
 {
     // find resource with highest priority, if more than one,
     // use highest availability, in the following order:
@@ -200,26 +392,25 @@ _get_most_available_resource(PContact contact)
     //      away
     //      xa
     //      dnd
-    GList *resources = g_hash_table_get_values(contact->available_resources);
-    Resource *current = resources->data;
-    Resource *highest = current;
-    resources = g_list_next(resources);
-    while (resources != NULL) {
-        current = resources->data;
-
-        // priority is same as current highest, choose presence
-        if (current->priority == highest->priority) {
-            highest = _highest_presence(highest, current);
-
-        // priority higher than current highest, set new presence
-        } else if (current->priority > highest->priority) {
-            highest = current;
-        }
+    Resource *highest = NULL;
 
-        resources = g_list_next(resources);
+    if (contact->spilled_resources != NULL) {
+        GHashTableIter iter;
+        gpointer key;
+        gpointer value;
+
+        g_hash_table_iter_init(&iter, contact->spilled_resources);
+        while (g_hash_table_iter_next(&iter, &key, &value)) {
+            highest = _more_available(highest, value);
+        }
+    } else {
+        int i;
+        for (i = 0; i < contact->resource_count; i++) {
+            highest = _more_available(highest, contact->resources[i]);
+        }
     }
 
-    return highest;
+    contact->most_available = highest;
 }
 
 const char *
@@ -228,13 +419,11 @@ p_contact_presence(const PContact contact)
     assert(contact != NULL);
 
     // no available resources, offline
-    if (g_hash_table_size(contact->available_resources) == 0) {
+    if (contact->most_available == NULL) {
         return "offline";
     }
 
-    Resource *resource = _get_most_available_resource(contact);
-
-    return string_from_resource_presence(resource->presence);
+    return string_from_resource_presence(contact->most_available->presence);
 }
 
 const char *
@@ -243,39 +432,39 @@ p_contact_status(const PContact contact)
     assert(contact != NULL);
 
     // no available resources, use offline message
-    if (g_hash_table_size(contact->available_resources) == 0) {
+    if (contact->most_available == NULL) {
         return contact->offline_message;
     }
 
-    Resource *resource = _get_most_available_resource(contact);
-
-    return resource->status;
+    return contact->most_available->status;
 }
 
 const char *
 p_contact_subscription(const PContact contact)
 {
-    return contact->subscription;
+    return subscription_strings[contact->subscription];
 }
 
 gboolean
 p_contact_subscribed(const PContact contact)
 {
-    if (contact->subscription == NULL) {
-        return FALSE;
-    } else if (strcmp(contact->subscription, "to") == 0) {
-        return TRUE;
-    } else if (strcmp(contact->subscription, "both") == 0) {
-        return TRUE;
-    } else {
-        return FALSE;
-    }
+    return ((contact->subscription == SUBSCRIPTION_TO) ||
+        (contact->subscription == SUBSCRIPTION_BOTH));
 }
 
 Resource *
 p_contact_get_resource(const PContact contact, const char * const resource)
 {
-    return g_hash_table_lookup(contact->available_resources, resource);
+    if (contact->spilled_resources != NULL) {
+        return g_hash_table_lookup(contact->spilled_resources, resource);
+    }
+
+    int index = _find_inline_resource(contact, resource);
+    if (index == -1) {
+        return NULL;
+    }
+
+    return contact->resources[index];
 }
 
 gboolean
@@ -295,19 +484,29 @@ p_contact_get_available_resources(const PContact contact)
 {
     assert(contact != NULL);
 
-    return g_hash_table_get_values(contact->available_resources);
+    if (contact->spilled_resources != NULL) {
+        return g_hash_table_get_values(contact->spilled_resources);
+    }
+
+    GList *result = NULL;
+    int i;
+    for (i = contact->resource_count - 1; i >= 0; i--) {
+        result = g_list_prepend(result, contact->resources[i]);
+    }
+
+    return result;
 }
 
 gboolean
 p_contact_is_available(const PContact contact)
 {
     // no available resources, unavailable
-    if (g_hash_table_size(contact->available_resources) == 0) {
+    Resource *most_available = contact->most_available;
+    if (most_available == NULL) {
         return FALSE;
     }
 
     // if most available resource is CHAT or ONLINE, available
-    Resource *most_available = _get_most_available_resource(contact);
     if ((most_available->presence == RESOURCE_ONLINE) ||
         (most_available->presence == RESOURCE_CHAT)) {
         return TRUE;
@@ -319,22 +518,42 @@ p_contact_is_available(const PContact contact)
 gboolean
 p_contact_has_available_resource(const PContact contact)
 {
-    return (g_hash_table_size(contact->available_resources) > 0);
+    return (contact->most_available != NULL);
 }
 
+/*
+ * Add or replace the resource, up to CONTACT_INLINE_RESOURCES are held in
+ * the contact itself, beyond that they move to a hash table until the
+ * contact has no resources left
+ */
 void
 p_contact_set_presence(const PContact contact, Resource *resource)
 {
-    g_hash_table_replace(contact->available_resources, strdup(resource->name), resource);
+    if (contact->spilled_resources == NULL) {
+        int index = _find_inline_resource(contact, resource->name);
+        if (index != -1) {
+            resource_destroy(contact->resources[index]);
+            contact->resources[index] = resource;
+        } else if (contact->resource_count < CONTACT_INLINE_RESOURCES) {
+            contact->resources[contact->resource_count++] = resource;
+        } else {
+            _spill_resources(contact);
+        }
+    }
+
+    // replace rather than insert, so the key is the new resource's name
+    if (contact->spilled_resources != NULL) {
+        g_hash_table_replace(contact->spilled_resources, (char *)resource->name,
+            resource);
+    }
+
+    _update_most_available_resource(contact);
 }
 
 void
 p_contact_set_subscription(const PContact contact, const char * const subscription)
 {
-    FREE_SET_NULL(contact->subscription);
-    if (subscription != NULL) {
-        contact->subscription = strdup(subscription);
-    }
+    contact->subscription = _subscription_from_string(subscription);
 }
 
 void
@@ -32,10 +32,12 @@ PContact p_contact_new(const char * const barejid, const char * const name,
     const char * const offline_message, gboolean pending_out);
 void p_contact_add_resource(PContact contact, Resource *resource);
 gboolean p_contact_remove_resource(PContact contact, const char * const resource);
+void p_contact_remove_all_resources(PContact contact);
 void p_contact_free(PContact contact);
 const char* p_contact_barejid(PContact contact);
 const char* p_contact_name(PContact contact);
 const char * p_contact_name_or_jid(const PContact contact);
+const char * p_contact_collate_key(const PContact contact);
 const char* p_contact_presence(PContact contact);
 const char* p_contact_status(PContact contact);
 const char* p_contact_subscription(const PContact contact);
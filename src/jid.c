@@ -29,67 +29,70 @@
 
 #include "common.h"
 
+static char * _copy_part(char **dest, const char * const src, size_t len);
+
+/*
+ * The struct and all of its strings are allocated as a single block, freed
+ * by jid_destroy
+ */
 Jid *
 jid_create(const gchar * const str)
 {
-    Jid *result = NULL;
-
-    /* if str is NULL g_strdup returns NULL */
-    gchar *trimmed = g_strdup(str);
-    if (trimmed == NULL) {
+    if (str == NULL) {
         return NULL;
     }
 
-    if (strlen(trimmed) == 0) {
-        g_free(trimmed);
+    size_t len = strlen(str);
+    if (len == 0) {
         return NULL;
     }
 
-    if (g_str_has_prefix(trimmed, "/") || g_str_has_prefix(trimmed, "@")) {
-        g_free(trimmed);
+    if (g_str_has_prefix(str, "/") || g_str_has_prefix(str, "@")) {
         return NULL;
     }
 
-    if (!g_utf8_validate(trimmed, -1, NULL)) {
-        g_free(trimmed);
+    if (!g_utf8_validate(str, -1, NULL)) {
         return NULL;
     }
 
-    result = malloc(sizeof(struct jid_t));
-    result->str = NULL;
+    // '/' and '@' are single bytes in UTF-8, so the parts are split on bytes
+    const char *slashp = strchr(str, '/');
+    size_t bare_len = (slashp != NULL) ? (size_t)(slashp - str) : len;
+    const char *atp = memchr(str, '@', bare_len);
+    const char *domain_start = (atp != NULL) ? atp + 1 : str;
+    size_t domain_len = (str + bare_len) - domain_start;
+
+    gsize size = sizeof(struct jid_t) + (len + 1) + (domain_len + 1) +
+        (bare_len + 1);
+    if (atp != NULL) {
+        size += (atp - str) + 1;
+    }
+    if (slashp != NULL) {
+        size += len - bare_len;
+    }
+
+    Jid *result = g_malloc(size);
+    char *strings = (char *)(result + 1);
+
+    result->str = _copy_part(&strings, str, len);
     result->localpart = NULL;
-    result->domainpart = NULL;
     result->resourcepart = NULL;
-    result->barejid = NULL;
     result->fulljid = NULL;
 
-    gchar *atp = g_utf8_strchr(trimmed, -1, '@');
-    gchar *slashp = g_utf8_strchr(trimmed, -1, '/');
-    gchar *domain_start = trimmed;
-
-
     if (atp != NULL) {
-        result->localpart = g_utf8_substring(trimmed, 0, g_utf8_pointer_to_offset(trimmed, atp));
-        domain_start = atp + 1;
+        result->localpart = _copy_part(&strings, str, atp - str);
     }
 
-    if (slashp != NULL) {
-        result->resourcepart = g_strdup(slashp + 1);
-        result->domainpart = g_utf8_substring(domain_start, 0, g_utf8_pointer_to_offset(domain_start, slashp));
-        result->barejid = g_utf8_substring(trimmed, 0, g_utf8_pointer_to_offset(trimmed, slashp));
-        result->fulljid = g_strdup(trimmed);
-    } else {
-        result->domainpart = g_strdup(domain_start);
-        result->barejid = g_strdup(trimmed);
-    }
+    result->domainpart = _copy_part(&strings, domain_start, domain_len);
+    result->barejid = _copy_part(&strings, str, bare_len);
 
-    if (result->domainpart == NULL) {
-        jid_destroy(result);
-        return NULL;
+    // the full jid is the whole string
+    if (slashp != NULL) {
+        result->resourcepart = _copy_part(&strings, slashp + 1,
+            len - bare_len - 1);
+        result->fulljid = result->str;
     }
 
-    result->str = trimmed;
-
     return result;
 }
 
@@ -107,15 +110,7 @@ jid_create_from_bare_and_resource(const char * const room, const char * const ni
 void
 jid_destroy(Jid *jid)
 {
-    if (jid != NULL) {
-        g_free(jid->str);
-        g_free(jid->localpart);
-        g_free(jid->domainpart);
-        g_free(jid->resourcepart);
-        g_free(jid->barejid);
-        g_free(jid->fulljid);
-        free(jid);
-    }
+    g_free(jid);
 }
 
 gboolean
@@ -216,3 +211,14 @@ get_nick_from_full_jid(const char * const full_room_jid)
 
     return nick_part;
 }
+
+static char *
+_copy_part(char **dest, const char * const src, size_t len)
+{
+    char *result = *dest;
+    memcpy(result, src, len);
+    result[len] = '\0';
+    *dest += len + 1;
+
+    return result;
+}
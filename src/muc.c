@@ -27,26 +27,89 @@
 
 #include "contact.h"
 #include "jid.h"
+#include "config/preferences.h"
 #include "tools/autocomplete.h"
+#include "tools/highlight.h"
+#include "tools/intern.h"
+#include "tools/pool.h"
 
 #include "ui/ui.h"
 
+// number of recent messages kept in a room's digest
+#define DIGEST_LINES 5
+
+// number of recent speakers remembered in a lurked room
+#define LURK_SPEAKERS 100
+
+// room occupant, allocated when the occupant joins and updated in place
+// by their later presences
+typedef struct _muc_occupant_t {
+    PContact contact;
+    Resource *resource;
+    const char *role;
+    const char *affiliation;
+    const char *real_jid;
+} Occupant;
+
 typedef struct _muc_room_t {
-    char *room; // e.g. test@conference.server
+    const char *room; // e.g. test@conference.server
     char *nick; // e.g. Some User
     char *subject;
     gboolean pending_nick_change;
     GHashTable *roster;
+    GSequence *sorted_roster;
     Autocomplete nick_ac;
     GHashTable *nick_changes;
     gboolean roster_received;
+    Highlighter highlighter;
+    gboolean digest;
+    RoomDigest *pending_digest;
+    GHashTable *role_index;
+    GHashTable *affiliation_index;
+    // when lurking, occupants are only counted, and only the most recent
+    // speakers are known by nick, for completion and status updates
+    gboolean lurk;
+    gint lurk_occupants;
+    GQueue *speakers;
+    GHashTable *speaker_links;
 } ChatRoom;
 
 GHashTable *rooms = NULL;
 Autocomplete invite_ac;
 
+// rooms with a digest waiting to be shown, so that checking for due
+// digests does not visit every room
+static GSList *digest_rooms = NULL;
+
+// occupants are allocated for every join, so reuse their memory
+static Pool occupant_pool = NULL;
+
+// occupants of every room by their real bare jid, where the room reveals
+// it, each to a table of occupant to room
+static GHashTable *real_jids = NULL;
+
 static void _free_room(ChatRoom *room);
-static gint _compare_participants(PContact a, PContact b);
+static void _index_roster(ChatRoom *chat_room);
+static Occupant * _occupant_new(const char * const nick,
+    resource_presence_t presence, const char * const status,
+    const char * const caps_str);
+static void _occupant_set_role(ChatRoom *chat_room, Occupant *occupant,
+    const char * const role, const char * const affiliation);
+static void _occupant_set_real_jid(ChatRoom *chat_room, Occupant *occupant,
+    const char * const jid);
+static void _unindex_occupant(ChatRoom *chat_room, Occupant *occupant);
+static void _real_jid_index_remove(Occupant *occupant);
+static void _nick_index_add(GHashTable *index, const char * const key,
+    const char * const nick);
+static void _nick_index_remove(GHashTable *index, const char * const key,
+    const char * const nick);
+static GList * _nick_index_get(GHashTable *index, const char * const key);
+static void _lurk_start(ChatRoom *chat_room);
+static void _lurk_stop(ChatRoom *chat_room);
+static void _lurk_forget_speaker(ChatRoom *chat_room, const char * const nick);
+static void _free_occupant(Occupant *occupant);
+static gint _compare_participants(PContact a, PContact b, gpointer data);
+static void _free_digest_line(DigestLine *line);
 
 void
 muc_init(void)
@@ -55,13 +118,13 @@ muc_init(void)
 }
 
 void
-muc_add_invite(char *room)
+muc_add_invite(const char *room)
 {
     autocomplete_add(invite_ac, room);
 }
 
 void
-muc_remove_invite(char *room)
+muc_remove_invite(const char * const room)
 {
     autocomplete_remove(invite_ac, room);
 }
@@ -120,23 +183,38 @@ void
 muc_join_room(const char * const room, const char * const nick)
 {
     if (rooms == NULL) {
-        rooms = g_hash_table_new_full(g_str_hash, g_str_equal, g_free,
+        rooms = g_hash_table_new_full(g_str_hash, g_str_equal, NULL,
             (GDestroyNotify)_free_room);
     }
 
     ChatRoom *new_room = malloc(sizeof(ChatRoom));
-    new_room->room = strdup(room);
+    new_room->room = intern_str(room);
     new_room->nick = strdup(nick);
     new_room->subject = NULL;
-    new_room->roster = g_hash_table_new_full(g_str_hash, g_str_equal, g_free,
-        (GDestroyNotify)p_contact_free);
+    new_room->roster = g_hash_table_new_full(g_str_hash, g_str_equal, NULL,
+        (GDestroyNotify)_free_occupant);
+    new_room->sorted_roster = g_sequence_new(NULL);
     new_room->nick_ac = autocomplete_new();
     new_room->nick_changes = g_hash_table_new_full(g_str_hash, g_str_equal,
         g_free, g_free);
     new_room->roster_received = FALSE;
     new_room->pending_nick_change = FALSE;
+    new_room->highlighter = NULL;
+    new_room->digest = prefs_get_room_digest(room);
+    new_room->pending_digest = NULL;
+    new_room->role_index = g_hash_table_new_full(g_str_hash, g_str_equal,
+        NULL, (GDestroyNotify)g_hash_table_destroy);
+    new_room->affiliation_index = g_hash_table_new_full(g_str_hash,
+        g_str_equal, NULL, (GDestroyNotify)g_hash_table_destroy);
+    new_room->lurk = FALSE;
+    new_room->lurk_occupants = 0;
+    new_room->speakers = NULL;
+    new_room->speaker_links = NULL;
+    if (prefs_get_room_lurk(room)) {
+        _lurk_start(new_room);
+    }
 
-    g_hash_table_insert(rooms, strdup(room), new_room);
+    g_hash_table_insert(rooms, (gpointer)new_room->room, new_room);
 }
 
 /*
@@ -225,6 +303,8 @@ muc_complete_room_nick_change(const char * const room, const char * const nick)
         free(chat_room->nick);
         chat_room->nick = strdup(nick);
         chat_room->pending_nick_change = FALSE;
+        highlighter_free(chat_room->highlighter);
+        chat_room->highlighter = NULL;
         g_hash_table_remove(chat_room->nick_changes, nick);
     }
 }
@@ -264,6 +344,317 @@ muc_get_room_nick(const char * const room)
     }
 }
 
+/*
+ * Return the matcher for the user's nickname in the room and the highlight
+ * words, compiled when first needed after either changes
+ */
+Highlighter
+muc_get_highlighter(const char * const room)
+{
+    if (rooms == NULL) {
+        return NULL;
+    }
+
+    ChatRoom *chat_room = g_hash_table_lookup(rooms, room);
+    if (chat_room == NULL) {
+        return NULL;
+    }
+
+    if (chat_room->highlighter == NULL) {
+        GSList *words = prefs_get_highlight_words();
+        words = g_slist_prepend(words, strdup(chat_room->nick));
+        chat_room->highlighter = highlighter_new(words);
+        g_slist_free_full(words, free);
+    }
+
+    return chat_room->highlighter;
+}
+
+/*
+ * Discard each room's highlighter, call when the highlight words change
+ */
+void
+muc_highlights_changed(void)
+{
+    if (rooms == NULL) {
+        return;
+    }
+
+    GHashTableIter iter;
+    gpointer key;
+    gpointer value;
+
+    g_hash_table_iter_init(&iter, rooms);
+    while (g_hash_table_iter_next(&iter, &key, &value)) {
+        ChatRoom *chat_room = value;
+        highlighter_free(chat_room->highlighter);
+        chat_room->highlighter = NULL;
+    }
+}
+
+void
+muc_set_digest(const char * const room, gboolean digest)
+{
+    if (rooms == NULL) {
+        return;
+    }
+
+    ChatRoom *chat_room = g_hash_table_lookup(rooms, room);
+    if (chat_room != NULL) {
+        chat_room->digest = digest;
+    }
+}
+
+/*
+ * Returns TRUE if messages in the room are collected into a digest while
+ * its window is not focused
+ */
+gboolean
+muc_get_digest(const char * const room)
+{
+    if (rooms == NULL) {
+        return FALSE;
+    }
+
+    ChatRoom *chat_room = g_hash_table_lookup(rooms, room);
+    if (chat_room != NULL) {
+        return chat_room->digest;
+    } else {
+        return FALSE;
+    }
+}
+
+/*
+ * Count the message in the room's digest, keeping only the most recent
+ * messages to show
+ */
+void
+muc_digest_add(const char * const room, const char * const nick,
+    const char * const message)
+{
+    if (rooms == NULL) {
+        return;
+    }
+
+    ChatRoom *chat_room = g_hash_table_lookup(rooms, room);
+    if (chat_room == NULL) {
+        return;
+    }
+
+    RoomDigest *digest = chat_room->pending_digest;
+    if (digest == NULL) {
+        digest = malloc(sizeof(RoomDigest));
+        digest->total = 0;
+        digest->mentions = 0;
+        digest->counts = g_hash_table_new_full(g_str_hash, g_str_equal, free,
+            NULL);
+        digest->lines = g_queue_new();
+        digest->timer = g_timer_new();
+        chat_room->pending_digest = digest;
+        digest_rooms = g_slist_prepend(digest_rooms, (gpointer)chat_room->room);
+    }
+
+    digest->total++;
+    if ((strcmp(nick, chat_room->nick) != 0) &&
+            highlighter_matches(muc_get_highlighter(room), message)) {
+        digest->mentions++;
+    }
+
+    int count = GPOINTER_TO_INT(g_hash_table_lookup(digest->counts, nick));
+    g_hash_table_insert(digest->counts, strdup(nick),
+        GINT_TO_POINTER(count + 1));
+
+    if (g_queue_get_length(digest->lines) == DIGEST_LINES) {
+        _free_digest_line(g_queue_pop_head(digest->lines));
+    }
+    DigestLine *line = malloc(sizeof(DigestLine));
+    line->nick = strdup(nick);
+    line->message = strdup(message);
+    g_queue_push_tail(digest->lines, line);
+}
+
+/*
+ * Returns TRUE if the room has a digest waiting to be shown, and either it
+ * was started at least interval seconds ago or the room has left digest mode
+ */
+gboolean
+muc_digest_due(const char * const room, gdouble interval)
+{
+    if (rooms == NULL) {
+        return FALSE;
+    }
+
+    ChatRoom *chat_room = g_hash_table_lookup(rooms, room);
+    if ((chat_room == NULL) || (chat_room->pending_digest == NULL)) {
+        return FALSE;
+    }
+
+    if (!chat_room->digest) {
+        return TRUE;
+    }
+
+    return (g_timer_elapsed(chat_room->pending_digest->timer, NULL) >= interval);
+}
+
+/*
+ * Remove and return the room's pending digest, or NULL if there is none
+ * The digest must be freed with muc_digest_free
+ */
+RoomDigest *
+muc_take_digest(const char * const room)
+{
+    if (rooms == NULL) {
+        return NULL;
+    }
+
+    ChatRoom *chat_room = g_hash_table_lookup(rooms, room);
+    if (chat_room == NULL) {
+        return NULL;
+    }
+
+    RoomDigest *digest = chat_room->pending_digest;
+    if (digest != NULL) {
+        chat_room->pending_digest = NULL;
+        digest_rooms = g_slist_remove(digest_rooms, chat_room->room);
+    }
+
+    return digest;
+}
+
+/*
+ * Return the rooms with a digest waiting to be shown, or NULL if there are
+ * none. The list must be freed, its rooms are owned by the chat rooms
+ */
+GSList *
+muc_get_pending_digest_rooms(void)
+{
+    return g_slist_copy(digest_rooms);
+}
+
+void
+muc_digest_free(RoomDigest *digest)
+{
+    if (digest != NULL) {
+        g_hash_table_destroy(digest->counts);
+        g_queue_free_full(digest->lines, (GDestroyNotify)_free_digest_line);
+        g_timer_destroy(digest->timer);
+        free(digest);
+    }
+}
+
+/*
+ * Switch lurk mode for the room, entering it drops the roster and keeps
+ * only a count of the occupants, leaving it takes effect fully once the
+ * room is joined again and the roster received
+ */
+void
+muc_set_lurk(const char * const room, gboolean lurk)
+{
+    if (rooms == NULL) {
+        return;
+    }
+
+    ChatRoom *chat_room = g_hash_table_lookup(rooms, room);
+    if ((chat_room == NULL) || (chat_room->lurk == lurk)) {
+        return;
+    }
+
+    if (lurk) {
+        _lurk_start(chat_room);
+    } else {
+        _lurk_stop(chat_room);
+        autocomplete_clear(chat_room->nick_ac);
+    }
+}
+
+gboolean
+muc_get_lurk(const char * const room)
+{
+    if (rooms == NULL) {
+        return FALSE;
+    }
+
+    ChatRoom *chat_room = g_hash_table_lookup(rooms, room);
+    if (chat_room != NULL) {
+        return chat_room->lurk;
+    } else {
+        return FALSE;
+    }
+}
+
+/*
+ * Return the number of occupants in the room, not including the user
+ */
+gint
+muc_get_occupant_count(const char * const room)
+{
+    if (rooms == NULL) {
+        return 0;
+    }
+
+    ChatRoom *chat_room = g_hash_table_lookup(rooms, room);
+    if (chat_room == NULL) {
+        return 0;
+    } else if (chat_room->lurk) {
+        return chat_room->lurk_occupants;
+    } else {
+        return g_hash_table_size(chat_room->roster);
+    }
+}
+
+/*
+ * Record the nick as the most recent speaker in a lurked room, forgetting
+ * the least recent speaker beyond the limit
+ */
+void
+muc_add_speaker(const char * const room, const char * const nick)
+{
+    if (rooms == NULL) {
+        return;
+    }
+
+    ChatRoom *chat_room = g_hash_table_lookup(rooms, room);
+    if ((chat_room == NULL) || !chat_room->lurk) {
+        return;
+    }
+
+    GList *link = g_hash_table_lookup(chat_room->speaker_links, nick);
+    if (link != NULL) {
+        g_queue_unlink(chat_room->speakers, link);
+        g_queue_push_head_link(chat_room->speakers, link);
+        return;
+    }
+
+    if (g_queue_get_length(chat_room->speakers) == LURK_SPEAKERS) {
+        _lurk_forget_speaker(chat_room, g_queue_peek_tail(chat_room->speakers));
+    }
+
+    g_queue_push_head(chat_room->speakers, strdup(nick));
+    g_hash_table_insert(chat_room->speaker_links,
+        g_queue_peek_head(chat_room->speakers),
+        g_queue_peek_head_link(chat_room->speakers));
+    autocomplete_add(chat_room->nick_ac, nick);
+}
+
+/*
+ * Return the recent speakers in a lurked room, most recent first
+ * The list must be freed with g_list_free, the nicks are owned by the room
+ */
+GList *
+muc_get_speakers(const char * const room)
+{
+    if (rooms == NULL) {
+        return NULL;
+    }
+
+    ChatRoom *chat_room = g_hash_table_lookup(rooms, room);
+    if ((chat_room == NULL) || !chat_room->lurk) {
+        return NULL;
+    }
+
+    return g_list_copy(g_queue_peek_head_link(chat_room->speakers));
+}
+
 /*
  * Returns TRUE if the specified nick exists in the room's roster
  */
@@ -272,9 +663,13 @@ muc_nick_in_roster(const char * const room, const char * const nick)
 {
     ChatRoom *chat_room = g_hash_table_lookup(rooms, room);
 
+    if ((chat_room != NULL) && chat_room->lurk) {
+        return g_hash_table_contains(chat_room->speaker_links, nick);
+    }
+
     if (chat_room != NULL) {
-        PContact contact = g_hash_table_lookup(chat_room->roster, nick);
-        if (contact != NULL) {
+        Occupant *occupant = g_hash_table_lookup(chat_room->roster, nick);
+        if (occupant != NULL) {
             return TRUE;
         } else {
             return FALSE;
@@ -285,31 +680,58 @@ muc_nick_in_roster(const char * const room, const char * const nick)
 }
 
 /*
- * Add a new chat room member to the room's roster
+ * Add a new chat room member to the room's roster, or update the existing
+ * member in place. Returns TRUE if the member is new, or their presence or
+ * status changed
  */
 gboolean
 muc_add_to_roster(const char * const room, const char * const nick,
     const char * const show, const char * const status,
-    const char * const caps_str)
+    const char * const caps_str, const char * const role,
+    const char * const affiliation, const char * const jid)
 {
     ChatRoom *chat_room = g_hash_table_lookup(rooms, room);
     gboolean updated = FALSE;
 
+    if ((chat_room != NULL) && chat_room->lurk) {
+        // without the nicks, a presence from anyone but a recent speaker
+        // counts as a join
+        if (g_hash_table_contains(chat_room->speaker_links, nick)) {
+            return FALSE;
+        }
+        chat_room->lurk_occupants++;
+        return TRUE;
+    }
+
     if (chat_room != NULL) {
-        PContact old = g_hash_table_lookup(chat_room->roster, nick);
+        Occupant *occupant = g_hash_table_lookup(chat_room->roster, nick);
+        resource_presence_t presence = resource_presence_from_string(show);
 
-        if (old == NULL) {
-            updated = TRUE;
-            autocomplete_add(chat_room->nick_ac, nick);
-        } else if ((g_strcmp0(p_contact_presence(old), show) != 0) ||
-                    (g_strcmp0(p_contact_status(old), status) != 0)) {
+        if (occupant == NULL) {
             updated = TRUE;
+            occupant = _occupant_new(nick, presence, status, caps_str);
+            g_hash_table_insert(chat_room->roster,
+                (gpointer)p_contact_barejid(occupant->contact), occupant);
+
+            // while joining, the index and completion are built in one pass
+            // when the roster is received
+            if (chat_room->roster_received) {
+                autocomplete_add(chat_room->nick_ac, nick);
+                g_sequence_insert_sorted(chat_room->sorted_roster,
+                    occupant->contact, (GCompareDataFunc)_compare_participants,
+                    NULL);
+            }
+        } else {
+            Resource *resource = occupant->resource;
+            if ((resource->presence != presence) ||
+                    (g_strcmp0(resource->status, status) != 0)) {
+                updated = TRUE;
+            }
+            resource_update(resource, presence, status, caps_str);
         }
-        PContact contact = p_contact_new(nick, NULL, NULL, NULL, NULL, FALSE);
-        resource_presence_t resource_presence = resource_presence_from_string(show);
-        Resource *resource = resource_new(nick, resource_presence, status, 0, caps_str);
-        p_contact_set_presence(contact, resource);
-        g_hash_table_replace(chat_room->roster, strdup(nick), contact);
+
+        _occupant_set_role(chat_room, occupant, role, affiliation);
+        _occupant_set_real_jid(chat_room, occupant, jid);
     }
 
     return updated;
@@ -323,9 +745,29 @@ muc_remove_from_roster(const char * const room, const char * const nick)
 {
     ChatRoom *chat_room = g_hash_table_lookup(rooms, room);
 
+    if ((chat_room != NULL) && chat_room->lurk) {
+        if (chat_room->lurk_occupants > 0) {
+            chat_room->lurk_occupants--;
+        }
+        _lurk_forget_speaker(chat_room, nick);
+        return;
+    }
+
     if (chat_room != NULL) {
+        Occupant *occupant = g_hash_table_lookup(chat_room->roster, nick);
+        if ((occupant != NULL) && chat_room->roster_received) {
+            GSequenceIter *iter = g_sequence_lookup(chat_room->sorted_roster,
+                occupant->contact, (GCompareDataFunc)_compare_participants,
+                NULL);
+            if (iter != NULL) {
+                g_sequence_remove(iter);
+            }
+            autocomplete_remove(chat_room->nick_ac, nick);
+        }
+        if (occupant != NULL) {
+            _unindex_occupant(chat_room, occupant);
+        }
         g_hash_table_remove(chat_room->roster, nick);
-        autocomplete_remove(chat_room->nick_ac, nick);
     }
 }
 
@@ -335,16 +777,141 @@ muc_get_participant(const char * const room, const char * const nick)
     ChatRoom *chat_room = g_hash_table_lookup(rooms, room);
 
     if (chat_room != NULL) {
-        PContact participant = g_hash_table_lookup(chat_room->roster, nick);
-        return participant;
+        Occupant *occupant = g_hash_table_lookup(chat_room->roster, nick);
+        if (occupant != NULL) {
+            return occupant->contact;
+        }
+    }
+
+    return NULL;
+}
+
+/*
+ * Return the room member's role, e.g. moderator, or NULL if not known
+ */
+const char *
+muc_get_participant_role(const char * const room, const char * const nick)
+{
+    ChatRoom *chat_room = g_hash_table_lookup(rooms, room);
+
+    if (chat_room != NULL) {
+        Occupant *occupant = g_hash_table_lookup(chat_room->roster, nick);
+        if (occupant != NULL) {
+            return occupant->role;
+        }
+    }
+
+    return NULL;
+}
+
+/*
+ * Return the room member's affiliation, e.g. owner, or NULL if not known
+ */
+const char *
+muc_get_participant_affiliation(const char * const room,
+    const char * const nick)
+{
+    ChatRoom *chat_room = g_hash_table_lookup(rooms, room);
+
+    if (chat_room != NULL) {
+        Occupant *occupant = g_hash_table_lookup(chat_room->roster, nick);
+        if (occupant != NULL) {
+            return occupant->affiliation;
+        }
+    }
+
+    return NULL;
+}
+
+/*
+ * Return the real bare jid of the occupant, or NULL if the room does not
+ * reveal it
+ */
+const char *
+muc_get_participant_real_jid(const char * const room, const char * const nick)
+{
+    ChatRoom *chat_room = g_hash_table_lookup(rooms, room);
+
+    if (chat_room != NULL) {
+        Occupant *occupant = g_hash_table_lookup(chat_room->roster, nick);
+        if (occupant != NULL) {
+            return occupant->real_jid;
+        }
     }
 
     return NULL;
 }
 
 /*
- * Return a list of PContacts representing the room members in the room's roster
- * The list is owned by the room and must not be mofified or freed
+ * Return the nicks of the room's occupants with the role, in order
+ * The list must be freed with g_list_free, the nicks are owned by the room
+ */
+GList *
+muc_get_occupants_by_role(const char * const room, const char * const role)
+{
+    ChatRoom *chat_room = g_hash_table_lookup(rooms, room);
+
+    if (chat_room != NULL) {
+        return _nick_index_get(chat_room->role_index, role);
+    } else {
+        return NULL;
+    }
+}
+
+GList *
+muc_get_occupants_by_affiliation(const char * const room,
+    const char * const affiliation)
+{
+    ChatRoom *chat_room = g_hash_table_lookup(rooms, room);
+
+    if (chat_room != NULL) {
+        return _nick_index_get(chat_room->affiliation_index, affiliation);
+    } else {
+        return NULL;
+    }
+}
+
+/*
+ * Return the occupant jids, room/nick, under which the real jid is present
+ * in any room, the list and its strings must be freed by the caller
+ */
+GList *
+muc_get_occupants_by_real_jid(const char * const jid)
+{
+    if (real_jids == NULL) {
+        return NULL;
+    }
+
+    Jid *jidp = jid_create(jid);
+    if (jidp == NULL) {
+        return NULL;
+    }
+
+    GList *result = NULL;
+    GHashTable *occupancies = g_hash_table_lookup(real_jids, jidp->barejid);
+    if (occupancies != NULL) {
+        GHashTableIter iter;
+        gpointer occupant;
+        gpointer room;
+        g_hash_table_iter_init(&iter, occupancies);
+        while (g_hash_table_iter_next(&iter, &occupant, &room)) {
+            Occupant *found = occupant;
+            GString *occupant_jid = g_string_new(room);
+            g_string_append_printf(occupant_jid, "/%s",
+                p_contact_barejid(found->contact));
+            result = g_list_insert_sorted(result,
+                g_string_free(occupant_jid, FALSE), (GCompareFunc)g_strcmp0);
+        }
+    }
+    jid_destroy(jidp);
+
+    return result;
+}
+
+/*
+ * Return a list of PContacts representing the room members in the room's
+ * roster, sorted by nick. The contacts are owned by the room and must not be
+ * modified or freed, the list should be freed with g_list_free
  */
 GList *
 muc_get_roster(const char * const room)
@@ -353,13 +920,12 @@ muc_get_roster(const char * const room)
 
     if (chat_room != NULL) {
         GList *result = NULL;
-        GHashTableIter iter;
-        gpointer key;
-        gpointer value;
 
-        g_hash_table_iter_init(&iter, chat_room->roster);
-        while (g_hash_table_iter_next(&iter, &key, &value)) {
-            result = g_list_insert_sorted(result, value, (GCompareFunc)_compare_participants);
+        // build from the end so each prepend is constant time
+        GSequenceIter *iter = g_sequence_get_end_iter(chat_room->sorted_roster);
+        while (!g_sequence_iter_is_begin(iter)) {
+            iter = g_sequence_iter_prev(iter);
+            result = g_list_prepend(result, g_sequence_get(iter));
         }
 
         return result;
@@ -384,14 +950,16 @@ muc_get_roster_ac(const char * const room)
 }
 
 /*
- * Set to TRUE when the rooms roster has been fully recieved
+ * Set to TRUE when the rooms roster has been fully recieved, the occupants
+ * received while joining are indexed and added to nick completion
  */
 void
 muc_set_roster_received(const char * const room)
 {
     ChatRoom *chat_room = g_hash_table_lookup(rooms, room);
 
-    if (chat_room != NULL) {
+    if ((chat_room != NULL) && !chat_room->roster_received) {
+        _index_roster(chat_room);
         chat_room->roster_received = TRUE;
     }
 }
@@ -458,35 +1026,314 @@ static void
 _free_room(ChatRoom *room)
 {
     if (room != NULL) {
-        free(room->room);
+        intern_release(room->room);
         free(room->nick);
         free(room->subject);
+        if (room->sorted_roster != NULL) {
+            g_sequence_free(room->sorted_roster);
+        }
         if (room->roster != NULL) {
+            GHashTableIter iter;
+            gpointer key;
+            gpointer value;
+            g_hash_table_iter_init(&iter, room->roster);
+            while (g_hash_table_iter_next(&iter, &key, &value)) {
+                _unindex_occupant(room, value);
+            }
             g_hash_table_remove_all(room->roster);
         }
+        g_hash_table_destroy(room->role_index);
+        g_hash_table_destroy(room->affiliation_index);
+        _lurk_stop(room);
         if (room->nick_ac != NULL) {
             autocomplete_free(room->nick_ac);
         }
         if (room->nick_changes != NULL) {
             g_hash_table_remove_all(room->nick_changes);
         }
+        highlighter_free(room->highlighter);
+        if (room->pending_digest != NULL) {
+            digest_rooms = g_slist_remove(digest_rooms, room->room);
+            muc_digest_free(room->pending_digest);
+        }
         free(room);
     }
 }
 
-static
-gint _compare_participants(PContact a, PContact b)
+/*
+ * Build the sorted roster and nick completion from every occupant, sorting
+ * once rather than inserting each occupant as their presence arrives
+ */
+static void
+_index_roster(ChatRoom *chat_room)
+{
+    GSList *nicks = NULL;
+    GHashTableIter iter;
+    gpointer key;
+    gpointer value;
+
+    g_hash_table_iter_init(&iter, chat_room->roster);
+    while (g_hash_table_iter_next(&iter, &key, &value)) {
+        Occupant *occupant = value;
+        g_sequence_append(chat_room->sorted_roster, occupant->contact);
+        nicks = g_slist_prepend(nicks, key);
+    }
+
+    g_sequence_sort(chat_room->sorted_roster,
+        (GCompareDataFunc)_compare_participants, NULL);
+    autocomplete_add_all(chat_room->nick_ac, nicks);
+    g_slist_free(nicks);
+}
+
+static Occupant *
+_occupant_new(const char * const nick, resource_presence_t presence,
+    const char * const status, const char * const caps_str)
+{
+    if (occupant_pool == NULL) {
+        occupant_pool = pool_new(sizeof(Occupant));
+    }
+    Occupant *occupant = pool_alloc(occupant_pool);
+    occupant->contact = p_contact_new(nick, NULL, NULL, NULL, NULL, FALSE);
+    occupant->resource = resource_new(nick, presence, status, 0, caps_str);
+    p_contact_set_presence(occupant->contact, occupant->resource);
+    occupant->role = NULL;
+    occupant->affiliation = NULL;
+    occupant->real_jid = NULL;
+
+    return occupant;
+}
+
+static void
+_occupant_set_role(ChatRoom *chat_room, Occupant *occupant,
+    const char * const role, const char * const affiliation)
+{
+    const char *nick = p_contact_barejid(occupant->contact);
+
+    if ((role != NULL) && (g_strcmp0(role, occupant->role) != 0)) {
+        const char *new_role = intern_str(role);
+        _nick_index_remove(chat_room->role_index, occupant->role, nick);
+        intern_release(occupant->role);
+        occupant->role = new_role;
+        _nick_index_add(chat_room->role_index, occupant->role, nick);
+    }
+
+    if ((affiliation != NULL) &&
+            (g_strcmp0(affiliation, occupant->affiliation) != 0)) {
+        const char *new_affiliation = intern_str(affiliation);
+        _nick_index_remove(chat_room->affiliation_index,
+            occupant->affiliation, nick);
+        intern_release(occupant->affiliation);
+        occupant->affiliation = new_affiliation;
+        _nick_index_add(chat_room->affiliation_index, occupant->affiliation,
+            nick);
+    }
+}
+
+/*
+ * Record the occupant's real jid, as a bare jid, when the room reveals it
+ */
+static void
+_occupant_set_real_jid(ChatRoom *chat_room, Occupant *occupant,
+    const char * const jid)
 {
-    const char * utf8_str_a = p_contact_barejid(a);
-    const char * utf8_str_b = p_contact_barejid(b);
+    if (jid == NULL) {
+        return;
+    }
+
+    Jid *jidp = jid_create(jid);
+    if (jidp == NULL) {
+        return;
+    }
 
-    gchar *key_a = g_utf8_collate_key(utf8_str_a, -1);
-    gchar *key_b = g_utf8_collate_key(utf8_str_b, -1);
+    if (g_strcmp0(jidp->barejid, occupant->real_jid) != 0) {
+        if (real_jids == NULL) {
+            real_jids = g_hash_table_new_full(g_str_hash, g_str_equal, NULL,
+                (GDestroyNotify)g_hash_table_destroy);
+        }
 
-    gint result = g_strcmp0(key_a, key_b);
+        const char *new_real_jid = intern_str(jidp->barejid);
+        _real_jid_index_remove(occupant);
+        intern_release(occupant->real_jid);
+        occupant->real_jid = new_real_jid;
+
+        GHashTable *occupancies = g_hash_table_lookup(real_jids,
+            occupant->real_jid);
+        if (occupancies == NULL) {
+            occupancies = g_hash_table_new(g_direct_hash, g_direct_equal);
+            g_hash_table_insert(real_jids, (gpointer)occupant->real_jid,
+                occupancies);
+        }
+        g_hash_table_insert(occupancies, occupant, (gpointer)chat_room->room);
+    }
 
-    g_free(key_a);
-    g_free(key_b);
+    jid_destroy(jidp);
+}
 
-    return result;
+/*
+ * Remove the occupant from the room's role and affiliation indexes, and
+ * from the real jid index, before it leaves the roster
+ */
+static void
+_unindex_occupant(ChatRoom *chat_room, Occupant *occupant)
+{
+    const char *nick = p_contact_barejid(occupant->contact);
+    _nick_index_remove(chat_room->role_index, occupant->role, nick);
+    _nick_index_remove(chat_room->affiliation_index, occupant->affiliation,
+        nick);
+
+    _real_jid_index_remove(occupant);
+}
+
+static void
+_real_jid_index_remove(Occupant *occupant)
+{
+    if ((occupant->real_jid == NULL) || (real_jids == NULL)) {
+        return;
+    }
+
+    GHashTable *occupancies = g_hash_table_lookup(real_jids,
+        occupant->real_jid);
+    if (occupancies != NULL) {
+        g_hash_table_remove(occupancies, occupant);
+        if (g_hash_table_size(occupancies) == 0) {
+            g_hash_table_remove(real_jids, occupant->real_jid);
+        }
+    }
+}
+
+/*
+ * Role and affiliation indexes map the interned value to a set of nicks,
+ * the value stays valid while any occupant in the set holds it
+ */
+static void
+_nick_index_add(GHashTable *index, const char * const key,
+    const char * const nick)
+{
+    GHashTable *nicks = g_hash_table_lookup(index, key);
+    if (nicks == NULL) {
+        nicks = g_hash_table_new(g_str_hash, g_str_equal);
+        g_hash_table_insert(index, (gpointer)key, nicks);
+    }
+    g_hash_table_add(nicks, (gpointer)nick);
+}
+
+static void
+_nick_index_remove(GHashTable *index, const char * const key,
+    const char * const nick)
+{
+    if (key == NULL) {
+        return;
+    }
+
+    GHashTable *nicks = g_hash_table_lookup(index, key);
+    if (nicks != NULL) {
+        g_hash_table_remove(nicks, nick);
+        if (g_hash_table_size(nicks) == 0) {
+            g_hash_table_remove(index, key);
+        }
+    }
+}
+
+static GList *
+_nick_index_get(GHashTable *index, const char * const key)
+{
+    GHashTable *nicks = g_hash_table_lookup(index, key);
+    if (nicks == NULL) {
+        return NULL;
+    }
+
+    GList *result = g_hash_table_get_keys(nicks);
+    return g_list_sort(result, (GCompareFunc)g_strcmp0);
+}
+
+static void
+_free_occupant(Occupant *occupant)
+{
+    if (occupant != NULL) {
+        // the resource is owned by the contact
+        p_contact_free(occupant->contact);
+        intern_release(occupant->role);
+        intern_release(occupant->affiliation);
+        intern_release(occupant->real_jid);
+        pool_free(occupant_pool, occupant);
+    }
+}
+
+/*
+ * Order room members by the collation key cached in their contact, falling
+ * back to the nick so that members with equal keys remain distinct
+ */
+static gint
+_compare_participants(PContact a, PContact b, gpointer data)
+{
+    gint result = strcmp(p_contact_collate_key(a), p_contact_collate_key(b));
+    if (result != 0) {
+        return result;
+    }
+
+    return strcmp(p_contact_barejid(a), p_contact_barejid(b));
+}
+
+static void
+_free_digest_line(DigestLine *line)
+{
+    free(line->nick);
+    free(line->message);
+    free(line);
+}
+
+/*
+ * Count the current occupants in place of the roster, which is dropped
+ * along with the indexes built from it
+ */
+static void
+_lurk_start(ChatRoom *chat_room)
+{
+    chat_room->lurk = TRUE;
+    chat_room->lurk_occupants = g_hash_table_size(chat_room->roster);
+    chat_room->speakers = g_queue_new();
+    chat_room->speaker_links = g_hash_table_new(g_str_hash, g_str_equal);
+
+    GHashTableIter iter;
+    gpointer key;
+    gpointer value;
+    g_hash_table_iter_init(&iter, chat_room->roster);
+    while (g_hash_table_iter_next(&iter, &key, &value)) {
+        _unindex_occupant(chat_room, value);
+    }
+
+    g_sequence_remove_range(g_sequence_get_begin_iter(chat_room->sorted_roster),
+        g_sequence_get_end_iter(chat_room->sorted_roster));
+    g_hash_table_remove_all(chat_room->roster);
+    autocomplete_clear(chat_room->nick_ac);
+}
+
+static void
+_lurk_stop(ChatRoom *chat_room)
+{
+    if (!chat_room->lurk) {
+        return;
+    }
+
+    chat_room->lurk = FALSE;
+    chat_room->lurk_occupants = 0;
+    g_hash_table_destroy(chat_room->speaker_links);
+    chat_room->speaker_links = NULL;
+    g_queue_free_full(chat_room->speakers, free);
+    chat_room->speakers = NULL;
+}
+
+static void
+_lurk_forget_speaker(ChatRoom *chat_room, const char * const nick)
+{
+    GList *link = g_hash_table_lookup(chat_room->speaker_links, nick);
+    if (link == NULL) {
+        return;
+    }
+
+    char *speaker = link->data;
+    g_hash_table_remove(chat_room->speaker_links, speaker);
+    g_queue_delete_link(chat_room->speakers, link);
+    autocomplete_remove(chat_room->nick_ac, speaker);
+    free(speaker);
 }
@@ -28,6 +28,21 @@
 #include "contact.h"
 #include "jid.h"
 #include "tools/autocomplete.h"
+#include "tools/highlight.h"
+
+// messages received in a digest mode room since they were last shown
+typedef struct muc_digest_line_t {
+    char *nick;
+    char *message;
+} DigestLine;
+
+typedef struct muc_digest_t {
+    int total;
+    int mentions;
+    GHashTable *counts; // nick to number of messages
+    GQueue *lines; // the most recent messages, oldest first
+    GTimer *timer;
+} RoomDigest;
 
 void muc_init(void);
 void muc_join_room(const char * const room, const char * const nick);
@@ -42,14 +57,44 @@ void muc_complete_room_nick_change(const char * const room,
     const char * const nick);
 char * muc_get_old_nick(const char * const room, const char * const new_nick);
 
+Highlighter muc_get_highlighter(const char * const room);
+void muc_highlights_changed(void);
+
+void muc_set_lurk(const char * const room, gboolean lurk);
+gboolean muc_get_lurk(const char * const room);
+gint muc_get_occupant_count(const char * const room);
+void muc_add_speaker(const char * const room, const char * const nick);
+GList * muc_get_speakers(const char * const room);
+
+void muc_set_digest(const char * const room, gboolean digest);
+gboolean muc_get_digest(const char * const room);
+void muc_digest_add(const char * const room, const char * const nick,
+    const char * const message);
+gboolean muc_digest_due(const char * const room, gdouble interval);
+RoomDigest * muc_take_digest(const char * const room);
+GSList * muc_get_pending_digest_rooms(void);
+void muc_digest_free(RoomDigest *digest);
+
 gboolean muc_add_to_roster(const char * const room, const char * const nick,
     const char * const show, const char * const status,
-    const char * const caps_str);
+    const char * const caps_str, const char * const role,
+    const char * const affiliation, const char * const jid);
 void muc_remove_from_roster(const char * const room, const char * const nick);
 GList * muc_get_roster(const char * const room);
 Autocomplete muc_get_roster_ac(const char * const room);
 gboolean muc_nick_in_roster(const char * const room, const char * const nick);
 PContact muc_get_participant(const char * const room, const char * const nick);
+const char * muc_get_participant_role(const char * const room,
+    const char * const nick);
+const char * muc_get_participant_affiliation(const char * const room,
+    const char * const nick);
+const char * muc_get_participant_real_jid(const char * const room,
+    const char * const nick);
+GList * muc_get_occupants_by_role(const char * const room,
+    const char * const role);
+GList * muc_get_occupants_by_affiliation(const char * const room,
+    const char * const affiliation);
+GList * muc_get_occupants_by_real_jid(const char * const jid);
 void muc_set_roster_received(const char * const room);
 gboolean muc_get_roster_received(const char * const room);
 
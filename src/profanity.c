@@ -45,18 +45,74 @@
 #include "log.h"
 #include "muc.h"
 #include "resource.h"
+#include "room_list.h"
 #include "ui/notifier.h"
 #include "ui/ui.h"
 #include "xmpp/xmpp.h"
+#include "xmpp/bookmark.h"
+
+// presence notifications received within this many seconds of each other
+// are shown together
+#define PRESENCE_COALESCE_SECS 1.0
+
+// more notifications than this are shown as a summary
+#define PRESENCE_SUMMARY_THRESHOLD 5
+
+typedef struct presence_notification_t {
+    gboolean online;
+    char *barejid;
+    char *resource;
+    char *show;
+    char *status;
+    GDateTime *last_activity;
+} PresenceNotification;
+
+// delayed room messages are shown once no more have arrived for this long
+#define ROOM_HISTORY_FLUSH_SECS 1.0
+
+typedef struct room_history_message_t {
+    char *nick;
+    GTimeVal tv_stamp;
+    char *message;
+} RoomHistoryMessage;
+
+typedef struct room_history_t {
+    GSList *messages;
+    GTimer *timer;
+} RoomHistory;
 
 static gboolean _process_input(char *inp);
 static void _handle_idle_time(void);
+static void _queue_presence_notification(gboolean online,
+    const char * const barejid, const char * const resource,
+    const char * const show, const char * const status,
+    GDateTime *last_activity);
+static void _flush_presence_notifications(void);
+static void _clear_presence_notifications(void);
+static void _update_contact_counts(void);
+static void _free_presence_notification(PresenceNotification *notification);
+static void _queue_room_history(const char * const room_jid,
+    const char * const nick, GTimeVal tv_stamp, const char * const message);
+static void _flush_room_history(const char * const room_jid);
+static void _flush_stale_room_history(void);
+static void _free_room_history(RoomHistory *history);
+static void _free_room_history_message(RoomHistoryMessage *message);
+static void _flush_room_digest(const char * const room_jid);
+static void _flush_due_room_digests(void);
 static void _init(const int disable_tls, char *log_level);
 static void _shutdown(void);
 static void _create_directories(void);
 
 static gboolean idle = FALSE;
 
+// presence notifications not yet shown, most recent first
+static GSList *pending_presences = NULL;
+static GTimer *pending_presences_timer = NULL;
+static gboolean presence_this_tick = FALSE;
+
+// delayed room messages not yet shown, most recent first, indexed on room
+static GHashTable *pending_history = NULL;
+
 void
 prof_run(const int disable_tls, char *log_level)
 {
@@ -91,6 +147,9 @@ prof_run(const int disable_tls, char *log_level)
             ui_handle_special_keys(&ch, inp, size);
             ui_refresh();
             jabber_process_events();
+            _flush_presence_notifications();
+            _flush_stale_room_history();
+            _flush_due_room_digests();
 
             ch = inp_get_char(inp, &size);
             if (ch != ERR) {
@@ -184,6 +243,30 @@ prof_handle_group_remove(const char * const contact,
     ui_current_page_off();
 }
 
+void
+prof_handle_roster_bulk_progress(const char * const description,
+    const int done, const int total)
+{
+    ui_roster_bulk_progress(description, done, total);
+    ui_current_page_off();
+}
+
+void
+prof_handle_autojoin_progress(const int done, const int total)
+{
+    ui_autojoin_progress(done, total);
+    ui_current_page_off();
+}
+
+void
+prof_handle_roster_bulk_complete(const char * const description,
+    const int succeeded, const int failed)
+{
+    ui_roster_bulk_complete(description, succeeded, failed);
+    _update_contact_counts();
+    ui_current_page_off();
+}
+
 void
 prof_handle_error_message(const char *from, const char *err_msg)
 {
@@ -208,6 +291,15 @@ prof_handle_error_message(const char *from, const char *err_msg)
     }
 
     ui_print_error_from_recipient(from, err_msg);
+
+    // a room that could not be joined frees its autojoin slot straight away
+    if (from != NULL) {
+        Jid *from_jid = jid_create(from);
+        if (from_jid != NULL) {
+            bookmark_autojoin_complete(from_jid->barejid);
+            jid_destroy(from_jid);
+        }
+    }
 }
 
 void
@@ -246,6 +338,7 @@ void
 prof_handle_roster_add(const char * const barejid, const char * const name)
 {
     ui_roster_add(barejid, name);
+    _update_contact_counts();
     ui_current_page_off();
 }
 
@@ -253,6 +346,14 @@ void
 prof_handle_roster_remove(const char * const barejid)
 {
     ui_roster_remove(barejid);
+    _update_contact_counts();
+    ui_current_page_off();
+}
+
+void
+prof_handle_roster_received(void)
+{
+    _update_contact_counts();
     ui_current_page_off();
 }
 
@@ -291,7 +392,13 @@ void
 prof_handle_lost_connection(void)
 {
     cons_show_error("Lost connection.");
-    roster_clear();
+    _clear_presence_notifications();
+    if (pending_history != NULL) {
+        g_hash_table_remove_all(pending_history);
+    }
+    roster_set_stale();
+    prefs_flush();
+    _update_contact_counts();
     muc_clear_invites();
     chat_sessions_clear();
     ui_disconnected();
@@ -303,7 +410,14 @@ prof_handle_disconnect(const char * const jid)
 {
     cons_show("%s logged out successfully.", jid);
     jabber_disconnect();
+    _clear_presence_notifications();
+    if (pending_history != NULL) {
+        g_hash_table_remove_all(pending_history);
+    }
+    // the roster is only kept to reconcile after a lost connection
     roster_clear();
+    prefs_flush();
+    _update_contact_counts();
     muc_clear_invites();
     chat_sessions_clear();
     ui_disconnected();
@@ -314,16 +428,24 @@ void
 prof_handle_room_history(const char * const room_jid, const char * const nick,
     GTimeVal tv_stamp, const char * const message)
 {
-    ui_room_history(room_jid, nick, tv_stamp, message);
-    ui_current_page_off();
+    _queue_room_history(room_jid, nick, tv_stamp, message);
 }
 
 void
 prof_handle_room_message(const char * const room_jid, const char * const nick,
     const char * const message)
 {
-    ui_room_message(room_jid, nick, message);
-    ui_current_page_off();
+    _flush_room_history(room_jid);
+    muc_add_speaker(room_jid, nick);
+
+    // rooms in digest mode only render while focused
+    if (muc_get_digest(room_jid) && !ui_room_is_current(room_jid)) {
+        muc_digest_add(room_jid, nick, message);
+    } else {
+        _flush_room_digest(room_jid);
+        ui_room_message(room_jid, nick, message);
+        ui_current_page_off();
+    }
 
     if (prefs_get_boolean(PREF_GRLOG)) {
         Jid *jid = jid_create(jabber_get_fulljid());
@@ -335,6 +457,7 @@ prof_handle_room_message(const char * const room_jid, const char * const nick,
 void
 prof_handle_room_subject(const char * const room_jid, const char * const subject)
 {
+    _flush_room_history(room_jid);
     ui_room_subject(room_jid, subject);
     ui_current_page_off();
 }
@@ -351,19 +474,28 @@ void
 prof_handle_room_roster_complete(const char * const room)
 {
     muc_set_roster_received(room);
-    GList *roster = muc_get_roster(room);
-    ui_room_roster(room, roster, NULL);
+    if (muc_get_lurk(room)) {
+        ui_room_lurking(room);
+    } else {
+        GList *roster = muc_get_roster(room);
+        ui_room_roster(room, roster, NULL);
+        g_list_free(roster);
+    }
     ui_current_page_off();
+    bookmark_autojoin_complete(room);
 }
 
 void
 prof_handle_room_member_presence(const char * const room,
     const char * const nick, const char * const show,
-    const char * const status, const char * const caps_str)
+    const char * const status, const char * const caps_str,
+    const char * const role, const char * const affiliation,
+    const char * const real_jid)
 {
-    gboolean updated = muc_add_to_roster(room, nick, show, status, caps_str);
+    gboolean updated = muc_add_to_roster(room, nick, show, status, caps_str,
+        role, affiliation, real_jid);
 
-    if (updated) {
+    if (updated && !muc_get_lurk(room)) {
         ui_room_member_presence(room, nick, show, status);
         ui_current_page_off();
     }
@@ -372,11 +504,17 @@ prof_handle_room_member_presence(const char * const room,
 void
 prof_handle_room_member_online(const char * const room, const char * const nick,
     const char * const show, const char * const status,
-    const char * const caps_str)
+    const char * const caps_str, const char * const role,
+    const char * const affiliation, const char * const real_jid)
 {
-    muc_add_to_roster(room, nick, show, status, caps_str);
-    ui_room_member_online(room, nick, show, status);
-    ui_current_page_off();
+    muc_add_to_roster(room, nick, show, status, caps_str, role, affiliation,
+        real_jid);
+
+    // presence in lurked rooms is only counted
+    if (!muc_get_lurk(room)) {
+        ui_room_member_online(room, nick, show, status);
+        ui_current_page_off();
+    }
 }
 
 void
@@ -384,13 +522,18 @@ prof_handle_room_member_offline(const char * const room, const char * const nick
     const char * const show, const char * const status)
 {
     muc_remove_from_roster(room, nick);
-    ui_room_member_offline(room, nick);
-    ui_current_page_off();
+    if (!muc_get_lurk(room)) {
+        ui_room_member_offline(room, nick);
+        ui_current_page_off();
+    }
 }
 
 void
 prof_handle_leave_room(const char * const room)
 {
+    if (pending_history != NULL) {
+        g_hash_table_remove(pending_history, room);
+    }
     muc_leave_room(room);
 }
 
@@ -414,12 +557,13 @@ prof_handle_contact_online(char *contact, Resource *resource,
     gboolean updated = roster_update_presence(contact, resource, last_activity);
 
     if (updated) {
+        _update_contact_counts();
         PContact result = roster_get_contact(contact);
         if (p_contact_subscription(result) != NULL) {
             if (strcmp(p_contact_subscription(result), "none") != 0) {
                 const char *show = string_from_resource_presence(resource->presence);
-                ui_contact_online(contact, resource->name, show, resource->status, last_activity);
-                ui_current_page_off();
+                _queue_presence_notification(TRUE, contact, resource->name,
+                    show, resource->status, last_activity);
             }
         }
     }
@@ -429,17 +573,18 @@ void
 prof_handle_contact_offline(char *contact, char *resource, char *status)
 {
     gboolean updated = roster_contact_offline(contact, resource, status);
+    if (updated) {
+        _update_contact_counts();
+    }
 
     if (resource != NULL && updated) {
-        Jid *jid = jid_create_from_bare_and_resource(contact, resource);
         PContact result = roster_get_contact(contact);
         if (p_contact_subscription(result) != NULL) {
             if (strcmp(p_contact_subscription(result), "none") != 0) {
-                ui_contact_offline(jid->fulljid, "offline", status);
-                ui_current_page_off();
+                _queue_presence_notification(FALSE, contact, resource,
+                    "offline", status, NULL);
             }
         }
-        jid_destroy(jid);
     }
 }
 
@@ -447,8 +592,10 @@ void
 prof_handle_room_member_nick_change(const char * const room,
     const char * const old_nick, const char * const nick)
 {
-    ui_room_member_nick_change(room, old_nick, nick);
-    ui_current_page_off();
+    if (!muc_get_lurk(room)) {
+        ui_room_member_nick_change(room, old_nick, nick);
+        ui_current_page_off();
+    }
 }
 
 void
@@ -493,9 +640,24 @@ prof_handle_version_result(const char * const jid, const char * const  presence,
 }
 
 void
-prof_handle_room_list(GSList *rooms, const char *conference_node)
+prof_handle_room_list_page(GSList *rooms, const char *conference_node,
+    int count)
+{
+    room_list_add(conference_node, rooms);
+    ui_room_list_progress(conference_node, room_list_count(conference_node),
+        count);
+    ui_current_page_off();
+}
+
+void
+prof_handle_room_list_complete(const char *conference_node)
 {
-    cons_show_room_list(rooms, conference_node);
+    room_list_complete(conference_node);
+
+    gint total = 0;
+    GList *rooms = room_list_get_page(conference_node, NULL, 0, &total);
+    ui_room_list_results(conference_node, rooms, NULL, 0, total);
+    g_list_free(rooms);
     ui_current_page_off();
 }
 
@@ -655,7 +817,15 @@ _shutdown(void)
 {
     jabber_disconnect();
     jabber_shutdown();
+    _clear_presence_notifications();
+    if (pending_presences_timer != NULL) {
+        g_timer_destroy(pending_presences_timer);
+    }
+    if (pending_history != NULL) {
+        g_hash_table_destroy(pending_history);
+    }
     roster_free();
+    room_list_clear();
     caps_close();
     ui_close();
     chat_log_close();
@@ -666,6 +836,294 @@ _shutdown(void)
     log_close();
 }
 
+/*
+ * Roster presence changes are applied as they arrive, but their
+ * notifications are queued and shown once a burst has stopped arriving
+ */
+static void
+_queue_presence_notification(gboolean online, const char * const barejid,
+    const char * const resource, const char * const show,
+    const char * const status, GDateTime *last_activity)
+{
+    PresenceNotification *notification = malloc(sizeof(PresenceNotification));
+    notification->online = online;
+    notification->barejid = strdup(barejid);
+    notification->resource = strdup(resource);
+    notification->show = strdup(show);
+    if (status != NULL) {
+        notification->status = strdup(status);
+    } else {
+        notification->status = NULL;
+    }
+    if (last_activity != NULL) {
+        notification->last_activity = g_date_time_ref(last_activity);
+    } else {
+        notification->last_activity = NULL;
+    }
+
+    if (pending_presences == NULL) {
+        if (pending_presences_timer == NULL) {
+            pending_presences_timer = g_timer_new();
+        } else {
+            g_timer_start(pending_presences_timer);
+        }
+    }
+
+    pending_presences = g_slist_prepend(pending_presences, notification);
+    presence_this_tick = TRUE;
+}
+
+/*
+ * Called once per main loop tick, shows the queued notifications when no
+ * presence arrived during the tick, or when the oldest has waited long
+ * enough. Large bursts are shown as a summary.
+ */
+static void
+_flush_presence_notifications(void)
+{
+    if (pending_presences == NULL) {
+        return;
+    }
+
+    if (presence_this_tick &&
+            (g_timer_elapsed(pending_presences_timer, NULL) < PRESENCE_COALESCE_SECS)) {
+        presence_this_tick = FALSE;
+        return;
+    }
+    presence_this_tick = FALSE;
+
+    GSList *notifications = g_slist_reverse(pending_presences);
+    pending_presences = NULL;
+
+    // large bursts are summarised in the console, counting each contact
+    // once by its latest change, open chat windows still show every change
+    gboolean summarise =
+        (g_slist_length(notifications) > PRESENCE_SUMMARY_THRESHOLD);
+    GHashTable *latest = g_hash_table_new(g_str_hash, g_str_equal);
+
+    GSList *curr = notifications;
+    while (curr != NULL) {
+        PresenceNotification *notification = curr->data;
+
+        // the contact may have been removed while queued
+        if (roster_get_contact(notification->barejid) != NULL) {
+            if (notification->online) {
+                ui_contact_online(notification->barejid,
+                    notification->resource, notification->show,
+                    notification->status, notification->last_activity,
+                    !summarise);
+            } else {
+                Jid *jid = jid_create_from_bare_and_resource(
+                    notification->barejid, notification->resource);
+                ui_contact_offline(jid->fulljid, notification->show,
+                    notification->status, !summarise);
+                jid_destroy(jid);
+            }
+            g_hash_table_insert(latest, notification->barejid, notification);
+        }
+        curr = g_slist_next(curr);
+    }
+
+    if (summarise) {
+        int online = 0;
+        int offline = 0;
+        GList *changes = g_hash_table_get_values(latest);
+        GList *change = changes;
+        while (change != NULL) {
+            PresenceNotification *notification = change->data;
+            if (notification->online) {
+                online++;
+            } else {
+                offline++;
+            }
+            change = g_list_next(change);
+        }
+        g_list_free(changes);
+        ui_contacts_presence_summary(online, offline);
+    }
+    g_hash_table_destroy(latest);
+
+    ui_current_page_off();
+    g_slist_free_full(notifications,
+        (GDestroyNotify)_free_presence_notification);
+}
+
+static void
+_clear_presence_notifications(void)
+{
+    g_slist_free_full(pending_presences,
+        (GDestroyNotify)_free_presence_notification);
+    pending_presences = NULL;
+    presence_this_tick = FALSE;
+}
+
+/*
+ * Show the number of contacts online in the title bar, the counts are read
+ * from the roster's presence buckets
+ */
+static void
+_update_contact_counts(void)
+{
+    title_bar_set_contacts(roster_count_by_presence("online"),
+        roster_count_by_presence("any"));
+}
+
+static void
+_free_presence_notification(PresenceNotification *notification)
+{
+    free(notification->barejid);
+    free(notification->resource);
+    free(notification->show);
+    free(notification->status);
+    if (notification->last_activity != NULL) {
+        g_date_time_unref(notification->last_activity);
+    }
+    free(notification);
+}
+
+/*
+ * Delayed messages replayed when joining a room are held until the room's
+ * first live message or subject, and then shown in one pass
+ */
+static void
+_queue_room_history(const char * const room_jid, const char * const nick,
+    GTimeVal tv_stamp, const char * const message)
+{
+    if (pending_history == NULL) {
+        pending_history = g_hash_table_new_full(g_str_hash, g_str_equal, free,
+            (GDestroyNotify)_free_room_history);
+    }
+
+    RoomHistory *history = g_hash_table_lookup(pending_history, room_jid);
+    if (history == NULL) {
+        history = malloc(sizeof(RoomHistory));
+        history->messages = NULL;
+        history->timer = g_timer_new();
+        g_hash_table_insert(pending_history, strdup(room_jid), history);
+    } else {
+        g_timer_start(history->timer);
+    }
+
+    RoomHistoryMessage *history_message = malloc(sizeof(RoomHistoryMessage));
+    history_message->nick = strdup(nick);
+    history_message->tv_stamp = tv_stamp;
+    history_message->message = strdup(message);
+    history->messages = g_slist_prepend(history->messages, history_message);
+}
+
+static void
+_flush_room_history(const char * const room_jid)
+{
+    if (pending_history == NULL) {
+        return;
+    }
+
+    RoomHistory *history = g_hash_table_lookup(pending_history, room_jid);
+    if (history == NULL) {
+        return;
+    }
+
+    history->messages = g_slist_reverse(history->messages);
+    GSList *curr = history->messages;
+    while (curr != NULL) {
+        RoomHistoryMessage *message = curr->data;
+        ui_room_history(room_jid, message->nick, message->tv_stamp,
+            message->message);
+        curr = g_slist_next(curr);
+    }
+
+    g_hash_table_remove(pending_history, room_jid);
+    ui_current_page_off();
+}
+
+/*
+ * Called once per main loop tick, shows the history of rooms which have had
+ * no live message or subject once the replay has stopped arriving
+ */
+static void
+_flush_stale_room_history(void)
+{
+    if ((pending_history == NULL) || (g_hash_table_size(pending_history) == 0)) {
+        return;
+    }
+
+    GSList *stale = NULL;
+    GHashTableIter iter;
+    gpointer key;
+    gpointer value;
+
+    g_hash_table_iter_init(&iter, pending_history);
+    while (g_hash_table_iter_next(&iter, &key, &value)) {
+        RoomHistory *history = value;
+        if (g_timer_elapsed(history->timer, NULL) >= ROOM_HISTORY_FLUSH_SECS) {
+            stale = g_slist_prepend(stale, strdup(key));
+        }
+    }
+
+    GSList *curr = stale;
+    while (curr != NULL) {
+        _flush_room_history(curr->data);
+        curr = g_slist_next(curr);
+    }
+    g_slist_free_full(stale, free);
+}
+
+static void
+_free_room_history(RoomHistory *history)
+{
+    g_slist_free_full(history->messages,
+        (GDestroyNotify)_free_room_history_message);
+    g_timer_destroy(history->timer);
+    free(history);
+}
+
+static void
+_free_room_history_message(RoomHistoryMessage *message)
+{
+    free(message->nick);
+    free(message->message);
+    free(message);
+}
+
+static void
+_flush_room_digest(const char * const room_jid)
+{
+    RoomDigest *digest = muc_take_digest(room_jid);
+    if (digest == NULL) {
+        return;
+    }
+
+    ui_room_digest(room_jid, digest);
+    muc_digest_free(digest);
+    ui_current_page_off();
+}
+
+/*
+ * Called once per main loop tick, shows the digest of each room whose
+ * interval has passed, or whose window has been focused, only rooms with
+ * a digest waiting are checked
+ */
+static void
+_flush_due_room_digests(void)
+{
+    GSList *rooms = muc_get_pending_digest_rooms();
+    if (rooms == NULL) {
+        return;
+    }
+
+    gdouble interval = prefs_get_digest_interval();
+    GSList *curr = rooms;
+    while (curr != NULL) {
+        char *room = curr->data;
+        if (muc_digest_due(room, interval) ||
+                (ui_room_is_current(room) && muc_digest_due(room, 0))) {
+            _flush_room_digest(room);
+        }
+        curr = g_slist_next(curr);
+    }
+    g_slist_free(rooms);
+}
+
 static void
 _create_directories(void)
 {
@@ -678,6 +1136,10 @@ _create_directories(void)
     g_string_append(chatlogs_dir, "/profanity/chatlogs");
     GString *logs_dir = g_string_new(xdg_data);
     g_string_append(logs_dir, "/profanity/logs");
+    GString *rosters_dir = g_string_new(xdg_data);
+    g_string_append(rosters_dir, "/profanity/rosters");
+    GString *roomlists_dir = g_string_new(xdg_data);
+    g_string_append(roomlists_dir, "/profanity/roomlists");
 
     if (!mkdir_recursive(themes_dir->str)) {
         log_error("Error while creating directory %s", themes_dir->str);
@@ -688,10 +1150,18 @@ _create_directories(void)
     if (!mkdir_recursive(logs_dir->str)) {
         log_error("Error while creating directory %s", logs_dir->str);
     }
+    if (!mkdir_recursive(rosters_dir->str)) {
+        log_error("Error while creating directory %s", rosters_dir->str);
+    }
+    if (!mkdir_recursive(roomlists_dir->str)) {
+        log_error("Error while creating directory %s", roomlists_dir->str);
+    }
 
     g_string_free(themes_dir, TRUE);
     g_string_free(chatlogs_dir, TRUE);
     g_string_free(logs_dir, TRUE);
+    g_string_free(rosters_dir, TRUE);
+    g_string_free(roomlists_dir, TRUE);
 
     g_free(xdg_config);
     g_free(xdg_data);
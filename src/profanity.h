@@ -53,12 +53,15 @@ void prof_handle_room_subject(const char * const room_jid,
 void prof_handle_room_roster_complete(const char * const room);
 void prof_handle_room_member_online(const char * const room,
     const char * const nick, const char * const show, const char * const status,
-    const char * const caps_str);
+    const char * const caps_str, const char * const role,
+    const char * const affiliation, const char * const real_jid);
 void prof_handle_room_member_offline(const char * const room,
     const char * const nick, const char * const show, const char * const status);
 void prof_handle_room_member_presence(const char * const room,
     const char * const nick, const char * const show,
-    const char * const status, const char * const caps_str);
+    const char * const status, const char * const caps_str,
+    const char * const role, const char * const affiliation,
+    const char * const real_jid);
 void prof_handle_leave_room(const char * const room);
 void prof_handle_room_member_nick_change(const char * const room,
     const char * const old_nick, const char * const nick);
@@ -74,7 +77,9 @@ void prof_handle_activity(void);
 void prof_handle_version_result(const char * const jid,
     const char * const presence, const char * const name,
     const char * const version, const char * const os);
-void prof_handle_room_list(GSList *rooms, const char *conference_node);
+void prof_handle_room_list_page(GSList *rooms, const char *conference_node,
+    int count);
+void prof_handle_room_list_complete(const char *conference_node);
 void prof_handle_disco_items(GSList *items, const char *jid);
 void prof_handle_disco_info(const char *from, GSList *identities,
     GSList *features);
@@ -82,9 +87,15 @@ void prof_handle_duck_help(const char * const result);
 void prof_handle_duck_result(const char * const result);
 void prof_handle_roster_add(const char * const barejid, const char * const name);
 void prof_handle_roster_remove(const char * const barejid);
+void prof_handle_roster_received(void);
 void prof_handle_already_in_group(const char * const contact, const char * const group);
 void prof_handle_not_in_group(const char * const contact, const char * const group);
 void prof_handle_group_add(const char * const contact, const char * const group);
 void prof_handle_group_remove(const char * const contact, const char * const group);
+void prof_handle_roster_bulk_progress(const char * const description,
+    const int done, const int total);
+void prof_handle_roster_bulk_complete(const char * const description,
+    const int succeeded, const int failed);
+void prof_handle_autojoin_progress(const int done, const int total);
 
 #endif
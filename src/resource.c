@@ -26,13 +26,22 @@
 
 #include <common.h>
 #include <resource.h>
+#include <tools/intern.h>
+#include <tools/pool.h>
+
+// resources are created for every presence of a new resource or occupant,
+// so reuse their memory
+static Pool resource_pool = NULL;
 
 Resource * resource_new(const char * const name, resource_presence_t presence,
     const char * const status, const int priority, const char * const caps_str)
 {
     assert(name != NULL);
-    Resource *new_resource = malloc(sizeof(struct resource_t));
-    new_resource->name = strdup(name);
+    if (resource_pool == NULL) {
+        resource_pool = pool_new(sizeof(struct resource_t));
+    }
+    Resource *new_resource = pool_alloc(resource_pool);
+    new_resource->name = intern_str(name);
     new_resource->presence = presence;
     if (status != NULL) {
         new_resource->status = strdup(status);
@@ -40,15 +49,37 @@ Resource * resource_new(const char * const name, resource_presence_t presence,
         new_resource->status = NULL;
     }
     new_resource->priority = priority;
-    if (caps_str != NULL) {
-        new_resource->caps_str = strdup(caps_str);
-    } else {
-        new_resource->caps_str = NULL;
-    }
+    new_resource->caps_str = intern_str(caps_str);
 
     return new_resource;
 }
 
+/*
+ * Update the resource's presence and status in place, the capabilities are
+ * only replaced when caps_str is not NULL
+ */
+void
+resource_update(Resource *resource, resource_presence_t presence,
+    const char * const status, const char * const caps_str)
+{
+    resource->presence = presence;
+
+    if (g_strcmp0(resource->status, status) != 0) {
+        free(resource->status);
+        if (status != NULL) {
+            resource->status = strdup(status);
+        } else {
+            resource->status = NULL;
+        }
+    }
+
+    if (caps_str != NULL) {
+        const char *new_caps_str = intern_str(caps_str);
+        intern_release(resource->caps_str);
+        resource->caps_str = new_caps_str;
+    }
+}
+
 int
 resource_compare_availability(Resource *first, Resource *second)
 {
@@ -82,9 +113,9 @@ resource_compare_availability(Resource *first, Resource *second)
 void resource_destroy(Resource *resource)
 {
     if (resource != NULL) {
-        free(resource->name);
+        intern_release(resource->name);
         free(resource->status);
-        free(resource->caps_str);
-        free(resource);
+        intern_release(resource->caps_str);
+        pool_free(resource_pool, resource);
     }
 }
@@ -26,15 +26,17 @@
 #include "common.h"
 
 typedef struct resource_t {
-    char *name;
+    const char *name;
     resource_presence_t presence;
     char *status;
     int priority;
-    char *caps_str;
+    const char *caps_str;
 } Resource;
 
 Resource * resource_new(const char * const name, resource_presence_t presence,
     const char * const status, const int priority, const char * const caps_str);
+void resource_update(Resource *resource, resource_presence_t presence,
+    const char * const status, const char * const caps_str);
 void resource_destroy(Resource *resource);
 
 int resource_compare_availability(Resource *first, Resource *second);
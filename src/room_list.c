@@ -0,0 +1,401 @@
+/*
+ * room_list.c
+ *
+ * Copyright (C) 2012, 2013 James Booth <boothj5@gmail.com>
+ *
+ * This file is part of Profanity.
+ *
+ * Profanity is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Profanity is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Profanity.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <glib.h>
+
+#include "common.h"
+#include "jid.h"
+#include "log.h"
+#include "room_list.h"
+
+// the chat rooms at a conference service, in the order they were received
+typedef struct room_list_t {
+    GPtrArray *items;
+    GPtrArray *search_keys; // lower case jid and name of each item
+    time_t fetched; // 0 until the listing is complete
+} RoomList;
+
+// room lists by the lower case bare jid of the service, loaded from the
+// cache when first needed
+static GHashTable *room_lists = NULL;
+
+static RoomList * _room_list_new(void);
+static void _room_list_append(RoomList *list, const char * const jid,
+    const char * const name);
+static void _room_list_free(RoomList *list);
+static gchar * _service_key(const char * const service);
+static RoomList * _room_list_get(const char * const service);
+static RoomList * _room_list_load(const char * const service);
+static void _room_list_save(const char * const service, RoomList *list);
+static gchar * _get_room_list_file(const char * const service);
+static void _item_destroy(DiscoItem *item);
+
+/*
+ * Discard any listing of the service, ready for its pages to be added
+ */
+void
+room_list_start(const char * const service)
+{
+    gchar *key = _service_key(service);
+    if (key == NULL) {
+        return;
+    }
+
+    if (room_lists == NULL) {
+        room_lists = g_hash_table_new_full(g_str_hash, g_str_equal, g_free,
+            (GDestroyNotify)_room_list_free);
+    }
+
+    g_hash_table_replace(room_lists, key, _room_list_new());
+}
+
+void
+room_list_add(const char * const service, GSList *items)
+{
+    gchar *key = _service_key(service);
+    if ((room_lists == NULL) || (key == NULL)) {
+        g_free(key);
+        return;
+    }
+
+    RoomList *list = g_hash_table_lookup(room_lists, key);
+    g_free(key);
+    if (list == NULL) {
+        return;
+    }
+
+    while (items != NULL) {
+        DiscoItem *item = items->data;
+        _room_list_append(list, item->jid, item->name);
+        items = g_slist_next(items);
+    }
+}
+
+/*
+ * Mark the listing of the service as complete and write it to the cache
+ */
+void
+room_list_complete(const char * const service)
+{
+    gchar *key = _service_key(service);
+    if ((room_lists == NULL) || (key == NULL)) {
+        g_free(key);
+        return;
+    }
+
+    RoomList *list = g_hash_table_lookup(room_lists, key);
+    if (list != NULL) {
+        list->fetched = time(NULL);
+        _room_list_save(key, list);
+    }
+    g_free(key);
+}
+
+/*
+ * Returns TRUE if a complete listing of the service was fetched within
+ * the last ROOM_LIST_TTL seconds
+ */
+gboolean
+room_list_is_fresh(const char * const service)
+{
+    RoomList *list = _room_list_get(service);
+    if ((list == NULL) || (list->fetched == 0)) {
+        return FALSE;
+    }
+
+    return (difftime(time(NULL), list->fetched) < ROOM_LIST_TTL);
+}
+
+gint
+room_list_count(const char * const service)
+{
+    RoomList *list = _room_list_get(service);
+    if (list == NULL) {
+        return 0;
+    } else {
+        return list->items->len;
+    }
+}
+
+/*
+ * Return the rooms on the page, counted from 0, of the rooms at the service,
+ * or of those matching the search string when it is not NULL, setting total
+ * to the number of rooms on all pages
+ * The list must be freed with g_list_free, the items are owned by the cache
+ */
+GList *
+room_list_get_page(const char * const service, const char * const search,
+    const gint page, gint *total)
+{
+    *total = 0;
+    RoomList *list = _room_list_get(service);
+    if (list == NULL) {
+        return NULL;
+    }
+
+    gchar *search_key = NULL;
+    if (search != NULL) {
+        search_key = g_utf8_strdown(search, -1);
+    }
+
+    gint first = page * ROOM_LIST_PAGE_SIZE;
+    GList *result = NULL;
+    guint i;
+    for (i = 0; i < list->items->len; i++) {
+        if ((search_key != NULL) &&
+                (strstr(g_ptr_array_index(list->search_keys, i), search_key) == NULL)) {
+            continue;
+        }
+        if ((*total >= first) && (*total < first + ROOM_LIST_PAGE_SIZE)) {
+            result = g_list_prepend(result, g_ptr_array_index(list->items, i));
+        }
+        (*total)++;
+    }
+    g_free(search_key);
+
+    return g_list_reverse(result);
+}
+
+void
+room_list_clear(void)
+{
+    if (room_lists != NULL) {
+        g_hash_table_destroy(room_lists);
+        room_lists = NULL;
+    }
+}
+
+static RoomList *
+_room_list_new(void)
+{
+    RoomList *list = malloc(sizeof(RoomList));
+    list->items = g_ptr_array_new_with_free_func((GDestroyNotify)_item_destroy);
+    list->search_keys = g_ptr_array_new_with_free_func(g_free);
+    list->fetched = 0;
+
+    return list;
+}
+
+static void
+_room_list_append(RoomList *list, const char * const jid,
+    const char * const name)
+{
+    DiscoItem *item = malloc(sizeof(struct disco_item_t));
+    item->jid = strdup(jid);
+    if (name != NULL) {
+        item->name = strdup(name);
+    } else {
+        item->name = NULL;
+    }
+    g_ptr_array_add(list->items, item);
+
+    GString *key = g_string_new(jid);
+    if (name != NULL) {
+        g_string_append_printf(key, "\n%s", name);
+    }
+    g_ptr_array_add(list->search_keys, g_utf8_strdown(key->str, -1));
+    g_string_free(key, TRUE);
+}
+
+static void
+_room_list_free(RoomList *list)
+{
+    if (list != NULL) {
+        g_ptr_array_free(list->items, TRUE);
+        g_ptr_array_free(list->search_keys, TRUE);
+        free(list);
+    }
+}
+
+/*
+ * The service as its lower case bare jid, so that a listing started for
+ * the service as typed is found again from the jid it replies from, or NULL
+ * if the service is not a valid jid
+ */
+static gchar *
+_service_key(const char * const service)
+{
+    Jid *jid = jid_create(service);
+    if (jid == NULL) {
+        return NULL;
+    }
+
+    gchar *key = g_utf8_strdown(jid->barejid, -1);
+    jid_destroy(jid);
+
+    return key;
+}
+
+/*
+ * Return the listing of the service in memory, or from the cache
+ */
+static RoomList *
+_room_list_get(const char * const service)
+{
+    gchar *key = _service_key(service);
+    if (key == NULL) {
+        return NULL;
+    }
+
+    if (room_lists == NULL) {
+        room_lists = g_hash_table_new_full(g_str_hash, g_str_equal, g_free,
+            (GDestroyNotify)_room_list_free);
+    }
+
+    RoomList *list = g_hash_table_lookup(room_lists, key);
+    if (list == NULL) {
+        list = _room_list_load(key);
+        if (list != NULL) {
+            g_hash_table_insert(room_lists, key, list);
+            return list;
+        }
+    }
+    g_free(key);
+
+    return list;
+}
+
+static RoomList *
+_room_list_load(const char * const service)
+{
+    gchar *cache_loc = _get_room_list_file(service);
+    if (cache_loc == NULL) {
+        return NULL;
+    }
+
+    GKeyFile *cache = g_key_file_new();
+    if (!g_key_file_load_from_file(cache, cache_loc, G_KEY_FILE_NONE, NULL)) {
+        g_key_file_free(cache);
+        g_free(cache_loc);
+        return NULL;
+    }
+
+    gsize jids_length = 0;
+    gsize names_length = 0;
+    gchar **jids = g_key_file_get_string_list(cache, "rooms", "jids",
+        &jids_length, NULL);
+    gchar **names = g_key_file_get_string_list(cache, "rooms", "names",
+        &names_length, NULL);
+
+    RoomList *list = NULL;
+    if (jids_length == names_length) {
+        list = _room_list_new();
+        gchar *fetched = g_key_file_get_string(cache, "rooms", "fetched", NULL);
+        if (fetched != NULL) {
+            list->fetched = (time_t)g_ascii_strtoll(fetched, NULL, 10);
+            g_free(fetched);
+        }
+
+        gsize i;
+        for (i = 0; i < jids_length; i++) {
+            // rooms without a name are stored with an empty one
+            if (strlen(names[i]) == 0) {
+                _room_list_append(list, jids[i], NULL);
+            } else {
+                _room_list_append(list, jids[i], names[i]);
+            }
+        }
+    } else {
+        log_warning("Room list cache %s is corrupt, ignoring", cache_loc);
+    }
+
+    g_strfreev(jids);
+    g_strfreev(names);
+    g_key_file_free(cache);
+    g_free(cache_loc);
+
+    return list;
+}
+
+static void
+_room_list_save(const char * const service, RoomList *list)
+{
+    gchar *cache_loc = _get_room_list_file(service);
+    if (cache_loc == NULL) {
+        log_warning("Not saving room list for %s, not a valid file name",
+            service);
+        return;
+    }
+
+    GKeyFile *cache = g_key_file_new();
+    gchar *fetched = g_strdup_printf("%" G_GINT64_FORMAT, (gint64)list->fetched);
+    g_key_file_set_string(cache, "rooms", "fetched", fetched);
+    g_free(fetched);
+
+    guint length = list->items->len;
+    const gchar **jids = g_new(const gchar *, length);
+    const gchar **names = g_new(const gchar *, length);
+    guint i;
+    for (i = 0; i < length; i++) {
+        DiscoItem *item = g_ptr_array_index(list->items, i);
+        jids[i] = item->jid;
+        if (item->name != NULL) {
+            names[i] = item->name;
+        } else {
+            names[i] = "";
+        }
+    }
+    g_key_file_set_string_list(cache, "rooms", "jids", jids, length);
+    g_key_file_set_string_list(cache, "rooms", "names", names, length);
+    g_free(jids);
+    g_free(names);
+
+    gsize g_data_size;
+    gchar *g_cache_data = g_key_file_to_data(cache, &g_data_size, NULL);
+    g_file_set_contents(cache_loc, g_cache_data, g_data_size, NULL);
+    g_free(g_cache_data);
+    g_key_file_free(cache);
+    g_free(cache_loc);
+}
+
+/*
+ * The cache file for the service, or NULL if the service would not name a
+ * file inside the room lists directory
+ */
+static gchar *
+_get_room_list_file(const char * const service)
+{
+    if ((service[0] == '.') || (strchr(service, '/') != NULL)) {
+        return NULL;
+    }
+
+    gchar *xdg_data = xdg_get_data_home();
+    GString *cache_file = g_string_new(xdg_data);
+    g_string_append_printf(cache_file, "/profanity/roomlists/%s", service);
+    gchar *result = strdup(cache_file->str);
+    g_free(xdg_data);
+    g_string_free(cache_file, TRUE);
+
+    return result;
+}
+
+static void
+_item_destroy(DiscoItem *item)
+{
+    free(item->jid);
+    free(item->name);
+    free(item);
+}
@@ -0,0 +1,44 @@
+/*
+ * room_list.h
+ *
+ * Copyright (C) 2012, 2013 James Booth <boothj5@gmail.com>
+ *
+ * This file is part of Profanity.
+ *
+ * Profanity is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Profanity is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Profanity.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef ROOM_LIST_H
+#define ROOM_LIST_H
+
+#include <glib.h>
+
+#include "xmpp/xmpp.h"
+
+// cached room lists are fetched again after this many seconds
+#define ROOM_LIST_TTL (24 * 60 * 60)
+// rooms shown at a time in the room list window
+#define ROOM_LIST_PAGE_SIZE 100
+
+void room_list_start(const char * const service);
+void room_list_add(const char * const service, GSList *items);
+void room_list_complete(const char * const service);
+gboolean room_list_is_fresh(const char * const service);
+gint room_list_count(const char * const service);
+GList * room_list_get_page(const char * const service,
+    const char * const search, const gint page, gint *total);
+void room_list_clear(void);
+
+#endif
@@ -26,6 +26,7 @@
 
 #include "common.h"
 #include "tools/autocomplete.h"
+#include "tools/intern.h"
 #include "tools/parser.h"
 
 struct autocomplete_t {
@@ -50,7 +51,7 @@ autocomplete_new(void)
 void
 autocomplete_clear(Autocomplete ac)
 {
-    g_slist_free_full(ac->items, free);
+    g_slist_free_full(ac->items, (GDestroyNotify)intern_release);
     ac->items = NULL;
 
     autocomplete_reset(ac);
@@ -85,7 +86,7 @@ autocomplete_length(Autocomplete ac)
 gboolean
 autocomplete_add(Autocomplete ac, const char *item)
 {
-    char *item_cpy;
+    const char *item_cpy;
     GSList *curr = g_slist_find_custom(ac->items, item, (GCompareFunc)strcmp);
 
     // if item already exists
@@ -93,11 +94,56 @@ autocomplete_add(Autocomplete ac, const char *item)
         return FALSE;
     }
 
-    item_cpy = strdup(item);
-    ac->items = g_slist_insert_sorted(ac->items, item_cpy, (GCompareFunc)strcmp);
+    item_cpy = intern_str(item);
+    ac->items = g_slist_insert_sorted(ac->items, (gpointer)item_cpy,
+        (GCompareFunc)strcmp);
     return TRUE;
 }
 
+/*
+ * Add each of the items, sorting them once and merging them with the
+ * existing items rather than inserting them one at a time
+ */
+void
+autocomplete_add_all(Autocomplete ac, GSList *items)
+{
+    GSList *new_items = NULL;
+    while (items != NULL) {
+        new_items = g_slist_prepend(new_items, (gpointer)intern_str(items->data));
+        items = g_slist_next(items);
+    }
+    new_items = g_slist_sort(new_items, (GCompareFunc)strcmp);
+
+    GSList *merged = NULL;
+    GSList *curr = ac->items;
+    GSList *curr_new = new_items;
+    while ((curr != NULL) || (curr_new != NULL)) {
+        const char *item = NULL;
+        if ((curr_new == NULL) ||
+                ((curr != NULL) && (strcmp(curr->data, curr_new->data) <= 0))) {
+            item = curr->data;
+            curr = g_slist_next(curr);
+        } else {
+            item = curr_new->data;
+            curr_new = g_slist_next(curr_new);
+        }
+
+        // skip duplicates
+        if ((merged != NULL) && (merged->data == item)) {
+            intern_release(item);
+        } else {
+            merged = g_slist_prepend(merged, (gpointer)item);
+        }
+    }
+
+    g_slist_free(ac->items);
+    g_slist_free(new_items);
+    ac->items = g_slist_reverse(merged);
+
+    // the last found item no longer exists
+    autocomplete_reset(ac);
+}
+
 gboolean
 autocomplete_remove(Autocomplete ac, const char * const item)
 {
@@ -112,7 +158,7 @@ autocomplete_remove(Autocomplete ac, const char * const item)
         ac->last_found = NULL;
     }
 
-    free(curr->data);
+    intern_release(curr->data);
     ac->items = g_slist_delete_link(ac->items, curr);
 
     return TRUE;
@@ -39,6 +39,7 @@ void autocomplete_clear(Autocomplete ac);
 void autocomplete_reset(Autocomplete ac);
 void autocomplete_free(Autocomplete ac);
 gboolean autocomplete_add(Autocomplete ac, const char *item);
+void autocomplete_add_all(Autocomplete ac, GSList *items);
 gboolean autocomplete_remove(Autocomplete ac, const char * const item);
 GSList * autocomplete_get_list(Autocomplete ac);
 gchar * autocomplete_complete(Autocomplete ac, gchar *search_str);
@@ -0,0 +1,289 @@
+/*
+ * highlight.c
+ *
+ * Copyright (C) 2012, 2013 James Booth <boothj5@gmail.com>
+ *
+ * This file is part of Profanity.
+ *
+ * Profanity is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Profanity is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Profanity.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <glib.h>
+
+#include "tools/highlight.h"
+
+#define HIGHLIGHT_ALPHABET 256
+
+// state of the matching automaton, next holds the state for each byte with
+// failure transitions already followed, word_len is the length of the word
+// ending exactly in this state, or 0 if none does, and output is the nearest
+// state along the failure chain that ends a word, or the root if none does
+typedef struct highlight_state_t {
+    int next[HIGHLIGHT_ALPHABET];
+    int fail;
+    int output;
+    int word_len;
+} HighlightState;
+
+struct highlighter_t {
+    GArray *states;
+};
+
+static int _add_state(Highlighter highlighter);
+static void _add_word(Highlighter highlighter, const char * const word);
+static void _build_transitions(Highlighter highlighter);
+static HighlightState * _state(Highlighter highlighter, int index);
+static int _match_len(Highlighter highlighter, int state,
+    const char * const text, int end);
+static gboolean _is_word_char(char c);
+
+/*
+ * Compile the words into an Aho-Corasick automaton, so that every word can be
+ * found in a single pass over a message. Matching ignores ASCII case, and
+ * only whole words match, so "al" is not found in "totally".
+ */
+Highlighter
+highlighter_new(GSList *words)
+{
+    Highlighter highlighter = malloc(sizeof(struct highlighter_t));
+    highlighter->states = g_array_new(FALSE, FALSE, sizeof(HighlightState));
+    _add_state(highlighter);
+
+    while (words != NULL) {
+        _add_word(highlighter, words->data);
+        words = g_slist_next(words);
+    }
+
+    _build_transitions(highlighter);
+
+    return highlighter;
+}
+
+void
+highlighter_free(Highlighter highlighter)
+{
+    if (highlighter != NULL) {
+        g_array_free(highlighter->states, TRUE);
+        free(highlighter);
+    }
+}
+
+/*
+ * Return the parts of text matching any of the words, in order, with
+ * overlapping and adjacent matches merged. The list and its HighlightMatch
+ * items must be freed by the caller.
+ */
+GSList *
+highlighter_find(Highlighter highlighter, const char * const text)
+{
+    GSList *result = NULL;
+    int state = 0;
+    int i;
+
+    for (i = 0; text[i] != '\0'; i++) {
+        guchar c = g_ascii_tolower(text[i]);
+        state = _state(highlighter, state)->next[c];
+
+        int match_len = _match_len(highlighter, state, text, i + 1);
+        if (match_len == 0) {
+            continue;
+        }
+
+        // absorb earlier matches this one overlaps or touches, a long word
+        // may cover several
+        int start = i + 1 - match_len;
+        while (result != NULL) {
+            HighlightMatch *previous = result->data;
+            if (previous->end < start) {
+                break;
+            }
+            if (previous->start < start) {
+                start = previous->start;
+            }
+            free(previous);
+            result = g_slist_delete_link(result, result);
+        }
+
+        HighlightMatch *match = malloc(sizeof(HighlightMatch));
+        match->start = start;
+        match->end = i + 1;
+        result = g_slist_prepend(result, match);
+    }
+
+    return g_slist_reverse(result);
+}
+
+/*
+ * Returns TRUE if text contains any of the words
+ */
+gboolean
+highlighter_matches(Highlighter highlighter, const char * const text)
+{
+    int state = 0;
+    int i;
+
+    for (i = 0; text[i] != '\0'; i++) {
+        guchar c = g_ascii_tolower(text[i]);
+        state = _state(highlighter, state)->next[c];
+        if (_match_len(highlighter, state, text, i + 1) > 0) {
+            return TRUE;
+        }
+    }
+
+    return FALSE;
+}
+
+static HighlightState *
+_state(Highlighter highlighter, int index)
+{
+    return &g_array_index(highlighter->states, HighlightState, index);
+}
+
+/*
+ * Return the length of the longest word ending in state that stands alone
+ * in text, ending at byte offset end, or 0 if none does
+ */
+static int
+_match_len(Highlighter highlighter, int state, const char * const text,
+    int end)
+{
+    // a word running into the next character is not a match, whichever
+    // word it is
+    if (_is_word_char(text[end]) && _is_word_char(text[end - 1])) {
+        return 0;
+    }
+
+    if (_state(highlighter, state)->word_len == 0) {
+        state = _state(highlighter, state)->output;
+    }
+
+    // words along the output chain get shorter, take the first that does
+    // not continue a word in front of it
+    while (state != 0) {
+        HighlightState *current = _state(highlighter, state);
+        int start = end - current->word_len;
+        if ((start == 0) || !_is_word_char(text[start - 1]) ||
+                !_is_word_char(text[start])) {
+            return current->word_len;
+        }
+        state = current->output;
+    }
+
+    return 0;
+}
+
+/*
+ * Letters, digits, underscore and any byte of a multibyte UTF-8 character
+ */
+static gboolean
+_is_word_char(char c)
+{
+    return (g_ascii_isalnum(c) || (c == '_') || ((guchar)c >= 0x80));
+}
+
+static int
+_add_state(Highlighter highlighter)
+{
+    HighlightState state;
+    int c;
+    for (c = 0; c < HIGHLIGHT_ALPHABET; c++) {
+        state.next[c] = -1;
+    }
+    state.fail = 0;
+    state.output = 0;
+    state.word_len = 0;
+    g_array_append_val(highlighter->states, state);
+
+    return highlighter->states->len - 1;
+}
+
+static void
+_add_word(Highlighter highlighter, const char * const word)
+{
+    int len = strlen(word);
+    if (len == 0) {
+        return;
+    }
+
+    int state = 0;
+    int i;
+    for (i = 0; i < len; i++) {
+        guchar c = g_ascii_tolower(word[i]);
+        int next = _state(highlighter, state)->next[c];
+
+        // adding a state may move the array, so look the state up again
+        if (next == -1) {
+            next = _add_state(highlighter);
+            _state(highlighter, state)->next[c] = next;
+        }
+        state = next;
+    }
+
+    _state(highlighter, state)->word_len = len;
+}
+
+/*
+ * Breadth first from the root, set each state's failure state and fill in
+ * its missing transitions from it, so matching never backtracks
+ */
+static void
+_build_transitions(Highlighter highlighter)
+{
+    GQueue *queue = g_queue_new();
+    HighlightState *root = _state(highlighter, 0);
+    int c;
+
+    for (c = 0; c < HIGHLIGHT_ALPHABET; c++) {
+        int child = root->next[c];
+        if (child == -1) {
+            root->next[c] = 0;
+        } else {
+            _state(highlighter, child)->fail = 0;
+            _state(highlighter, child)->output = 0;
+            g_queue_push_tail(queue, GINT_TO_POINTER(child));
+        }
+    }
+
+    while (!g_queue_is_empty(queue)) {
+        int index = GPOINTER_TO_INT(g_queue_pop_head(queue));
+        HighlightState *state = _state(highlighter, index);
+        HighlightState *fail = _state(highlighter, state->fail);
+
+        for (c = 0; c < HIGHLIGHT_ALPHABET; c++) {
+            int child = state->next[c];
+            if (child == -1) {
+                state->next[c] = fail->next[c];
+            } else {
+                HighlightState *child_state = _state(highlighter, child);
+                child_state->fail = fail->next[c];
+
+                // words ending in the failure state also end here
+                HighlightState *child_fail =
+                    _state(highlighter, child_state->fail);
+                if (child_fail->word_len > 0) {
+                    child_state->output = child_state->fail;
+                } else {
+                    child_state->output = child_fail->output;
+                }
+                g_queue_push_tail(queue, GINT_TO_POINTER(child));
+            }
+        }
+    }
+
+    g_queue_free(queue);
+}
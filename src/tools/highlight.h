@@ -0,0 +1,41 @@
+/*
+ * highlight.h
+ *
+ * Copyright (C) 2012, 2013 James Booth <boothj5@gmail.com>
+ *
+ * This file is part of Profanity.
+ *
+ * Profanity is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Profanity is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Profanity.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef HIGHLIGHT_H
+#define HIGHLIGHT_H
+
+#include <glib.h>
+
+typedef struct highlighter_t *Highlighter;
+
+// byte offsets of a highlighted part of a message, end is exclusive
+typedef struct highlight_match_t {
+    int start;
+    int end;
+} HighlightMatch;
+
+Highlighter highlighter_new(GSList *words);
+void highlighter_free(Highlighter highlighter);
+GSList * highlighter_find(Highlighter highlighter, const char * const text);
+gboolean highlighter_matches(Highlighter highlighter, const char * const text);
+
+#endif
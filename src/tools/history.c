@@ -27,40 +27,62 @@
 
 #include "history.h"
 
+// the session holds edits made while browsing, they are discarded when
+// the session ends, entries in the history are never changed
 struct history_session_t {
-    GList *items;
-    GList *sess_curr;
-    GList *sess_new;
-    GList *orig_curr;
+    gboolean active;
+    guint curr; // id of the entry shown, the end id for the new item
+    char *new_item;
+    GHashTable *edits; // id to edited text
 };
 
+// entries are kept in a ring buffer, oldest first, and identified by ids
+// that increase from oldest to newest
 struct history_t {
-    GList *items;
+    char **items;
+    guint capacity;
+    guint head;
+    guint count;
+    guint first_id;
     guint max_size;
     struct history_session_t session;
+    const char *unloaded;
+    gsize unloaded_len;
 };
 
-static void _replace_history_with_session(History history);
-static gboolean _adding_new(History history);
+static guint _end_id(History history);
+static char * _get(History history, guint id);
+static void _reserve(History history);
+static void _push_newest(History history, char *item);
+static void _push_oldest(History history, char *item);
+static void _remove_oldest(History history);
+static void _create_session(History history, char *item);
 static void _reset_session(History history);
-static gboolean _has_session(History history);
-static void _remove_first(History history);
+static const char * _session_item(History history);
 static void _update_current_session_item(History history, char *item);
-static void _add_to_history(History history, char *item);
-static void _remove_last_session_item(History history);
-static void _replace_current_with_original(History history);
-static void _create_session(History history);
 static void _session_previous(History history);
 static void _session_next(History history);
+static gboolean _load_previous(History history);
 
 History
 history_new(unsigned int size)
 {
     History new_history = malloc(sizeof(struct history_t));
     new_history->items = NULL;
+    new_history->capacity = 0;
+    new_history->head = 0;
+    new_history->count = 0;
+
+    // lazily loaded entries are only added while there are fewer than size,
+    // so starting here ids never go below zero
+    new_history->first_id = size;
     new_history->max_size = size;
+    new_history->unloaded = NULL;
+    new_history->unloaded_len = 0;
 
-    _reset_session(new_history);
+    new_history->session.active = FALSE;
+    new_history->session.new_item = NULL;
+    new_history->session.edits = NULL;
 
     return new_history;
 }
@@ -68,204 +90,313 @@ history_new(unsigned int size)
 void
 history_append(History history, char *item)
 {
-    char *copied = "";
+    char *copied = NULL;
     if (item != NULL) {
         copied = strdup(item);
+    } else {
+        copied = strdup("");
     }
 
-    if (history->items == NULL) {
-        _add_to_history(history, copied);
-        return;
+    // submitting the new item, an empty one is not kept
+    if (history->session.active &&
+            (history->session.curr == _end_id(history)) &&
+            (strcmp(copied, "") == 0)) {
+        free(copied);
+    } else {
+        _push_newest(history, copied);
     }
 
-    if (!_has_session(history)) {
-        if (g_list_length(history->items) == history->max_size) {
-            _remove_first(history);
-        }
-
-        _add_to_history(history, copied);
-
-    } else {
-        _update_current_session_item(history, copied);
+    _reset_session(history);
+}
 
-        if (_adding_new(history)) {
-            if (strcmp(history->session.sess_curr->data, "") == 0) {
-                _remove_last_session_item(history);
-            }
+/*
+ * Use contents as newline separated items older than anything in the
+ * history, items are only copied in as the user scrolls back to them,
+ * and only while the history holds fewer than its maximum size.
+ * The contents are not copied, and must outlive the history.
+ */
+void
+history_load_lazy(History history, const char * const contents, size_t len)
+{
+    history->unloaded = contents;
+    history->unloaded_len = len;
+}
 
-            _replace_history_with_session(history);
+/*
+ * Load every entry left in the lazily loaded contents, up to the maximum
+ * size, no older entries are added after this
+ */
+void
+history_load_all(History history)
+{
+    gboolean loaded = TRUE;
+    while (loaded) {
+        loaded = _load_previous(history);
+    }
+}
 
-        } else {
-            _remove_last_session_item(history);
+unsigned int
+history_first_id(History history)
+{
+    return history->first_id;
+}
 
-            char *new = strdup(history->session.sess_curr->data);
-            history->session.items = g_list_append(history->session.items, new);
+/*
+ * Return the id the next appended entry will have
+ */
+unsigned int
+history_end_id(History history)
+{
+    return _end_id(history);
+}
 
-            _replace_current_with_original(history);
-            _replace_history_with_session(history);
-        }
+/*
+ * Return the entry with id, or NULL if it has been removed or not loaded,
+ * the entry is owned by the history
+ */
+const char *
+history_get(History history, unsigned int id)
+{
+    if ((id < history->first_id) || (id >= _end_id(history))) {
+        return NULL;
     }
+
+    return _get(history, id);
 }
 
 char *
 history_previous(History history, char *item)
 {
-    // no history
-    if (history->items == NULL) {
-        return NULL;
+    if (history->count == 0) {
+        _load_previous(history);
     }
 
-    char *copied = "";
-    if (item != NULL) {
-        copied = strdup(item);
+    // no history
+    if (history->count == 0) {
+        return NULL;
     }
 
-    if (!_has_session(history)) {
-        _create_session(history);
-
-        // add the new item
-        history->session.items = g_list_append(history->session.items, copied);
-        history->session.sess_new = g_list_last(history->session.items);
-
-        char *result = strdup(history->session.sess_curr->data);
-        return result;
+    if (!history->session.active) {
+        _create_session(history, item);
     } else {
-        _update_current_session_item(history, copied);
+        _update_current_session_item(history, item);
         _session_previous(history);
     }
 
-    char *result = strdup(history->session.sess_curr->data);
-    return result;
+    return strdup(_session_item(history));
 }
 
 char *
 history_next(History history, char *item)
 {
     // no history, or no session, return NULL
-    if ((history->items == NULL) || (history->session.items == NULL)) {
+    if ((history->count == 0) || !history->session.active) {
         return NULL;
     }
 
-    if (g_list_next(history->session.sess_curr) == NULL) {
+    // already on the new item
+    if (history->session.curr == _end_id(history)) {
         return NULL;
     }
 
-    char *copied = "";
-    if (item != NULL) {
-        copied = strdup(item);
-    }
-
-    _update_current_session_item(history, copied);
+    _update_current_session_item(history, item);
     _session_next(history);
 
-    char *result = strdup(history->session.sess_curr->data);
-    return result;
+    return strdup(_session_item(history));
 }
 
-static void
-_replace_history_with_session(History history)
+static guint
+_end_id(History history)
 {
-    g_list_free(history->items);
-    history->items = g_list_copy(history->session.items);
-
-    if (g_list_length(history->items) > history->max_size) {
-        _remove_first(history);
-    }
-
-    _reset_session(history);
+    return history->first_id + history->count;
 }
 
-static gboolean
-_adding_new(History history)
+static char *
+_get(History history, guint id)
 {
-    return (history->session.sess_curr ==
-        g_list_last(history->session.items));
+    guint offset = id - history->first_id;
+    return history->items[(history->head + offset) % history->capacity];
 }
 
+/*
+ * Make room for one more entry, growing the buffer up to the maximum size
+ */
 static void
-_reset_session(History history)
+_reserve(History history)
 {
-    history->session.items = NULL;
-    history->session.sess_curr = NULL;
-    history->session.sess_new = NULL;
-    history->session.orig_curr = NULL;
+    if (history->count < history->capacity) {
+        return;
+    }
+
+    guint capacity = history->capacity * 2;
+    if (capacity < 16) {
+        capacity = 16;
+    }
+    if (capacity > history->max_size) {
+        capacity = history->max_size;
+    }
+    if (capacity <= history->count) {
+        capacity = history->count + 1;
+    }
+
+    char **items = malloc(capacity * sizeof(char *));
+    guint i;
+    for (i = 0; i < history->count; i++) {
+        items[i] = history->items[(history->head + i) % history->capacity];
+    }
+    free(history->items);
+
+    history->items = items;
+    history->capacity = capacity;
+    history->head = 0;
 }
 
-static gboolean
-_has_session(History history)
+static void
+_push_newest(History history, char *item)
 {
-    return (history->session.items != NULL);
+    if ((history->count > 0) && (history->count >= history->max_size)) {
+        _remove_oldest(history);
+    }
+
+    _reserve(history);
+    guint tail = (history->head + history->count) % history->capacity;
+    history->items[tail] = item;
+    history->count++;
 }
 
 static void
-_remove_first(History history)
+_push_oldest(History history, char *item)
 {
-    GList *first = g_list_first(history->items);
-    char *first_item = first->data;
-    history->items = g_list_remove(history->items, first_item);
+    _reserve(history);
+    history->head = (history->head + history->capacity - 1) % history->capacity;
+    history->items[history->head] = item;
+    history->count++;
+    history->first_id--;
 }
 
 static void
-_update_current_session_item(History history, char *item)
+_remove_oldest(History history)
 {
-    history->session.sess_curr->data = item;
+    free(history->items[history->head]);
+    history->head = (history->head + 1) % history->capacity;
+    history->count--;
+    history->first_id++;
 }
 
+/*
+ * Start browsing at the newest entry, item is the text being replaced
+ */
 static void
-_add_to_history(History history, char *item)
+_create_session(History history, char *item)
 {
-    history->items = g_list_append(history->items, item);
+    history->session.active = TRUE;
+    history->session.curr = _end_id(history) - 1;
+    if (item != NULL) {
+        history->session.new_item = strdup(item);
+    } else {
+        history->session.new_item = strdup("");
+    }
+    history->session.edits = g_hash_table_new_full(g_direct_hash,
+        g_direct_equal, NULL, free);
 }
 
 static void
-_remove_last_session_item(History history)
+_reset_session(History history)
 {
-    history->session.items = g_list_reverse(history->session.items);
-    GList *first = g_list_first(history->session.items);
-    history->session.items =
-        g_list_remove(history->session.items, first->data);
-    history->session.items = g_list_reverse(history->session.items);
+    if (history->session.active) {
+        free(history->session.new_item);
+        g_hash_table_destroy(history->session.edits);
+    }
+    history->session.active = FALSE;
+    history->session.new_item = NULL;
+    history->session.edits = NULL;
 }
 
-static void
-_replace_current_with_original(History history)
+static const char *
+_session_item(History history)
 {
-    history->session.sess_curr->data = strdup(history->session.orig_curr->data);
+    guint curr = history->session.curr;
+    if (curr == _end_id(history)) {
+        return history->session.new_item;
+    }
+
+    char *edited = g_hash_table_lookup(history->session.edits,
+        GUINT_TO_POINTER(curr));
+    if (edited != NULL) {
+        return edited;
+    } else {
+        return _get(history, curr);
+    }
 }
 
 static void
-_create_session(History history)
+_update_current_session_item(History history, char *item)
 {
-    history->session.items = g_list_copy(history->items);
-    history->session.sess_curr = g_list_last(history->session.items);
-    history->session.orig_curr = g_list_last(history->items);
+    char *copied = NULL;
+    if (item != NULL) {
+        copied = strdup(item);
+    } else {
+        copied = strdup("");
+    }
+
+    guint curr = history->session.curr;
+    if (curr == _end_id(history)) {
+        free(history->session.new_item);
+        history->session.new_item = copied;
+    } else {
+        g_hash_table_insert(history->session.edits, GUINT_TO_POINTER(curr),
+            copied);
+    }
 }
 
 static void
 _session_previous(History history)
 {
-    history->session.sess_curr =
-        g_list_previous(history->session.sess_curr);
-    if (history->session.orig_curr == NULL)
-        history->session.orig_curr = g_list_last(history->items);
-    else
-        history->session.orig_curr =
-            g_list_previous(history->session.orig_curr);
-
-    if (history->session.sess_curr == NULL) {
-        history->session.sess_curr = g_list_first(history->session.items);
-        history->session.orig_curr = g_list_first(history->items);
+    if (history->session.curr == history->first_id) {
+        _load_previous(history);
+    }
+
+    // stop at the oldest entry
+    if (history->session.curr > history->first_id) {
+        history->session.curr--;
     }
 }
 
 static void
 _session_next(History history)
 {
-    history->session.sess_curr = g_list_next(history->session.sess_curr);
-    history->session.orig_curr = g_list_next(history->session.orig_curr);
+    history->session.curr++;
+}
+
+static gboolean
+_load_previous(History history)
+{
+    const char *contents = history->unloaded;
+    gsize len = history->unloaded_len;
+
+    if ((contents != NULL) && (history->count < history->max_size)) {
+        // skip trailing newlines
+        while ((len > 0) && (contents[len-1] == '\n')) {
+            len--;
+        }
 
-    if (history->session.sess_curr == NULL) {
-        history->session.sess_curr = g_list_last(history->session.items);
-        history->session.orig_curr = NULL;
+        if (len > 0) {
+            const char *start = &contents[len];
+            while ((start > contents) && (start[-1] != '\n')) {
+                start--;
+            }
+            char *loaded = strndup(start, &contents[len] - start);
+            history->unloaded_len = start - contents;
+
+            // ids of entries already shown in a session are unchanged
+            _push_oldest(history, loaded);
+
+            return TRUE;
+        }
     }
+
+    history->unloaded = NULL;
+    history->unloaded_len = 0;
+
+    return FALSE;
 }
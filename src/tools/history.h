@@ -23,11 +23,19 @@
 #ifndef HISTORY_H
 #define HISTORY_H
 
+#include <stddef.h>
+
 typedef struct history_t  *History;
 
 History history_new(unsigned int size);
+void history_load_lazy(History history, const char * const contents,
+    size_t len);
 char * history_previous(History history, char *item);
 char * history_next(History history, char *item);
 void history_append(History history, char *item);
+void history_load_all(History history);
+unsigned int history_first_id(History history);
+unsigned int history_end_id(History history);
+const char * history_get(History history, unsigned int id);
 
 #endif
@@ -0,0 +1,407 @@
+/*
+ * history_index.c
+ *
+ * Copyright (C) 2012, 2013 James Booth <boothj5@gmail.com>
+ *
+ * This file is part of Profanity.
+ *
+ * Profanity is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Profanity is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Profanity.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <glib.h>
+
+#include "common.h"
+#include "tools/history_index.h"
+
+#define TRIGRAM(str) \
+    (((guint)(guchar)(str)[0] << 16) | ((guint)(guchar)(str)[1] << 8) | \
+    (guint)(guchar)(str)[2])
+
+// entries are not copied, ids are those of the history, which only adds
+// newer entries once everything it holds has been indexed
+struct history_index_t {
+    History history;
+    guint indexed_end;
+
+    // oldest id the postings may hold, ids older than the history's first
+    // id were removed from the history and are dropped once there are
+    // enough of them
+    guint pruned_first;
+
+    // trigram to GArray of ids of entries containing it, ascending
+    GHashTable *trigrams;
+
+    // current search
+    gchar *query;
+    GArray *matches;
+    guint current;
+    gboolean has_current;
+};
+
+static void _free_postings(GArray *postings);
+static void _prune(HistoryIndex index);
+static void _index_entry(HistoryIndex index, guint id);
+static gboolean _entry_contains(HistoryIndex index, guint id,
+    const char * const query);
+static GArray * _trigram_matches(HistoryIndex index, const char * const query);
+static void _narrow_matches(HistoryIndex index, const char * const query);
+static gboolean _find_from(HistoryIndex index, guint from, guint *found);
+
+/*
+ * Create an index of the entries in history, loading any not yet loaded
+ */
+HistoryIndex
+history_index_new(History history)
+{
+    HistoryIndex new_index = malloc(sizeof(struct history_index_t));
+    new_index->history = history;
+    new_index->trigrams = g_hash_table_new_full(g_direct_hash, g_direct_equal,
+        NULL, (GDestroyNotify)_free_postings);
+    new_index->query = NULL;
+    new_index->matches = NULL;
+    new_index->has_current = FALSE;
+
+    history_load_all(history);
+    new_index->indexed_end = history_first_id(history);
+    new_index->pruned_first = new_index->indexed_end;
+    history_index_update(new_index);
+
+    return new_index;
+}
+
+void
+history_index_free(HistoryIndex index)
+{
+    if (index != NULL) {
+        history_index_reset_search(index);
+        g_hash_table_destroy(index->trigrams);
+        free(index);
+    }
+}
+
+/*
+ * Index the entries appended to the history since the last update, and drop
+ * the entries the history has removed once they are a fifth of the index
+ */
+void
+history_index_update(HistoryIndex index)
+{
+    guint end = history_end_id(index->history);
+    while (index->indexed_end < end) {
+        _index_entry(index, index->indexed_end);
+        index->indexed_end++;
+    }
+
+    guint removed = history_first_id(index->history) - index->pruned_first;
+    if (removed * 4 > history_index_length(index)) {
+        _prune(index);
+    }
+}
+
+unsigned int
+history_index_length(HistoryIndex index)
+{
+    return index->indexed_end - history_first_id(index->history);
+}
+
+/*
+ * Return the number of entry ids held by the trigram postings
+ */
+unsigned int
+history_index_postings(HistoryIndex index)
+{
+    unsigned int result = 0;
+    GHashTableIter iter;
+    gpointer postings;
+    g_hash_table_iter_init(&iter, index->trigrams);
+    while (g_hash_table_iter_next(&iter, NULL, &postings)) {
+        result += ((GArray *)postings)->len;
+    }
+
+    return result;
+}
+
+/*
+ * Return a copy of the newest entry containing query, at or older than
+ * the current match, or NULL if there is none. If query extends the
+ * previous query, only the previous matches are checked.
+ */
+char *
+history_index_search(HistoryIndex index, const char * const query)
+{
+    if ((query == NULL) || (strlen(query) == 0)) {
+        FREE_SET_NULL(index->query);
+        if (index->matches != NULL) {
+            g_array_free(index->matches, TRUE);
+            index->matches = NULL;
+        }
+        return NULL;
+    }
+
+    gboolean extends = ((index->query != NULL) &&
+        g_str_has_prefix(query, index->query));
+
+    if ((index->matches != NULL) && extends) {
+        _narrow_matches(index, query);
+    } else {
+        if (index->matches != NULL) {
+            g_array_free(index->matches, TRUE);
+        }
+        index->matches = _trigram_matches(index, query);
+    }
+    free(index->query);
+    index->query = strdup(query);
+
+    // a shorter or different query may match newer entries again
+    if (!extends) {
+        index->has_current = FALSE;
+    }
+
+    guint first = history_first_id(index->history);
+    if (index->indexed_end == first) {
+        return NULL;
+    }
+
+    guint from = index->indexed_end - 1;
+    if (index->has_current) {
+        from = index->current;
+    }
+
+    guint found;
+    if (_find_from(index, from, &found)) {
+        index->current = found;
+        index->has_current = TRUE;
+        return strdup(history_get(index->history, found));
+    } else {
+        return NULL;
+    }
+}
+
+/*
+ * Return a copy of the next older entry matching the current query, that
+ * differs from the current match, or NULL if there is none.
+ */
+char *
+history_index_search_older(HistoryIndex index)
+{
+    if ((index->query == NULL) || !index->has_current) {
+        return NULL;
+    }
+
+    const char *current = history_get(index->history, index->current);
+    if (current == NULL) {
+        return NULL;
+    }
+
+    guint first = history_first_id(index->history);
+    guint from = index->current;
+    guint found;
+    while ((from > first) && _find_from(index, from - 1, &found)) {
+        const char *entry = history_get(index->history, found);
+        if (strcmp(entry, current) != 0) {
+            index->current = found;
+            return strdup(entry);
+        }
+        from = found;
+    }
+
+    return NULL;
+}
+
+void
+history_index_reset_search(HistoryIndex index)
+{
+    FREE_SET_NULL(index->query);
+    if (index->matches != NULL) {
+        g_array_free(index->matches, TRUE);
+        index->matches = NULL;
+    }
+    index->has_current = FALSE;
+}
+
+static void
+_free_postings(GArray *postings)
+{
+    g_array_free(postings, TRUE);
+}
+
+/*
+ * Remove the ids of entries no longer in the history from every posting
+ * list, they are the oldest ids so are always at the front of each list
+ */
+static void
+_prune(HistoryIndex index)
+{
+    guint first = history_first_id(index->history);
+    GHashTableIter iter;
+    gpointer postings_ptr;
+    g_hash_table_iter_init(&iter, index->trigrams);
+    while (g_hash_table_iter_next(&iter, NULL, &postings_ptr)) {
+        GArray *postings = postings_ptr;
+        guint removed = 0;
+        while ((removed < postings->len) &&
+                (g_array_index(postings, guint, removed) < first)) {
+            removed++;
+        }
+
+        if (removed == postings->len) {
+            g_hash_table_iter_remove(&iter);
+        } else if (removed > 0) {
+            g_array_remove_range(postings, 0, removed);
+        }
+    }
+
+    index->pruned_first = first;
+}
+
+/*
+ * Return the ids of entries containing query, using the shortest posting
+ * list of the query's trigrams as candidates. Returns NULL for queries
+ * shorter than a trigram, which are searched by scanning instead.
+ */
+static GArray *
+_trigram_matches(HistoryIndex index, const char * const query)
+{
+    size_t len = strlen(query);
+    if (len < 3) {
+        return NULL;
+    }
+
+    GArray *shortest = NULL;
+    size_t i;
+    for (i = 0; i + 3 <= len; i++) {
+        GArray *postings = g_hash_table_lookup(index->trigrams,
+            GUINT_TO_POINTER(TRIGRAM(&query[i])));
+        if (postings == NULL) {
+            shortest = NULL;
+            break;
+        }
+        if ((shortest == NULL) || (postings->len < shortest->len)) {
+            shortest = postings;
+        }
+    }
+
+    GArray *matches = g_array_new(FALSE, FALSE, sizeof(guint));
+    if (shortest != NULL) {
+        for (i = 0; i < shortest->len; i++) {
+            guint id = g_array_index(shortest, guint, i);
+            if (_entry_contains(index, id, query)) {
+                g_array_append_val(matches, id);
+            }
+        }
+    }
+
+    return matches;
+}
+
+static void
+_narrow_matches(HistoryIndex index, const char * const query)
+{
+    guint i;
+    guint kept = 0;
+    for (i = 0; i < index->matches->len; i++) {
+        guint id = g_array_index(index->matches, guint, i);
+        if (_entry_contains(index, id, query)) {
+            g_array_index(index->matches, guint, kept++) = id;
+        }
+    }
+    g_array_set_size(index->matches, kept);
+}
+
+/*
+ * Find the newest entry matching the current query with id at most from,
+ * entries removed from the history are never found
+ */
+static gboolean
+_find_from(HistoryIndex index, guint from, guint *found)
+{
+    guint first = history_first_id(index->history);
+    if (from < first) {
+        return FALSE;
+    }
+
+    // no match set for short queries, scan back from the start point
+    if (index->matches == NULL) {
+        guint id = from + 1;
+        while (id > first) {
+            id--;
+            if (_entry_contains(index, id, index->query)) {
+                *found = id;
+                return TRUE;
+            }
+        }
+        return FALSE;
+    }
+
+    // binary search for the last match not after from
+    guint low = 0;
+    guint high = index->matches->len;
+    while (low < high) {
+        guint mid = low + (high - low) / 2;
+        if (g_array_index(index->matches, guint, mid) <= from) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+
+    if ((low == 0) || (g_array_index(index->matches, guint, low - 1) < first)) {
+        return FALSE;
+    } else {
+        *found = g_array_index(index->matches, guint, low - 1);
+        return TRUE;
+    }
+}
+
+static void
+_index_entry(HistoryIndex index, guint id)
+{
+    const char *entry = history_get(index->history, id);
+    if (entry == NULL) {
+        return;
+    }
+
+    size_t len = strlen(entry);
+    size_t i;
+    for (i = 0; i + 3 <= len; i++) {
+        gpointer key = GUINT_TO_POINTER(TRIGRAM(&entry[i]));
+        GArray *postings = g_hash_table_lookup(index->trigrams, key);
+        if (postings == NULL) {
+            postings = g_array_new(FALSE, FALSE, sizeof(guint));
+            g_hash_table_insert(index->trigrams, key, postings);
+        }
+
+        // each id appears once, and is always the largest so far
+        if ((postings->len == 0) ||
+                (g_array_index(postings, guint, postings->len - 1) != id)) {
+            g_array_append_val(postings, id);
+        }
+    }
+
+    // keep an in progress search up to date
+    if ((index->matches != NULL) && (strstr(entry, index->query) != NULL)) {
+        g_array_append_val(index->matches, id);
+    }
+}
+
+static gboolean
+_entry_contains(HistoryIndex index, guint id, const char * const query)
+{
+    const char *entry = history_get(index->history, id);
+    return ((entry != NULL) && (strstr(entry, query) != NULL));
+}
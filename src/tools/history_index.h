@@ -0,0 +1,39 @@
+/*
+ * history_index.h
+ *
+ * Copyright (C) 2012, 2013 James Booth <boothj5@gmail.com>
+ *
+ * This file is part of Profanity.
+ *
+ * Profanity is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Profanity is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Profanity.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef HISTORY_INDEX_H
+#define HISTORY_INDEX_H
+
+#include "tools/history.h"
+
+typedef struct history_index_t *HistoryIndex;
+
+HistoryIndex history_index_new(History history);
+void history_index_free(HistoryIndex index);
+void history_index_update(HistoryIndex index);
+unsigned int history_index_length(HistoryIndex index);
+unsigned int history_index_postings(HistoryIndex index);
+char * history_index_search(HistoryIndex index, const char * const query);
+char * history_index_search_older(HistoryIndex index);
+void history_index_reset_search(HistoryIndex index);
+
+#endif
@@ -0,0 +1,125 @@
+/*
+ * intern.c
+ *
+ * Copyright (C) 2012, 2013 James Booth <boothj5@gmail.com>
+ *
+ * This file is part of Profanity.
+ *
+ * Profanity is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Profanity is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Profanity.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <glib.h>
+
+#include "log.h"
+#include "tools/intern.h"
+
+// interned strings, mapped to their reference counts, keys are freed when
+// the count reaches zero rather than by the table, so that updating a count
+// never frees the key
+static GHashTable *strings = NULL;
+
+/*
+ * Return the shared copy of str, creating it if this is the first reference.
+ * Each call must be matched with a call to intern_release. Interned strings
+ * are equal only if they are the same pointer.
+ */
+const char *
+intern_str(const char * const str)
+{
+    if (str == NULL) {
+        return NULL;
+    }
+
+    if (strings == NULL) {
+        strings = g_hash_table_new(g_str_hash, g_str_equal);
+    }
+
+    gpointer interned = NULL;
+    gpointer refs = NULL;
+    if (g_hash_table_lookup_extended(strings, str, &interned, &refs)) {
+        g_hash_table_insert(strings, interned,
+            GUINT_TO_POINTER(GPOINTER_TO_UINT(refs) + 1));
+    } else {
+        interned = strdup(str);
+        g_hash_table_insert(strings, interned, GUINT_TO_POINTER(1));
+    }
+
+    return interned;
+}
+
+/*
+ * Release a reference returned by intern_str, the string is freed when the
+ * last reference is released. str must be the pointer intern_str returned,
+ * not an equal copy.
+ */
+void
+intern_release(const char * const str)
+{
+    if ((str == NULL) || (strings == NULL)) {
+        return;
+    }
+
+    gpointer interned = NULL;
+    gpointer refs = NULL;
+    if (!g_hash_table_lookup_extended(strings, str, &interned, &refs)) {
+        return;
+    }
+
+    // releasing a copy would drop another holder's reference
+    if (interned != str) {
+        log_error("Release of string not returned by intern_str: %s", str);
+        return;
+    }
+
+    guint count = GPOINTER_TO_UINT(refs) - 1;
+    if (count == 0) {
+        g_hash_table_remove(strings, interned);
+        free(interned);
+    } else {
+        g_hash_table_insert(strings, interned, GUINT_TO_POINTER(count));
+    }
+}
+
+/*
+ * Return the shared copy of str without taking a reference, or NULL if str
+ * is not interned
+ */
+const char *
+intern_lookup(const char * const str)
+{
+    if ((str == NULL) || (strings == NULL)) {
+        return NULL;
+    }
+
+    gpointer interned = NULL;
+    if (!g_hash_table_lookup_extended(strings, str, &interned, NULL)) {
+        return NULL;
+    }
+
+    return interned;
+}
+
+guint
+intern_count(void)
+{
+    if (strings == NULL) {
+        return 0;
+    }
+
+    return g_hash_table_size(strings);
+}
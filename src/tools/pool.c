@@ -0,0 +1,142 @@
+/*
+ * pool.c
+ *
+ * Copyright (C) 2012, 2013 James Booth <boothj5@gmail.com>
+ *
+ * This file is part of Profanity.
+ *
+ * Profanity is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Profanity is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Profanity.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <stdlib.h>
+
+#include <glib.h>
+
+#include "tools/pool.h"
+
+// objects carved from each slab
+#define POOL_SLAB_OBJECTS 64
+
+// a freed object holds the next free object in its first bytes
+typedef struct pool_free_object_t {
+    struct pool_free_object_t *next;
+} PoolFreeObject;
+
+// objects of one size, allocated a slab at a time and reused once freed,
+// slabs are only released when the pool is destroyed
+struct pool_t {
+    gsize object_size;
+    GSList *slabs;
+    char *unused;
+    guint unused_count;
+    PoolFreeObject *free_objects;
+    guint free_count;
+};
+
+/*
+ * Create a pool of objects of object_size bytes, for types allocated and
+ * freed often, so that they reuse memory rather than going back to malloc
+ */
+Pool
+pool_new(gsize object_size)
+{
+    Pool pool = malloc(sizeof(struct pool_t));
+
+    // every object must hold the free list link, and stay aligned for it
+    gsize align = sizeof(gpointer);
+    if (object_size < sizeof(PoolFreeObject)) {
+        object_size = sizeof(PoolFreeObject);
+    }
+    pool->object_size = (object_size + align - 1) / align * align;
+
+    pool->slabs = NULL;
+    pool->unused = NULL;
+    pool->unused_count = 0;
+    pool->free_objects = NULL;
+    pool->free_count = 0;
+
+    return pool;
+}
+
+/*
+ * Free the pool and every object allocated from it
+ */
+void
+pool_destroy(Pool pool)
+{
+    if (pool != NULL) {
+        g_slist_free_full(pool->slabs, free);
+        free(pool);
+    }
+}
+
+/*
+ * Return an uninitialised object, a freed one if there is one, otherwise
+ * the next unused one of the newest slab
+ */
+gpointer
+pool_alloc(Pool pool)
+{
+    if (pool->free_objects != NULL) {
+        PoolFreeObject *object = pool->free_objects;
+        pool->free_objects = object->next;
+        pool->free_count--;
+        return object;
+    }
+
+    if (pool->unused_count == 0) {
+        pool->unused = malloc(pool->object_size * POOL_SLAB_OBJECTS);
+        pool->unused_count = POOL_SLAB_OBJECTS;
+        pool->slabs = g_slist_prepend(pool->slabs, pool->unused);
+    }
+
+    gpointer object = pool->unused;
+    pool->unused += pool->object_size;
+    pool->unused_count--;
+
+    return object;
+}
+
+/*
+ * Return the object to the pool for reuse, object must have come from
+ * pool_alloc on the same pool
+ */
+void
+pool_free(Pool pool, gpointer object)
+{
+    if (object == NULL) {
+        return;
+    }
+
+    PoolFreeObject *free_object = object;
+    free_object->next = pool->free_objects;
+    pool->free_objects = free_object;
+    pool->free_count++;
+}
+
+/*
+ * Return the number of freed objects waiting for reuse
+ */
+guint
+pool_free_count(Pool pool)
+{
+    return pool->free_count;
+}
+
+guint
+pool_slab_count(Pool pool)
+{
+    return g_slist_length(pool->slabs);
+}
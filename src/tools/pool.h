@@ -0,0 +1,37 @@
+/*
+ * pool.h
+ *
+ * Copyright (C) 2012, 2013 James Booth <boothj5@gmail.com>
+ *
+ * This file is part of Profanity.
+ *
+ * Profanity is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Profanity is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Profanity.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef POOL_H
+#define POOL_H
+
+#include <glib.h>
+
+typedef struct pool_t *Pool;
+
+Pool pool_new(gsize object_size);
+void pool_destroy(Pool pool);
+gpointer pool_alloc(Pool pool);
+void pool_free(Pool pool, gpointer object);
+guint pool_free_count(Pool pool);
+guint pool_slab_count(Pool pool);
+
+#endif
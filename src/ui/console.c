@@ -557,16 +557,15 @@ void
 cons_show_sent_subs(void)
 {
    if (roster_has_pending_subscriptions()) {
-        GSList *contacts = roster_get_contacts();
-        PContact contact = NULL;
+        GSList *contacts = roster_get_pending_out();
+        GSList *curr = contacts;
         cons_show("Awaiting subscription responses from:");
-        while (contacts != NULL) {
-            contact = (PContact) contacts->data;
-            if (p_contact_pending_out(contact)) {
-                cons_show("  %s", p_contact_barejid(contact));
-            }
-            contacts = g_slist_next(contacts);
+        while (curr != NULL) {
+            PContact contact = (PContact) curr->data;
+            cons_show("  %s", p_contact_barejid(contact));
+            curr = g_slist_next(curr);
         }
+        g_slist_free(contacts);
     } else {
         cons_show("No pending requests sent.");
     }
@@ -575,30 +574,6 @@ cons_show_sent_subs(void)
     cons_alert();
 }
 
-void
-cons_show_room_list(GSList *rooms, const char * const conference_node)
-{
-    ProfWin *console = wins_get_console();
-    if ((rooms != NULL) && (g_slist_length(rooms) > 0)) {
-        cons_show("Chat rooms at %s:", conference_node);
-        while (rooms != NULL) {
-            DiscoItem *room = rooms->data;
-            win_print_time(console, '-');
-            wprintw(console->win, "  %s", room->jid);
-            if (room->name != NULL) {
-                wprintw(console->win, ", (%s)", room->name);
-            }
-            wprintw(console->win, "\n");
-            rooms = g_slist_next(rooms);
-        }
-    } else {
-        cons_show("No chat rooms at %s", conference_node);
-    }
-
-    wins_refresh_console();
-    cons_alert();
-}
-
 void
 cons_show_bookmarks(const GList *list)
 {
@@ -1015,6 +990,11 @@ cons_notify_setting(void)
     else
         cons_show("Subscription requests (/notify sub) : OFF");
 
+    if (prefs_get_boolean(PREF_NOTIFY_MENTION))
+        cons_show("Room mentions (/notify mention)     : ON");
+    else
+        cons_show("Room mentions (/notify mention)     : OFF");
+
     gint remind_period = prefs_get_notify_remind();
     if (remind_period == 0) {
         cons_show("Reminder period (/notify remind)    : OFF");
@@ -1083,6 +1063,8 @@ cons_history_setting(void)
         cons_show("Chat history (/history)    : ON");
     else
         cons_show("Chat history (/history)    : OFF");
+
+    cons_show("Input history (/history)   : %d lines", prefs_get_max_inphist_size());
 }
 
 void
@@ -1206,6 +1188,17 @@ cons_priority_setting(void)
     cons_show("Priority (/priority) : %d", priority);
 }
 
+void
+cons_autojoin_setting(void)
+{
+    gint autojoin_max = prefs_get_autojoin_max();
+    if (autojoin_max == 1) {
+        cons_show("Autojoin rooms at once (/autojoin) : 1 room");
+    } else {
+        cons_show("Autojoin rooms at once (/autojoin) : %d rooms", autojoin_max);
+    }
+}
+
 void
 cons_show_connection_prefs(void)
 {
@@ -1213,6 +1206,7 @@ cons_show_connection_prefs(void)
     cons_show("");
     cons_reconnect_setting();
     cons_autoping_setting();
+    cons_autojoin_setting();
 
     wins_refresh_console();
     cons_alert();
@@ -47,12 +47,19 @@
 #include "jid.h"
 #include "log.h"
 #include "muc.h"
+#include "room_list.h"
 #include "ui/notifier.h"
 #include "ui/ui.h"
 #include "ui/window.h"
 #include "ui/windows.h"
 #include "xmpp/xmpp.h"
 
+// number of the most active nicks named in a room digest
+#define DIGEST_TOP_NICKS 5
+
+// recipient of the window showing chat room listings
+#define ROOM_LIST_WIN "Room list"
+
 static char *win_title;
 
 #ifdef HAVE_LIBXSS
@@ -63,6 +70,10 @@ static GTimer *ui_idle_time;
 
 static void _win_show_user(WINDOW *win, const char * const user, const int colour);
 static void _win_show_message(WINDOW *win, const char * const message);
+static void _win_show_highlighted_message(WINDOW *win,
+    const char * const message, GSList *matches);
+static gint _compare_digest_counts(gconstpointer a, gconstpointer b,
+    gpointer counts);
 static void _win_show_error_msg(WINDOW *win, const char * const message);
 static void _show_status_string(ProfWin *window, const char * const from,
     const char * const show, const char * const status,
@@ -73,6 +84,9 @@ static void _win_handle_page(const wint_t * const ch);
 static void _win_show_history(WINDOW *win, int win_index,
     const char * const contact);
 static void _ui_draw_win_title(void);
+static ProfWin * _room_list_win(void);
+static void _room_list_win_refresh(ProfWin *window);
+static void _win_show_room_list_item(ProfWin *window, DiscoItem *room);
 
 void
 ui_init(void)
@@ -402,9 +416,39 @@ ui_group_removed(const char * const contact, const char * const group)
     cons_show("%s removed from group %s", contact, group);
 }
 
+void
+ui_roster_bulk_progress(const char * const description, const int done,
+    const int total)
+{
+    cons_show("%s: %d of %d contacts done", description, done, total);
+}
+
+void
+ui_autojoin_progress(const int joined, const int total)
+{
+    cons_show("Autojoin: %d of %d bookmarked rooms done", joined, total);
+}
+
+void
+ui_roster_bulk_complete(const char * const description, const int succeeded,
+    const int failed)
+{
+    if (failed > 0) {
+        cons_show("%s: %d contacts updated, %d failed", description, succeeded,
+            failed);
+    } else {
+        cons_show("%s: %d contacts updated", description, succeeded);
+    }
+}
+
+/*
+ * Show the contact coming online in the console, when in_console is set,
+ * and in any open chat window with the contact
+ */
 void
 ui_contact_online(const char * const barejid, const char * const resource,
-    const char * const show, const char * const status, GDateTime *last_activity)
+    const char * const show, const char * const status, GDateTime *last_activity,
+    const gboolean in_console)
 {
     Jid *jid = jid_create_from_bare_and_resource(barejid, resource);
     PContact contact = roster_get_contact(barejid);
@@ -425,8 +469,10 @@ ui_contact_online(const char * const barejid, const char * const resource,
     }
 
     ProfWin *console = wins_get_console();
-    _show_status_string(console, display_str->str, show, status, last_activity,
-        "++", "online");
+    if (in_console) {
+        _show_status_string(console, display_str->str, show, status,
+            last_activity, "++", "online");
+    }
 
     ProfWin *window = wins_get_by_recipient(barejid);
     if (window != NULL) {
@@ -437,7 +483,7 @@ ui_contact_online(const char * const barejid, const char * const resource,
     jid_destroy(jid);
     g_string_free(display_str, TRUE);
 
-    if (wins_is_current(console)) {
+    if (in_console && wins_is_current(console)) {
         wins_refresh_current();
     } else if ((window != NULL) && (wins_is_current(window))) {
         wins_refresh_current();
@@ -446,7 +492,7 @@ ui_contact_online(const char * const barejid, const char * const resource,
 
 void
 ui_contact_offline(const char * const from, const char * const show,
-    const char * const status)
+    const char * const status, const gboolean in_console)
 {
     Jid *jidp = jid_create(from);
     PContact contact = roster_get_contact(jidp->barejid);
@@ -467,8 +513,10 @@ ui_contact_offline(const char * const from, const char * const show,
     }
 
     ProfWin *console = wins_get_console();
-    _show_status_string(console, display_str->str, show, status, NULL, "--",
-        "offline");
+    if (in_console) {
+        _show_status_string(console, display_str->str, show, status, NULL,
+            "--", "offline");
+    }
 
     ProfWin *window = wins_get_by_recipient(jidp->barejid);
     if (window != NULL) {
@@ -479,13 +527,41 @@ ui_contact_offline(const char * const from, const char * const show,
     jid_destroy(jidp);
     g_string_free(display_str, TRUE);
 
-    if (wins_is_current(console)) {
+    if (in_console && wins_is_current(console)) {
         wins_refresh_current();
     } else if ((window != NULL) && (wins_is_current(window))) {
         wins_refresh_current();
     }
 }
 
+/*
+ * Show a single line for a burst of contacts changing presence, instead of
+ * a line for each contact
+ */
+void
+ui_contacts_presence_summary(const int online, const int offline)
+{
+    ProfWin *console = wins_get_console();
+
+    if (online > 0) {
+        win_print_time(console, '-');
+        wattron(console->win, COLOUR_ONLINE);
+        wprintw(console->win, "++ %d contacts came online\n", online);
+        wattroff(console->win, COLOUR_ONLINE);
+    }
+
+    if (offline > 0) {
+        win_print_time(console, '-');
+        wattron(console->win, COLOUR_OFFLINE);
+        wprintw(console->win, "-- %d contacts went offline\n", offline);
+        wattroff(console->win, COLOUR_OFFLINE);
+    }
+
+    if (wins_is_current(console)) {
+        wins_refresh_current();
+    }
+}
+
 void
 ui_disconnected(void)
 {
@@ -593,6 +669,7 @@ ui_switch_win(const int i)
         ui_current_page_off();
 
         new_current->unread = 0;
+        new_current->mentions = 0;
 
         if (i == 1) {
             title_bar_title();
@@ -965,6 +1042,85 @@ ui_duck_result(const char * const result)
     }
 }
 
+void
+ui_room_list_start(const char * const service)
+{
+    ProfWin *window = _room_list_win();
+    ui_switch_win(wins_get_num(window));
+    werase(window->win);
+    win_print_time(window, '-');
+    wprintw(window->win, "Fetching chat rooms at %s...\n", service);
+}
+
+/*
+ * Show how much of the listing has been received, the rooms themselves are
+ * shown a page at a time once the listing is complete
+ */
+void
+ui_room_list_progress(const char * const service, const int received,
+    const int count)
+{
+    ProfWin *window = wins_get_by_recipient(ROOM_LIST_WIN);
+    if (window == NULL) {
+        return;
+    }
+
+    werase(window->win);
+    win_print_time(window, '-');
+    wprintw(window->win, "Fetching chat rooms at %s...\n", service);
+    win_print_time(window, '-');
+    wattron(window->win, COLOUR_ONLINE);
+    if (count > 0) {
+        wprintw(window->win, "%d of %d chat rooms received\n", received, count);
+    } else {
+        wprintw(window->win, "%d chat rooms received\n", received);
+    }
+    wattroff(window->win, COLOUR_ONLINE);
+
+    _room_list_win_refresh(window);
+}
+
+/*
+ * Replace the room list window's contents with a page of rooms, page
+ * counted from 0, out of total rooms listed or matching the search
+ */
+void
+ui_room_list_results(const char * const service, GList *rooms,
+    const char * const search, const int page, const int total)
+{
+    ProfWin *window = _room_list_win();
+    ui_switch_win(wins_get_num(window));
+    werase(window->win);
+
+    win_print_time(window, '-');
+    if (search != NULL) {
+        wprintw(window->win, "Chat rooms at %s matching \"%s\":\n", service,
+            search);
+    } else {
+        wprintw(window->win, "Chat rooms at %s:\n", service);
+    }
+
+    while (rooms != NULL) {
+        _win_show_room_list_item(window, rooms->data);
+        rooms = g_list_next(rooms);
+    }
+
+    int pages = (total + ROOM_LIST_PAGE_SIZE - 1) / ROOM_LIST_PAGE_SIZE;
+    win_print_time(window, '-');
+    wattron(window->win, COLOUR_ONLINE);
+    if (total == 0) {
+        wprintw(window->win, "No chat rooms found\n");
+    } else if (pages == 1) {
+        wprintw(window->win, "%d chat rooms\n", total);
+    } else {
+        wprintw(window->win, "Page %d of %d, %d chat rooms, use /rooms next and /rooms prev to see the others\n",
+            page + 1, pages, total);
+    }
+    wattroff(window->win, COLOUR_ONLINE);
+
+    _room_list_win_refresh(window);
+}
+
 void
 ui_outgoing_msg(const char * const from, const char * const to,
     const char * const message)
@@ -1087,6 +1243,46 @@ ui_room_roster(const char * const room, GList *roster, const char * const presen
     }
 }
 
+/*
+ * Show the number of occupants in a lurked room, and its recent speakers
+ */
+void
+ui_room_lurking(const char * const room)
+{
+    ProfWin *window = wins_get_by_recipient(room);
+    if (window == NULL) {
+        return;
+    }
+
+    win_print_time(window, '!');
+    wattron(window->win, COLOUR_ROOMINFO);
+    wprintw(window->win, "Lurking, %d participants",
+        muc_get_occupant_count(room) + 1);
+
+    GList *speakers = muc_get_speakers(room);
+    if (speakers == NULL) {
+        wprintw(window->win, ".\n");
+        wattroff(window->win, COLOUR_ROOMINFO);
+    } else {
+        wprintw(window->win, ", recent speakers: ");
+        wattroff(window->win, COLOUR_ROOMINFO);
+        GList *curr = speakers;
+        while (curr != NULL) {
+            wprintw(window->win, "%s", curr->data);
+            if (curr->next != NULL) {
+                wprintw(window->win, ", ");
+            }
+            curr = g_list_next(curr);
+        }
+        wprintw(window->win, "\n");
+    }
+    g_list_free(speakers);
+
+    if (wins_is_current(window)) {
+        wins_refresh_current();
+    }
+}
+
 void
 ui_room_member_offline(const char * const room, const char * const nick)
 {
@@ -1169,6 +1365,9 @@ ui_room_history(const char * const room_jid, const char * const nick,
     GTimeVal tv_stamp, const char * const message)
 {
     ProfWin *window = wins_get_by_recipient(room_jid);
+    if (window == NULL) {
+        return;
+    }
 
     GDateTime *time = g_date_time_new_from_timeval_utc(&tv_stamp);
     gchar *date_fmt = g_date_time_format(time, "%H:%M:%S");
@@ -1184,10 +1383,6 @@ ui_room_history(const char * const room_jid, const char * const nick,
         wprintw(window->win, "%s: ", nick);
         _win_show_message(window->win, message);
     }
-
-    if (wins_is_current(window)) {
-        wins_refresh_current();
-    }
 }
 
 void
@@ -1196,6 +1391,13 @@ ui_room_message(const char * const room_jid, const char * const nick,
 {
     ProfWin *window = wins_get_by_recipient(room_jid);
     int num = wins_get_num(window);
+    GSList *matches = NULL;
+
+    // look for mentions in messages from others
+    if (strcmp(nick, muc_get_room_nick(room_jid)) != 0) {
+        matches = highlighter_find(muc_get_highlighter(room_jid), message);
+    }
+    gboolean mention = (matches != NULL);
 
     win_print_time(window, '-');
     if (strcmp(nick, muc_get_room_nick(room_jid)) != 0) {
@@ -1207,7 +1409,7 @@ ui_room_message(const char * const room_jid, const char * const nick,
             wattroff(window->win, COLOUR_THEM);
         } else {
             _win_show_user(window->win, nick, 1);
-            _win_show_message(window->win, message);
+            _win_show_highlighted_message(window->win, message, matches);
         }
 
     } else {
@@ -1223,8 +1425,9 @@ ui_room_message(const char * const room_jid, const char * const nick,
         }
     }
 
-    // currently in groupchat window
+    // currently in groupchat window, any mentions have been seen
     if (wins_is_current(window)) {
+        window->mentions = 0;
         status_bar_active(num);
         wins_refresh_current();
 
@@ -1243,6 +1446,9 @@ ui_room_message(const char * const room_jid, const char * const nick,
         }
 
         window->unread++;
+        if (mention) {
+            window->mentions++;
+        }
     }
 
     int ui_index = num;
@@ -1254,12 +1460,15 @@ ui_room_message(const char * const room_jid, const char * const nick,
         if (prefs_get_boolean(PREF_BEEP)) {
             beep();
         }
-        if (prefs_get_boolean(PREF_NOTIFY_MESSAGE)) {
+        if (prefs_get_boolean(PREF_NOTIFY_MESSAGE) ||
+                (mention && prefs_get_boolean(PREF_NOTIFY_MENTION))) {
             Jid *jidp = jid_create(room_jid);
             notify_room_message(nick, jidp->localpart, ui_index);
             jid_destroy(jidp);
         }
     }
+
+    g_slist_free_full(matches, free);
 }
 
 void
@@ -1285,6 +1494,84 @@ ui_room_subject(const char * const room_jid, const char * const subject)
     }
 }
 
+/*
+ * Show a summary of the messages collected while a digest mode room was
+ * not focused, the most active nicks followed by the latest messages
+ */
+void
+ui_room_digest(const char * const room_jid, RoomDigest *digest)
+{
+    ProfWin *window = wins_get_by_recipient(room_jid);
+    if (window == NULL) {
+        return;
+    }
+    int num = wins_get_num(window);
+
+    GList *nicks = g_hash_table_get_keys(digest->counts);
+    nicks = g_list_sort_with_data(nicks, _compare_digest_counts,
+        digest->counts);
+
+    GString *summary = g_string_new("");
+    g_string_printf(summary, "%d messages", digest->total);
+    if (digest->mentions > 0) {
+        g_string_append_printf(summary, ", %d mentions", digest->mentions);
+    }
+    g_string_append(summary, " from ");
+
+    int shown = 0;
+    GList *curr = nicks;
+    while (curr != NULL && shown < DIGEST_TOP_NICKS) {
+        int count = GPOINTER_TO_INT(g_hash_table_lookup(digest->counts,
+            curr->data));
+        if (shown > 0) {
+            g_string_append(summary, ", ");
+        }
+        g_string_append_printf(summary, "%s (%d)", (char *)curr->data, count);
+        shown++;
+        curr = g_list_next(curr);
+    }
+    int others = g_list_length(nicks) - shown;
+    if (others > 0) {
+        g_string_append_printf(summary, " and %d others", others);
+    }
+    g_list_free(nicks);
+
+    win_print_time(window, '!');
+    wattron(window->win, COLOUR_ROOMINFO);
+    wprintw(window->win, "Digest: ");
+    wattroff(window->win, COLOUR_ROOMINFO);
+    wprintw(window->win, "%s\n", summary->str);
+    g_string_free(summary, TRUE);
+
+    GList *lines = g_queue_peek_head_link(digest->lines);
+    while (lines != NULL) {
+        DigestLine *line = lines->data;
+        wprintw(window->win, "  %s: ", line->nick);
+        _win_show_message(window->win, line->message);
+        lines = g_list_next(lines);
+    }
+
+    // currently in groupchat window, any mentions have been seen
+    if (wins_is_current(window)) {
+        window->mentions = 0;
+        status_bar_active(num);
+        wins_refresh_current();
+
+    // not currenlty on groupchat window
+    } else {
+        status_bar_new(num);
+        window->unread += digest->total;
+        window->mentions += digest->mentions;
+    }
+}
+
+gboolean
+ui_room_is_current(const char * const room_jid)
+{
+    ProfWin *window = wins_get_by_recipient(room_jid);
+    return ((window != NULL) && wins_is_current(window));
+}
+
 void
 ui_room_broadcast(const char * const room_jid, const char * const message)
 {
@@ -1438,6 +1725,41 @@ _win_show_message(WINDOW *win, const char * const message)
     wprintw(win, "\n");
 }
 
+/*
+ * Show the message with each matched part in the highlight colour
+ */
+static void
+_win_show_highlighted_message(WINDOW *win, const char * const message,
+    GSList *matches)
+{
+    int pos = 0;
+    while (matches != NULL) {
+        HighlightMatch *match = matches->data;
+        waddnstr(win, message + pos, match->start - pos);
+        wattron(win, COLOUR_HIGHLIGHT);
+        waddnstr(win, message + match->start, match->end - match->start);
+        wattroff(win, COLOUR_HIGHLIGHT);
+        pos = match->end;
+        matches = g_slist_next(matches);
+    }
+    _win_show_message(win, message + pos);
+}
+
+/*
+ * Order digest nicks by their message count, most active first
+ */
+static gint
+_compare_digest_counts(gconstpointer a, gconstpointer b, gpointer counts)
+{
+    int count_a = GPOINTER_TO_INT(g_hash_table_lookup(counts, a));
+    int count_b = GPOINTER_TO_INT(g_hash_table_lookup(counts, b));
+    if (count_a != count_b) {
+        return count_b - count_a;
+    }
+
+    return g_strcmp0(a, b);
+}
+
 static void
 _win_show_error_msg(WINDOW *win, const char * const message)
 {
@@ -1651,3 +1973,35 @@ _win_show_history(WINDOW *win, int win_index, const char * const contact)
         g_slist_free_full(history, free);
     }
 }
+
+static ProfWin *
+_room_list_win(void)
+{
+    ProfWin *window = wins_get_by_recipient(ROOM_LIST_WIN);
+    if (window == NULL) {
+        window = wins_new(ROOM_LIST_WIN, WIN_ROOMS);
+    }
+
+    return window;
+}
+
+static void
+_room_list_win_refresh(ProfWin *window)
+{
+    if (wins_is_current(window)) {
+        wins_refresh_current();
+    } else {
+        status_bar_new(wins_get_num(window));
+    }
+}
+
+static void
+_win_show_room_list_item(ProfWin *window, DiscoItem *room)
+{
+    win_print_time(window, '-');
+    wprintw(window->win, "  %s", room->jid);
+    if (room->name != NULL) {
+        wprintw(window->win, ", (%s)", room->name);
+    }
+    wprintw(window->win, "\n");
+}
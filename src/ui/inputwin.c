@@ -49,12 +49,21 @@ static WINDOW *inp_win;
 static int pad_start = 0;
 static int rows, cols;
 
+// reverse history search state
+static gboolean searching = FALSE;
+static GString *search_query = NULL;
+static char *search_original = NULL;
+
 static int _handle_edit(int result, const wint_t ch, char *input, int *size);
 static int _handle_alt_key(char *input, int *size, int key);
 static void _handle_backspace(int display_size, int inp_x, int *size, char *input);
 static int _printable(const wint_t ch);
 static void _clear_input(void);
 static void _go_to_end(int display_size);
+static int _handle_search(int result, const wint_t ch, char *input, int *size);
+static void _search_start(char *input, int *size);
+static void _search_end(void);
+static void _search_show_status(gboolean found);
 
 void
 create_input_window(void)
@@ -118,6 +127,11 @@ inp_get_char(char *input, int *size)
     noecho();
     int result = wget_wch(inp_win, &ch);
 
+    if (searching && (result != ERR) && _handle_search(result, ch, input, size)) {
+        echo();
+        return ch;
+    }
+
     gboolean in_command = FALSE;
     if ((display_size > 0 && input[0] == '/') ||
             (display_size == 0 && ch == '/')) {
@@ -495,6 +509,13 @@ _handle_edit(int result, const wint_t ch, char *input, int *size)
             cmd_autocomplete(input, size);
             return 1;
 
+        case 18: // CTRL-R
+            if (result == KEY_CODE_YES) {
+                return 0;
+            }
+            _search_start(input, size);
+            return 1;
+
         default:
             return 0;
         }
@@ -696,6 +717,104 @@ _go_to_end(int display_size)
     }
 }
 
+/*
+ * Handle a key press during reverse history search, return 1 if the key
+ * was used by the search, 0 if the search ended and the key should be
+ * handled as normal
+ */
+static int
+_handle_search(int result, const wint_t ch, char *input, int *size)
+{
+    char *found = NULL;
+
+    // CTRL-R, next older match
+    if ((result != KEY_CODE_YES) && (ch == 18)) {
+        found = cmd_history_search_older();
+
+    // ESC or CTRL-G, cancel and restore input
+    } else if ((result != KEY_CODE_YES) && ((ch == 27) || (ch == 7))) {
+        inp_replace_input(input, search_original, size);
+        _search_end();
+        return 1;
+
+    // backspace, drop last character from query
+    } else if (((result != KEY_CODE_YES) && (ch == 127)) ||
+            ((result == KEY_CODE_YES) && (ch == KEY_BACKSPACE))) {
+        if (search_query->len > 0) {
+            gchar *last = g_utf8_find_prev_char(search_query->str,
+                &search_query->str[search_query->len]);
+            g_string_truncate(search_query, last - search_query->str);
+        }
+        found = cmd_history_search(search_query->str);
+
+    // printable, add to query
+    } else if ((result != KEY_CODE_YES) && _printable(ch)) {
+        char bytes[MB_CUR_MAX+1];
+        size_t utf_len = wcrtomb(bytes, ch, NULL);
+        if (utf_len < MB_CUR_MAX + 1) {
+            g_string_append_len(search_query, bytes, utf_len);
+        }
+        found = cmd_history_search(search_query->str);
+
+    // anything else accepts the current match
+    } else {
+        _search_end();
+        return 0;
+    }
+
+    if (found != NULL) {
+        inp_replace_input(input, found, size);
+        free(found);
+        _search_show_status(TRUE);
+    } else {
+        _search_show_status(search_query->len == 0);
+    }
+
+    return 1;
+}
+
+static void
+_search_start(char *input, int *size)
+{
+    input[*size] = '\0';
+    search_original = strdup(input);
+    search_query = g_string_new("");
+    searching = TRUE;
+    cmd_history_search_start();
+    _search_show_status(TRUE);
+}
+
+static void
+_search_end(void)
+{
+    searching = FALSE;
+    g_string_free(search_query, TRUE);
+    search_query = NULL;
+    FREE_SET_NULL(search_original);
+    cmd_history_search_end();
+
+    if (jabber_get_connection_status() == JABBER_CONNECTED) {
+        Jid *jid = jid_create(jabber_get_fulljid());
+        status_bar_print_message(jid->barejid);
+        jid_destroy(jid);
+    } else {
+        status_bar_clear_message();
+    }
+}
+
+static void
+_search_show_status(gboolean found)
+{
+    GString *msg = g_string_new("");
+    if (found) {
+        g_string_append_printf(msg, "(reverse-i-search)`%s'", search_query->str);
+    } else {
+        g_string_append_printf(msg, "(failed reverse-i-search)`%s'", search_query->str);
+    }
+    status_bar_print_message(msg->str);
+    g_string_free(msg, TRUE);
+}
+
 static int
 _printable(const wint_t ch)
 {
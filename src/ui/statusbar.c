@@ -121,7 +121,7 @@ status_bar_resize(void)
     _update_win_statuses();
 
     if (message != NULL)
-        mvwprintw(status_bar, 0, 10, message);
+        mvwprintw(status_bar, 0, 10, "%s", message);
 
     if (last_time != NULL)
         g_date_time_unref(last_time);
@@ -257,7 +257,7 @@ status_bar_print_message(const char * const msg)
     }
     message = (char *) malloc(strlen(msg) + 1);
     strcpy(message, msg);
-    mvwprintw(status_bar, 0, 10, message);
+    mvwprintw(status_bar, 0, 10, "%s", message);
 
     int cols = getmaxx(stdscr);
 
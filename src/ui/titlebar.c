@@ -34,8 +34,14 @@ static GTimer *typing_elapsed;
 static int dirty;
 static contact_presence_t current_status;
 
+// contacts online and in the roster, shown left of the status
+static int contacts_online = 0;
+static int contacts_total = 0;
+#define CONTACTS_WIDTH 16
+
 static void _title_bar_draw_title(void);
 static void _title_bar_draw_status(void);
+static void _title_bar_draw_contacts(void);
 
 void
 create_title_bar(void)
@@ -125,6 +131,16 @@ title_bar_set_status(contact_presence_t status)
     _title_bar_draw_status();
 }
 
+void
+title_bar_set_contacts(const int online, const int total)
+{
+    if ((online != contacts_online) || (total != contacts_total)) {
+        contacts_online = online;
+        contacts_total = total;
+        _title_bar_draw_contacts();
+    }
+}
+
 void
 title_bar_set_recipient(const char * const from)
 {
@@ -213,6 +229,32 @@ _title_bar_draw_status(void)
     mvwaddch(title_bar, 0, cols - 2, ']');
     wattroff(title_bar, COLOUR_TITLE_BRACKET);
 
+    _title_bar_draw_contacts();
+
+    dirty = TRUE;
+}
+
+static void
+_title_bar_draw_contacts(void)
+{
+    int cols = getmaxx(stdscr);
+    int start = cols - 14 - CONTACTS_WIDTH;
+    if (start < 46) {
+        return;
+    }
+
+    wmove(title_bar, 0, start);
+    int i;
+    for (i = 0; i < CONTACTS_WIDTH; i++)
+        waddch(title_bar, ' ');
+
+    if (contacts_total > 0) {
+        char counts[CONTACTS_WIDTH + 1];
+        snprintf(counts, sizeof(counts), "%d/%d ", contacts_online,
+            contacts_total);
+        mvwprintw(title_bar, 0, cols - 14 - strlen(counts), "%s", counts);
+    }
+
     dirty = TRUE;
 }
 
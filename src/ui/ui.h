@@ -36,6 +36,7 @@
 
 #include "contact.h"
 #include "jid.h"
+#include "muc.h"
 #include "ui/window.h"
 #include "xmpp/xmpp.h"
 
@@ -83,19 +84,24 @@ void ui_contact_typing(const char * const from);
 void ui_incoming_msg(const char * const from, const char * const message,
     GTimeVal *tv_stamp, gboolean priv);
 void ui_contact_online(const char * const barejid, const char * const resource,
-    const char * const show, const char * const status, GDateTime *last_activity);
+    const char * const show, const char * const status, GDateTime *last_activity,
+    const gboolean in_console);
 void ui_contact_offline(const char * const from, const char * const show,
-    const char * const status);
+    const char * const status, const gboolean in_console);
+void ui_contacts_presence_summary(const int online, const int offline);
 void ui_disconnected(void);
 void ui_recipient_gone(const char * const barejid);
 void ui_outgoing_msg(const char * const from, const char * const to,
     const char * const message);
 void ui_room_join(Jid *jid);
 void ui_room_roster(const char * const room, GList *roster, const char * const presence);
+void ui_room_lurking(const char * const room);
 void ui_room_history(const char * const room_jid, const char * const nick,
     GTimeVal tv_stamp, const char * const message);
 void ui_room_message(const char * const room_jid, const char * const nick,
     const char * const message);
+void ui_room_digest(const char * const room_jid, RoomDigest *digest);
+gboolean ui_room_is_current(const char * const room_jid);
 void ui_room_subject(const char * const room_jid,
     const char * const subject);
 void ui_room_broadcast(const char * const room_jid,
@@ -114,6 +120,11 @@ void ui_contact_already_in_group(const char * const contact, const char * const
 void ui_contact_not_in_group(const char * const contact, const char * const group);
 void ui_group_added(const char * const contact, const char * const group);
 void ui_group_removed(const char * const contact, const char * const group);
+void ui_roster_bulk_progress(const char * const description, const int done,
+    const int total);
+void ui_autojoin_progress(const int joined, const int total);
+void ui_roster_bulk_complete(const char * const description,
+    const int succeeded, const int failed);
 
 // contact status functions
 void ui_status_room(const char * const contact);
@@ -124,6 +135,11 @@ void ui_create_duck_win(void);
 void ui_open_duck_win(void);
 void ui_duck(const char * const query);
 void ui_duck_result(const char * const result);
+void ui_room_list_start(const char * const service);
+void ui_room_list_progress(const char * const service, const int received,
+    const int count);
+void ui_room_list_results(const char * const service, GList *rooms,
+    const char * const search, const int page, const int total);
 gboolean ui_duck_exists(void);
 
 void ui_tidy_wins(void);
@@ -140,6 +156,7 @@ void title_bar_resize(void);
 void title_bar_show(const char * const title);
 void title_bar_title(void);
 void title_bar_set_status(contact_presence_t status);
+void title_bar_set_contacts(const int online, const int total);
 void title_bar_set_recipient(const char * const from);
 void title_bar_set_typing(gboolean is_typing);
 void title_bar_draw(void);
@@ -178,7 +195,6 @@ void cons_show_software_version(const char * const jid,
     const char * const presence, const char * const name,
     const char * const version, const char * const os);
 void cons_show_account_list(gchar **accounts);
-void cons_show_room_list(GSList *room, const char * const conference_node);
 void cons_show_bookmarks(const GList *list);
 void cons_show_disco_items(GSList *items, const char * const jid);
 void cons_show_disco_info(const char *from, GSList *identities, GSList *features);
@@ -212,6 +228,7 @@ void cons_grlog_setting(void);
 void cons_autoaway_setting(void);
 void cons_reconnect_setting(void);
 void cons_autoping_setting(void);
+void cons_autojoin_setting(void);
 void cons_priority_setting(void);
 
 // status bar actions
@@ -45,6 +45,7 @@ win_create(const char * const title, int cols, win_type_t type)
     new_win->y_pos = 0;
     new_win->paged = 0;
     new_win->unread = 0;
+    new_win->mentions = 0;
     new_win->history_shown = 0;
     new_win->type = type;
     scrollok(new_win->win, TRUE);
@@ -41,7 +41,8 @@ typedef enum {
     WIN_CHAT,
     WIN_MUC,
     WIN_PRIVATE,
-    WIN_DUCK
+    WIN_DUCK,
+    WIN_ROOMS
 } win_type_t;
 
 typedef struct prof_win_t {
@@ -51,6 +52,7 @@ typedef struct prof_win_t {
     int y_pos;
     int paged;
     int unread;
+    int mentions;
     int history_shown;
 } ProfWin;
 
@@ -383,6 +383,7 @@ wins_create_summary(void)
         GString *priv_string;
         GString *muc_string;
         GString *duck_string;
+        GString *rooms_string;
 
         switch (window->type)
         {
@@ -443,6 +444,11 @@ wins_create_summary(void)
                     g_string_free(muc_unread, TRUE);
                 }
 
+                if (window->mentions > 0) {
+                    g_string_append_printf(muc_string, ", %d mentions",
+                        window->mentions);
+                }
+
                 result = g_slist_append(result, strdup(muc_string->str));
                 g_string_free(muc_string, TRUE);
 
@@ -456,6 +462,14 @@ wins_create_summary(void)
 
                 break;
 
+            case WIN_ROOMS:
+                rooms_string = g_string_new("");
+                g_string_printf(rooms_string, "%d: Room list", ui_index);
+                result = g_slist_append(result, strdup(rooms_string->str));
+                g_string_free(rooms_string, TRUE);
+
+                break;
+
             default:
                 break;
         }
@@ -8,6 +8,8 @@
 
 #include "log.h"
 #include "muc.h"
+#include "profanity.h"
+#include "config/preferences.h"
 #include "ui/ui.h"
 #include "xmpp/connection.h"
 #include "xmpp/stanza.h"
@@ -15,19 +17,35 @@
 #include "xmpp/bookmark.h"
 
 #define BOOKMARK_TIMEOUT 5000
-/* TODO: replace with a preference */
-#define BOOKMARK_AUTOJOIN_MAX 5
 
-static int autojoin_count;
+// an autojoin which has not received the room roster after this many seconds
+// no longer holds back the remaining rooms
+#define BOOKMARK_AUTOJOIN_TIMEOUT 30
+#define BOOKMARK_AUTOJOIN_CHECK 1000
 
 static Autocomplete bookmark_ac;
 static GList *bookmark_list;
 
+// autojoin rooms not yet joined, as room/nick jids in the order to join them
+static GList *autojoin_queue;
+// rooms joined but awaiting their roster, room to time since joining
+static GHashTable *autojoin_pending;
+static int autojoin_total;
+static int autojoin_done;
+
 static int _bookmark_handle_result(xmpp_conn_t * const conn,
     xmpp_stanza_t * const stanza, void * const userdata);
 static int _bookmark_handle_delete(xmpp_conn_t * const conn,
     void * const userdata);
 static void _bookmark_item_destroy(gpointer item);
+static void _autojoin_start(GList *rooms);
+static void _autojoin_send_next(void);
+static void _autojoin_room_done(void);
+static void _autojoin_clear(void);
+static int _autojoin_handle_timeout(xmpp_conn_t * const conn,
+    void * const userdata);
+static gint _autojoin_compare(gconstpointer a, gconstpointer b,
+    gpointer ranks);
 
 void
 bookmark_request(void)
@@ -42,7 +60,8 @@ bookmark_request(void)
         return;
     }
 
-    autojoin_count = 0;
+    xmpp_timed_handler_delete(conn, _autojoin_handle_timeout);
+    _autojoin_clear();
     if (bookmark_ac != NULL) {
         autocomplete_free(bookmark_ac);
     }
@@ -96,6 +115,22 @@ bookmark_find(char *search_str)
     return autocomplete_complete(bookmark_ac, search_str);
 }
 
+/*
+ * Call when the roster of a room has been received, allowing the next
+ * queued autojoin room to be joined
+ */
+void
+bookmark_autojoin_complete(const char * const room)
+{
+    if ((autojoin_pending == NULL) ||
+            !g_hash_table_remove(autojoin_pending, room)) {
+        return;
+    }
+
+    _autojoin_room_done();
+    _autojoin_send_next();
+}
+
 void
 bookmark_autocomplete_reset(void)
 {
@@ -118,6 +153,7 @@ _bookmark_handle_result(xmpp_conn_t * const conn,
     gboolean autojoin_val;
     Jid *my_jid;
     Bookmark *item;
+    GList *autojoin_rooms = NULL;
 
     xmpp_timed_handler_delete(conn, _bookmark_handle_delete);
     g_free(id);
@@ -184,26 +220,13 @@ _bookmark_handle_result(xmpp_conn_t * const conn,
 
         /* TODO: preference whether autojoin */
         if (autojoin_val) {
-            if (autojoin_count < BOOKMARK_AUTOJOIN_MAX) {
-                Jid *room_jid;
-
-                ++autojoin_count;
-
-                if (name == NULL) {
-                    name = my_jid->localpart;
-                }
-
-                log_debug("Autojoin %s with nick=%s", jid, name);
-                room_jid = jid_create_from_bare_and_resource(jid, name);
-                if (!muc_room_is_active(room_jid)) {
-                    presence_join_room(room_jid);
-                    /* TODO: this should be removed after fixing #195 */
-                    ui_room_join(room_jid);
-                }
-                jid_destroy(room_jid);
-            } else {
-                log_debug("Rejected autojoin %s (maximum has been reached)", jid);
+            if (name == NULL) {
+                name = my_jid->localpart;
             }
+
+            log_debug("Autojoin %s with nick=%s", jid, name);
+            autojoin_rooms = g_list_append(autojoin_rooms,
+                jid_create_from_bare_and_resource(jid, name));
         }
 
         ptr = xmpp_stanza_get_next(ptr);
@@ -211,6 +234,8 @@ _bookmark_handle_result(xmpp_conn_t * const conn,
 
     jid_destroy(my_jid);
 
+    _autojoin_start(autojoin_rooms);
+
     return 0;
 }
 
@@ -243,3 +268,150 @@ _bookmark_item_destroy(gpointer item)
     free(p->nick);
     free(p);
 }
+
+/*
+ * Join the rooms a few at a time, rooms the user has recently sent messages
+ * to first, so that the presences and history of every room do not arrive
+ * at once
+ */
+static void
+_autojoin_start(GList *rooms)
+{
+    if (rooms == NULL) {
+        return;
+    }
+
+    GHashTable *ranks = g_hash_table_new_full(g_str_hash, g_str_equal, free,
+        NULL);
+    GSList *recent = prefs_get_recent_rooms();
+    GSList *curr = recent;
+    int rank = 1;
+    while (curr != NULL) {
+        g_hash_table_insert(ranks, strdup(curr->data), GINT_TO_POINTER(rank++));
+        curr = g_slist_next(curr);
+    }
+    g_slist_free_full(recent, free);
+
+    autojoin_queue = g_list_sort_with_data(rooms, _autojoin_compare, ranks);
+    g_hash_table_destroy(ranks);
+
+    autojoin_pending = g_hash_table_new_full(g_str_hash, g_str_equal, free,
+        (GDestroyNotify)g_timer_destroy);
+    autojoin_total = g_list_length(autojoin_queue);
+    autojoin_done = 0;
+
+    _autojoin_send_next();
+
+    if (g_hash_table_size(autojoin_pending) > 0) {
+        xmpp_timed_handler_add(connection_get_conn(), _autojoin_handle_timeout,
+            BOOKMARK_AUTOJOIN_CHECK, NULL);
+    }
+}
+
+static void
+_autojoin_send_next(void)
+{
+    int max = prefs_get_autojoin_max();
+
+    while ((autojoin_queue != NULL) &&
+            (g_hash_table_size(autojoin_pending) < max)) {
+        Jid *room_jid = autojoin_queue->data;
+        autojoin_queue = g_list_delete_link(autojoin_queue, autojoin_queue);
+
+        if (muc_room_is_active(room_jid)) {
+            _autojoin_room_done();
+        } else {
+            presence_join_room(room_jid);
+            /* TODO: this should be removed after fixing #195 */
+            ui_room_join(room_jid);
+            g_hash_table_insert(autojoin_pending, strdup(room_jid->barejid),
+                g_timer_new());
+        }
+        jid_destroy(room_jid);
+    }
+}
+
+static void
+_autojoin_room_done(void)
+{
+    autojoin_done++;
+
+    int max = prefs_get_autojoin_max();
+    if ((autojoin_done == autojoin_total) || (autojoin_done % max == 0)) {
+        prof_handle_autojoin_progress(autojoin_done, autojoin_total);
+    }
+}
+
+static void
+_autojoin_clear(void)
+{
+    g_list_free_full(autojoin_queue, (GDestroyNotify)jid_destroy);
+    autojoin_queue = NULL;
+    if (autojoin_pending != NULL) {
+        g_hash_table_destroy(autojoin_pending);
+        autojoin_pending = NULL;
+    }
+    autojoin_total = 0;
+    autojoin_done = 0;
+}
+
+/*
+ * Stop waiting for rooms which have not sent their roster, the handler
+ * remains until every autojoin room has been joined
+ */
+static int
+_autojoin_handle_timeout(xmpp_conn_t * const conn, void * const userdata)
+{
+    if (autojoin_pending == NULL) {
+        return 0;
+    }
+
+    GHashTableIter iter;
+    gpointer key;
+    gpointer value;
+    int timed_out = 0;
+
+    g_hash_table_iter_init(&iter, autojoin_pending);
+    while (g_hash_table_iter_next(&iter, &key, &value)) {
+        if (g_timer_elapsed(value, NULL) >= BOOKMARK_AUTOJOIN_TIMEOUT) {
+            log_warning("Autojoin %s timed out waiting for room roster",
+                (char *)key);
+            g_hash_table_iter_remove(&iter);
+            timed_out++;
+        }
+    }
+
+    while (timed_out-- > 0) {
+        _autojoin_room_done();
+    }
+    _autojoin_send_next();
+
+    if ((autojoin_queue == NULL) && (g_hash_table_size(autojoin_pending) == 0)) {
+        return 0;
+    } else {
+        return 1;
+    }
+}
+
+/*
+ * Order autojoin rooms by their position in the recent rooms, keeping the
+ * bookmark order for the rest
+ */
+static gint
+_autojoin_compare(gconstpointer a, gconstpointer b, gpointer ranks)
+{
+    const Jid *room_a = a;
+    const Jid *room_b = b;
+    int rank_a = GPOINTER_TO_INT(g_hash_table_lookup(ranks, room_a->barejid));
+    int rank_b = GPOINTER_TO_INT(g_hash_table_lookup(ranks, room_b->barejid));
+
+    if (rank_a == rank_b) {
+        return 0;
+    } else if (rank_a == 0) {
+        return 1;
+    } else if (rank_b == 0) {
+        return -1;
+    } else {
+        return rank_a - rank_b;
+    }
+}
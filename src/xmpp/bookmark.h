@@ -18,5 +18,6 @@ void bookmark_remove(const char *jid, gboolean autojoin);
 const GList *bookmark_get_list(void);
 char *bookmark_find(char *search_str);
 void bookmark_autocomplete_reset(void);
+void bookmark_autojoin_complete(const char * const room);
 
 #endif
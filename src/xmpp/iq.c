@@ -42,6 +42,9 @@
 
 #define HANDLE(ns, type, func) xmpp_handler_add(conn, func, ns, STANZA_NAME_IQ, type, ctx)
 
+// chat rooms requested in each page of a room list
+#define ROOM_LIST_PAGE_SIZE 200
+
 static int _iq_handle_error(xmpp_conn_t * const conn,
     xmpp_stanza_t * const stanza, void * const userdata);
 static int _iq_handle_ping_get(xmpp_conn_t * const conn,
@@ -58,6 +61,10 @@ static int _iq_handle_discoitems_result(xmpp_conn_t * const conn,
     xmpp_stanza_t * const stanza, void * const userdata);
 static int _iq_handle_discoitems_get(xmpp_conn_t * const conn,
     xmpp_stanza_t * const stanza, void * const userdata);
+static void _send_room_list_page(const char * const conferencejid,
+    const char * const after);
+static void _handle_room_list_page(xmpp_stanza_t * const query,
+    const char * const from, GSList *items);
 
 void
 iq_add_handlers(void)
@@ -74,14 +81,14 @@ iq_add_handlers(void)
     HANDLE(STANZA_NS_PING,      STANZA_TYPE_GET,    _iq_handle_ping_get);
 }
 
+/*
+ * Request the chat rooms at the service a page at a time, each page is
+ * passed on as it arrives
+ */
 void
 iq_room_list_request(gchar *conferencejid)
 {
-    xmpp_conn_t * const conn = connection_get_conn();
-    xmpp_ctx_t * const ctx = connection_get_ctx();
-    xmpp_stanza_t *iq = stanza_create_disco_items_iq(ctx, "confreq", conferencejid);
-    xmpp_send(conn, iq);
-    xmpp_stanza_release(iq);
+    _send_room_list_page(conferencejid, NULL);
 }
 
 void
@@ -557,7 +564,9 @@ _iq_handle_discoitems_result(xmpp_conn_t * const conn, xmpp_stanza_t * const sta
     }
 
     if (g_strcmp0(id, "confreq") == 0) {
-        prof_handle_room_list(items, from);
+        xmpp_stanza_t *query = xmpp_stanza_get_child_by_name(stanza,
+            STANZA_NAME_QUERY);
+        _handle_room_list_page(query, from, items);
     } else if (g_strcmp0(id, "discoitemsreq") == 0) {
         prof_handle_disco_items(items, from);
     }
@@ -566,3 +575,61 @@ _iq_handle_discoitems_result(xmpp_conn_t * const conn, xmpp_stanza_t * const sta
 
     return 1;
 }
+
+static void
+_send_room_list_page(const char * const conferencejid,
+    const char * const after)
+{
+    xmpp_conn_t * const conn = connection_get_conn();
+    xmpp_ctx_t * const ctx = connection_get_ctx();
+    xmpp_stanza_t *iq = stanza_create_disco_items_page_iq(ctx, "confreq",
+        conferencejid, ROOM_LIST_PAGE_SIZE, after);
+    xmpp_send(conn, iq);
+    xmpp_stanza_release(iq);
+}
+
+/*
+ * Pass on a page of the room list, and request the next page while the
+ * service returns a result set with items remaining
+ */
+static void
+_handle_room_list_page(xmpp_stanza_t * const query, const char * const from,
+    GSList *items)
+{
+    xmpp_ctx_t * const ctx = connection_get_ctx();
+    char *last = NULL;
+    int count = -1;
+
+    xmpp_stanza_t *set = NULL;
+    if (query != NULL) {
+        set = xmpp_stanza_get_child_by_ns(query, STANZA_NS_RSM);
+    }
+    if (set != NULL) {
+        xmpp_stanza_t *last_st = xmpp_stanza_get_child_by_name(set,
+            STANZA_NAME_LAST);
+        if (last_st != NULL) {
+            last = xmpp_stanza_get_text(last_st);
+        }
+        xmpp_stanza_t *count_st = xmpp_stanza_get_child_by_name(set,
+            STANZA_NAME_COUNT);
+        if (count_st != NULL) {
+            char *count_str = xmpp_stanza_get_text(count_st);
+            if (count_str != NULL) {
+                count = atoi(count_str);
+                xmpp_free(ctx, count_str);
+            }
+        }
+    }
+
+    prof_handle_room_list_page(items, from, count);
+
+    if ((last != NULL) && (items != NULL)) {
+        _send_room_list_page(from, last);
+    } else {
+        prof_handle_room_list_complete(from);
+    }
+
+    if (last != NULL) {
+        xmpp_free(ctx, last);
+    }
+}
@@ -39,6 +39,10 @@
 
 static Autocomplete sub_requests_ac;
 
+// barejids with a subscription request awaiting our response, kept alongside
+// the autocompleter so lookups do not copy its list
+static GHashTable *sub_requests;
+
 #define HANDLE(ns, type, func) xmpp_handler_add(conn, func, ns, \
                                                 STANZA_NAME_PRESENCE, type, ctx)
 
@@ -56,6 +60,8 @@ static int _available_handler(xmpp_conn_t * const conn,
 static int _room_presence_handler(xmpp_conn_t * const conn,
     xmpp_stanza_t * const stanza, void * const userdata);
 
+static void _sub_request_add(const char * const barejid);
+static void _sub_request_remove(const char * const barejid);
 static char* _get_caps_key(xmpp_stanza_t * const stanza);
 static void _send_room_presence(xmpp_conn_t *conn, xmpp_stanza_t *presence);
 void _send_caps_request(char *node, char *caps_key, char *id, char *from);
@@ -64,6 +70,7 @@ void
 presence_sub_requests_init(void)
 {
     sub_requests_ac = autocomplete_new();
+    sub_requests = g_hash_table_new_full(g_str_hash, g_str_equal, free, NULL);
 }
 
 void
@@ -91,7 +98,7 @@ presence_subscription(const char * const jid, const jabber_subscr_t action)
 
     Jid *jidp = jid_create(jid);
 
-    autocomplete_remove(sub_requests_ac, jidp->barejid);
+    _sub_request_remove(jidp->barejid);
 
     switch (action)
     {
@@ -131,19 +138,21 @@ presence_get_subscription_requests(void)
 gint
 presence_sub_request_count(void)
 {
-    return autocomplete_length(sub_requests_ac);
+    return g_hash_table_size(sub_requests);
 }
 
 void
 presence_free_sub_requests(void)
 {
     autocomplete_free(sub_requests_ac);
+    g_hash_table_destroy(sub_requests);
 }
 
 void
 presence_clear_sub_requests(void)
 {
     autocomplete_clear(sub_requests_ac);
+    g_hash_table_remove_all(sub_requests);
 }
 
 char *
@@ -155,23 +164,7 @@ presence_sub_request_find(char * search_str)
 gboolean
 presence_sub_request_exists(const char * const bare_jid)
 {
-    gboolean result = FALSE;
-    GSList *requests_p = autocomplete_get_list(sub_requests_ac);
-    GSList *requests = requests_p;
-
-    while (requests != NULL) {
-        if (strcmp(requests->data, bare_jid) == 0) {
-            result = TRUE;
-            break;
-        }
-        requests = g_slist_next(requests);
-    }
-
-    if (requests_p != NULL) {
-        g_slist_free_full(requests_p, free);
-    }
-
-    return result;
+    return g_hash_table_contains(sub_requests, bare_jid);
 }
 
 void
@@ -337,7 +330,7 @@ _unsubscribed_handler(xmpp_conn_t * const conn,
     log_debug("Unsubscribed presence handler fired for %s", from);
 
     prof_handle_subscription(from_jid->barejid, PRESENCE_UNSUBSCRIBED);
-    autocomplete_remove(sub_requests_ac, from_jid->barejid);
+    _sub_request_remove(from_jid->barejid);
 
     jid_destroy(from_jid);
 
@@ -353,7 +346,7 @@ _subscribed_handler(xmpp_conn_t * const conn,
     log_debug("Subscribed presence handler fired for %s", from);
 
     prof_handle_subscription(from_jid->barejid, PRESENCE_SUBSCRIBED);
-    autocomplete_remove(sub_requests_ac, from_jid->barejid);
+    _sub_request_remove(from_jid->barejid);
 
     jid_destroy(from_jid);
 
@@ -373,7 +366,7 @@ _subscribe_handler(xmpp_conn_t * const conn,
     }
 
     prof_handle_subscription(from_jid->barejid, PRESENCE_SUBSCRIBE);
-    autocomplete_add(sub_requests_ac, from_jid->barejid);
+    _sub_request_add(from_jid->barejid);
 
     jid_destroy(from_jid);
 
@@ -657,20 +650,30 @@ _room_presence_handler(xmpp_conn_t * const conn, xmpp_stanza_t * const stanza,
             }
         } else {
             char *show_str = stanza_get_show(stanza, "online");
+            char *role = stanza_get_muc_item_attribute(stanza, STANZA_ATTR_ROLE);
+            char *affiliation = stanza_get_muc_item_attribute(stanza,
+                STANZA_ATTR_AFFILIATION);
+            char *real_jid = stanza_get_muc_item_attribute(stanza,
+                STANZA_ATTR_JID);
+
             if (!muc_get_roster_received(room)) {
-                muc_add_to_roster(room, nick, show_str, status_str, caps_key);
+                muc_add_to_roster(room, nick, show_str, status_str, caps_key,
+                    role, affiliation, real_jid);
             } else {
                 char *old_nick = muc_complete_roster_nick_change(room, nick);
 
                 if (old_nick != NULL) {
-                    muc_add_to_roster(room, nick, show_str, status_str, caps_key);
+                    muc_add_to_roster(room, nick, show_str, status_str, caps_key,
+                        role, affiliation, real_jid);
                     prof_handle_room_member_nick_change(room, old_nick, nick);
                     free(old_nick);
                 } else {
                     if (!muc_nick_in_roster(room, nick)) {
-                        prof_handle_room_member_online(room, nick, show_str, status_str, caps_key);
+                        prof_handle_room_member_online(room, nick, show_str,
+                            status_str, caps_key, role, affiliation, real_jid);
                     } else {
-                        prof_handle_room_member_presence(room, nick, show_str, status_str, caps_key);
+                        prof_handle_room_member_presence(room, nick, show_str,
+                            status_str, caps_key, role, affiliation, real_jid);
                     }
                 }
             }
@@ -686,3 +689,17 @@ _room_presence_handler(xmpp_conn_t * const conn, xmpp_stanza_t * const stanza,
 
     return 1;
 }
+
+static void
+_sub_request_add(const char * const barejid)
+{
+    autocomplete_add(sub_requests_ac, barejid);
+    g_hash_table_add(sub_requests, strdup(barejid));
+}
+
+static void
+_sub_request_remove(const char * const barejid)
+{
+    autocomplete_remove(sub_requests_ac, barejid);
+    g_hash_table_remove(sub_requests, barejid);
+}
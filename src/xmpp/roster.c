@@ -21,15 +21,18 @@
  */
 
 #include <assert.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
 #include <glib.h>
 #include <strophe.h>
 
+#include "common.h"
 #include "log.h"
 #include "profanity.h"
 #include "tools/autocomplete.h"
+#include "tools/intern.h"
 #include "xmpp/connection.h"
 #include "xmpp/roster.h"
 #include "xmpp/stanza.h"
@@ -50,18 +53,89 @@ static Autocomplete fulljid_ac;
 // groups
 static Autocomplete groups_ac;
 
-// contacts, indexed on barejid
+// contacts, indexed on their interned barejid
 static GHashTable *contacts;
 
-// nickname to jid map
+// contacts, sorted by name or barejid
+static GSequence *sorted_contacts;
+
+// group members, sorted as above, indexed on group name
+static GHashTable *group_members;
+
+// contacts, sorted as above, indexed on their presence
+static GHashTable *presence_buckets;
+
+// contacts awaiting a response to our subscription request, sorted as above
+static GSequence *pending_out_contacts;
+
+// presences of each /who filter, the buckets are created for each of the
+// presences in presences_any
+static const char * const presences_any[] =
+    { "chat", "online", "away", "xa", "dnd", "offline", NULL };
+static const char * const presences_online[] =
+    { "chat", "online", "away", "xa", "dnd", NULL };
+static const char * const presences_available[] = { "chat", "online", NULL };
+static const char * const presences_unavailable[] =
+    { "away", "xa", "dnd", "offline", NULL };
+
+// nickname to jid map, both interned
 static GHashTable *name_to_barejid;
 
+// contacts added since roster_bulk_add_start, their completions are added
+// in one step by roster_bulk_add_end
+static gboolean bulk_adding = FALSE;
+static GSList *bulk_contacts = NULL;
+
+// whether the initial roster has been received, pushes only update the
+// roster cache once it has
+static gboolean roster_received = FALSE;
+
+// roster version to write to the roster cache once pushes stop arriving,
+// so that a burst of pushes rewrites the cache once
+static char *cache_pending_ver = NULL;
+#define ROSTER_CACHE_SAVE_DELAY 2000
+
+// whether the roster was kept from a previous connection, and the account
+// it belongs to, a stale roster is reconciled with the roster received
+// rather than rebuilt
+static gboolean roster_stale = FALSE;
+static char *roster_account = NULL;
+
 // callback data for group commands
 typedef struct _group_data {
     char *name;
     char *group;
 } GroupData;
 
+// maximum roster sets awaiting a result for each bulk operation
+#define ROSTER_BULK_WINDOW 10
+
+// results between bulk operation progress reports
+#define ROSTER_BULK_PROGRESS_STEP 50
+
+typedef enum {
+    BULK_GROUP_ADD,
+    BULK_GROUP_REMOVE,
+    BULK_ROSTER_REMOVE
+} roster_bulk_type_t;
+
+// state for a bulk roster operation, freed when the last result arrives,
+// or on disconnect
+typedef struct _bulk_operation {
+    roster_bulk_type_t type;
+    char *group;
+    char *description;
+    GHashTable *targets;
+    GQueue *pending;
+    GHashTable *in_flight;
+    int total;
+    int succeeded;
+    int failed;
+} BulkOperation;
+
+// bulk operations awaiting results
+static GSList *bulk_operations = NULL;
+
 // event handlers
 static int _roster_handle_push(xmpp_conn_t * const conn,
     xmpp_stanza_t * const stanza, void * const userdata);
@@ -77,14 +151,48 @@ _group_remove_handler(xmpp_conn_t * const conn, xmpp_stanza_t * const stanza,
     void * const userdata);
 
 // helper functions
+static int _bulk_result_handler(xmpp_conn_t * const conn,
+    xmpp_stanza_t * const stanza, void * const userdata);
+
+static void _send_roster_request(const char * const ver);
+static int _bulk_start(roster_bulk_type_t type, const char * const group,
+    const char * const pattern);
+static void _bulk_send_next(BulkOperation *operation);
+static xmpp_stanza_t * _bulk_create_set(BulkOperation *operation,
+    const char * const id, PContact contact);
+static void _bulk_free(BulkOperation *operation);
+static void _bulk_cancel_all(void);
+static gboolean _bulk_removing(const char * const barejid);
+static gchar * _get_roster_cache_file(void);
+static char * _roster_cache_version(void);
+static gboolean _roster_cache_load(void);
+static void _roster_cache_save(const char * const ver);
+static void _roster_cache_save_later(const char * const ver);
+static void _roster_cache_flush(void);
+static int _roster_cache_handle_save(xmpp_conn_t * const conn,
+    void * const userdata);
 static void _add_name_and_barejid(const char * const name,
     const char * const barejid);
 static void _replace_name(const char * const current_name,
     const char * const new_name, const char * const barejid);
+static void _set_name(PContact contact, const char * const name);
+static void _index_add(PContact contact);
+static void _index_remove(PContact contact);
+static void _presence_changed(PContact contact,
+    const char * const old_presence);
+static void _create_presence_buckets(void);
+static const char * const * _filter_presences(const char * const filter,
+    const char **single);
+static GSList * _sequence_to_list(GSequence *sequence);
+static GSList * _merge_contacts(GSList *first, GSList *second);
+static void _remove_contact(const char * const barejid);
+static gboolean _contact_changed(PContact contact, const char * const name,
+    GSList *groups, const char * const subscription, gboolean pending_out);
+static void _remove_unseen_contacts(GHashTable *seen);
 GSList * _get_groups_from_item(xmpp_stanza_t *item);
 static gboolean _key_equals(void *key1, void *key2);
 static gboolean _datetimes_equal(GDateTime *dt1, GDateTime *dt2);
-static gint _compare_contacts(PContact a, PContact b);
+static gint _compare_contacts(PContact a, PContact b, gpointer data);
 
 void
 roster_add_handlers(void)
@@ -92,17 +200,26 @@ roster_add_handlers(void)
     xmpp_conn_t * const conn = connection_get_conn();
     xmpp_ctx_t * const ctx = connection_get_ctx();
     HANDLE(STANZA_TYPE_SET,    _roster_handle_push);
-    HANDLE(STANZA_TYPE_RESULT, _roster_handle_result);
 }
 
 void
 roster_request(void)
 {
-    xmpp_conn_t * const conn = connection_get_conn();
-    xmpp_ctx_t * const ctx = connection_get_ctx();
-    xmpp_stanza_t *iq = stanza_create_roster_iq(ctx);
-    xmpp_send(conn, iq);
-    xmpp_stanza_release(iq);
+    // a roster kept from another account cannot be reconciled
+    const char *account = jabber_get_account_name();
+    if (roster_stale && (g_strcmp0(roster_account, account) != 0)) {
+        roster_clear();
+    }
+    free(roster_account);
+    roster_account = NULL;
+    if (account != NULL) {
+        roster_account = strdup(account);
+    }
+
+    // a version is only cached when the server supports roster versioning
+    char *ver = _roster_cache_version();
+    _send_roster_request(ver);
+    free(ver);
 }
 
 void
@@ -112,34 +229,89 @@ roster_init(void)
     barejid_ac = autocomplete_new();
     fulljid_ac = autocomplete_new();
     groups_ac = autocomplete_new();
-    contacts = g_hash_table_new_full(g_str_hash, (GEqualFunc)_key_equals, g_free,
+    contacts = g_hash_table_new_full(g_str_hash, (GEqualFunc)_key_equals, NULL,
         (GDestroyNotify)p_contact_free);
-    name_to_barejid = g_hash_table_new_full(g_str_hash, g_str_equal, g_free,
-        g_free);
+    sorted_contacts = g_sequence_new(NULL);
+    group_members = g_hash_table_new_full(g_str_hash, g_str_equal, g_free,
+        (GDestroyNotify)g_sequence_free);
+    _create_presence_buckets();
+    pending_out_contacts = g_sequence_new(NULL);
+    name_to_barejid = g_hash_table_new_full(g_str_hash, g_str_equal,
+        (GDestroyNotify)intern_release, (GDestroyNotify)intern_release);
 }
 
 void
 roster_clear(void)
 {
+    _roster_cache_flush();
     autocomplete_clear(name_ac);
     autocomplete_clear(barejid_ac);
     autocomplete_clear(fulljid_ac);
     autocomplete_clear(groups_ac);
+    g_sequence_free(sorted_contacts);
+    sorted_contacts = g_sequence_new(NULL);
+    g_hash_table_remove_all(group_members);
+    g_hash_table_destroy(presence_buckets);
+    _create_presence_buckets();
+    g_sequence_free(pending_out_contacts);
+    pending_out_contacts = g_sequence_new(NULL);
     g_hash_table_destroy(contacts);
-    contacts = g_hash_table_new_full(g_str_hash, (GEqualFunc)_key_equals, g_free,
+    contacts = g_hash_table_new_full(g_str_hash, (GEqualFunc)_key_equals, NULL,
         (GDestroyNotify)p_contact_free);
     g_hash_table_destroy(name_to_barejid);
-    name_to_barejid = g_hash_table_new_full(g_str_hash, g_str_equal, g_free,
-        g_free);
+    name_to_barejid = g_hash_table_new_full(g_str_hash, g_str_equal,
+        (GDestroyNotify)intern_release, (GDestroyNotify)intern_release);
+    g_slist_free(bulk_contacts);
+    bulk_contacts = NULL;
+    bulk_adding = FALSE;
+    _bulk_cancel_all();
+    roster_received = FALSE;
+    roster_stale = FALSE;
+}
+
+/*
+ * Keep the roster after disconnecting, contacts are marked offline until
+ * their presence is received again, and the roster received on reconnect
+ * is applied as a diff
+ */
+void
+roster_set_stale(void)
+{
+    _roster_cache_flush();
+    _bulk_cancel_all();
+
+    GHashTableIter iter;
+    gpointer key;
+    gpointer value;
+
+    g_hash_table_iter_init(&iter, contacts);
+    while (g_hash_table_iter_next(&iter, &key, &value)) {
+        PContact contact = value;
+        const char *old_presence = p_contact_presence(contact);
+        p_contact_remove_all_resources(contact);
+        _presence_changed(contact, old_presence);
+    }
+
+    autocomplete_clear(fulljid_ac);
+    roster_received = FALSE;
+    roster_stale = TRUE;
 }
 
 void
 roster_free()
 {
+    _roster_cache_flush();
+    _bulk_cancel_all();
     autocomplete_free(name_ac);
     autocomplete_free(barejid_ac);
     autocomplete_free(fulljid_ac);
     autocomplete_free(groups_ac);
+    g_sequence_free(sorted_contacts);
+    g_hash_table_destroy(group_members);
+    g_hash_table_destroy(presence_buckets);
+    g_sequence_free(pending_out_contacts);
+    free(roster_account);
+    roster_account = NULL;
 }
 
 void
@@ -182,15 +354,19 @@ roster_add(const char * const barejid, const char * const name, GSList *groups,
         contact = p_contact_new(barejid, name, groups, subscription, NULL,
             pending_out);
 
-        // add groups
-        while (groups != NULL) {
-            autocomplete_add(groups_ac, groups->data);
-            groups = g_slist_next(groups);
-        }
+        g_hash_table_insert(contacts, (gpointer)p_contact_barejid(contact),
+            contact);
+        _index_add(contact);
 
-        g_hash_table_insert(contacts, strdup(barejid), contact);
-        autocomplete_add(barejid_ac, barejid);
-        _add_name_and_barejid(name, barejid);
+        if (bulk_adding) {
+            bulk_contacts = g_slist_prepend(bulk_contacts, contact);
+            g_hash_table_insert(name_to_barejid,
+                (gpointer)intern_str(p_contact_name_or_jid(contact)),
+                (gpointer)intern_str(barejid));
+        } else {
+            autocomplete_add(barejid_ac, barejid);
+            _add_name_and_barejid(name, barejid);
+        }
 
         if (!from_initial) {
             prof_handle_roster_add(barejid, name);
@@ -202,6 +378,46 @@ roster_add(const char * const barejid, const char * const name, GSList *groups,
     return added;
 }
 
+void
+roster_bulk_add_start(void)
+{
+    bulk_adding = TRUE;
+}
+
+void
+roster_bulk_add_end(void)
+{
+    GSList *barejids = NULL;
+    GSList *names = NULL;
+    GSList *groups = NULL;
+
+    GSList *curr = bulk_contacts;
+    while (curr != NULL) {
+        PContact contact = curr->data;
+        barejids = g_slist_prepend(barejids, (char *)p_contact_barejid(contact));
+        names = g_slist_prepend(names, (char *)p_contact_name_or_jid(contact));
+
+        GSList *contact_groups = p_contact_groups(contact);
+        while (contact_groups != NULL) {
+            groups = g_slist_prepend(groups, contact_groups->data);
+            contact_groups = g_slist_next(contact_groups);
+        }
+
+        curr = g_slist_next(curr);
+    }
+
+    autocomplete_add_all(barejid_ac, barejids);
+    autocomplete_add_all(name_ac, names);
+    autocomplete_add_all(groups_ac, groups);
+
+    g_slist_free(barejids);
+    g_slist_free(names);
+    g_slist_free(groups);
+    g_slist_free(bulk_contacts);
+    bulk_contacts = NULL;
+    bulk_adding = FALSE;
+}
+
 void
 roster_update(const char * const barejid, const char * const name,
     GSList *groups, const char * const subscription, gboolean pending_out)
@@ -212,7 +428,6 @@ roster_update(const char * const barejid, const char * const name,
         roster_add(barejid, name, groups, subscription, pending_out, FALSE);
     } else {
         p_contact_set_subscription(contact, subscription);
-        p_contact_set_pending_out(contact, pending_out);
 
         const char * const new_name = name;
         const char * current_name = NULL;
@@ -220,15 +435,12 @@ roster_update(const char * const barejid, const char * const name,
             current_name = strdup(p_contact_name(contact));
         }
 
+        _index_remove(contact);
+        p_contact_set_pending_out(contact, pending_out);
         p_contact_set_name(contact, new_name);
         p_contact_set_groups(contact, groups);
+        _index_add(contact);
         _replace_name(current_name, new_name, barejid);
-
-        // add groups
-        while (groups != NULL) {
-            autocomplete_add(groups_ac, groups->data);
-            groups = g_slist_next(groups);
-        }
     }
 }
 
@@ -246,7 +458,9 @@ roster_update_presence(const char * const barejid, Resource *resource,
     if (!_datetimes_equal(p_contact_last_activity(contact), last_activity)) {
         p_contact_set_last_activity(contact, last_activity);
     }
+    const char *old_presence = p_contact_presence(contact);
     p_contact_set_presence(contact, resource);
+    _presence_changed(contact, old_presence);
     Jid *jid = jid_create_from_bare_and_resource(barejid, resource->name);
     autocomplete_add(fulljid_ac, jid->fulljid);
     jid_destroy(jid);
@@ -266,7 +480,9 @@ roster_contact_offline(const char * const barejid,
     if (resource == NULL) {
         return TRUE;
     } else {
+        const char *old_presence = p_contact_presence(contact);
         gboolean result = p_contact_remove_resource(contact, resource);
+        _presence_changed(contact, old_presence);
         if (result == TRUE) {
             Jid *jid = jid_create_from_bare_and_resource(barejid, resource);
             autocomplete_remove(fulljid_ac, jid->fulljid);
@@ -287,7 +503,7 @@ roster_change_name(const char * const barejid, const char * const new_name)
     }
 
     if (contact != NULL) {
-        p_contact_set_name(contact, new_name);
+        _set_name(contact, new_name);
         _replace_name(current_name, new_name, barejid);
 
         GSList *groups = p_contact_groups(contact);
@@ -422,38 +638,155 @@ _group_remove_handler(xmpp_conn_t * const conn, xmpp_stanza_t * const stanza,
     return 0;
 }
 
+/*
+ * Add every contact whose jid or name matches the glob pattern to the group,
+ * returns the number of contacts to be updated
+ */
+int
+roster_add_to_group_matching(const char * const group,
+    const char * const pattern)
+{
+    return _bulk_start(BULK_GROUP_ADD, group, pattern);
+}
+
+/*
+ * Remove every contact whose jid or name matches the glob pattern from the
+ * group, returns the number of contacts to be updated
+ */
+int
+roster_remove_from_group_matching(const char * const group,
+    const char * const pattern)
+{
+    return _bulk_start(BULK_GROUP_REMOVE, group, pattern);
+}
+
+/*
+ * Remove every contact whose jid or name matches the glob pattern from the
+ * roster, returns the number of contacts to be removed
+ */
+int
+roster_remove_matching(const char * const pattern)
+{
+    return _bulk_start(BULK_ROSTER_REMOVE, NULL, pattern);
+}
+
+static int
+_bulk_result_handler(xmpp_conn_t * const conn, xmpp_stanza_t * const stanza,
+    void * const userdata)
+{
+    BulkOperation *operation = userdata;
+    const char *type = xmpp_stanza_get_type(stanza);
+
+    g_hash_table_remove(operation->in_flight, xmpp_stanza_get_id(stanza));
+    if (g_strcmp0(type, STANZA_TYPE_ERROR) == 0) {
+        operation->failed++;
+    } else {
+        operation->succeeded++;
+    }
+
+    int done = operation->succeeded + operation->failed;
+    if ((done < operation->total) && (done % ROSTER_BULK_PROGRESS_STEP == 0)) {
+        prof_handle_roster_bulk_progress(operation->description, done,
+            operation->total);
+    }
+
+    _bulk_send_next(operation);
+
+    return 0;
+}
+
 gboolean
 roster_has_pending_subscriptions(void)
 {
-    GHashTableIter iter;
-    gpointer key;
-    gpointer value;
+    return (g_sequence_get_length(pending_out_contacts) > 0);
+}
 
-    g_hash_table_iter_init(&iter, contacts);
-    while (g_hash_table_iter_next(&iter, &key, &value)) {
-        PContact contact = (PContact) value;
-        if (p_contact_pending_out(contact)) {
-            return TRUE;
+/*
+ * Return the contacts we have sent a subscription request to that have not
+ * yet responded, sorted as roster_get_contacts
+ */
+GSList *
+roster_get_pending_out(void)
+{
+    return _sequence_to_list(pending_out_contacts);
+}
+
+GSList *
+roster_get_contacts(void)
+{
+    // resturn all contact structs
+    return _sequence_to_list(sorted_contacts);
+}
+
+/*
+ * Return the contacts whose barejid or name match the glob pattern, sorted
+ * as roster_get_contacts
+ */
+GSList *
+roster_get_contacts_matching(const char * const pattern)
+{
+    GPatternSpec *spec = g_pattern_spec_new(pattern);
+    GSList *result = NULL;
+
+    GSequenceIter *iter = g_sequence_get_end_iter(sorted_contacts);
+    while (!g_sequence_iter_is_begin(iter)) {
+        iter = g_sequence_iter_prev(iter);
+        PContact contact = g_sequence_get(iter);
+        const char *barejid = p_contact_barejid(contact);
+        const char *name = p_contact_name(contact);
+
+        if (g_pattern_match_string(spec, barejid) ||
+                ((name != NULL) && g_pattern_match_string(spec, name))) {
+            result = g_slist_prepend(result, contact);
         }
     }
 
-    return FALSE;
+    g_pattern_spec_free(spec);
+
+    return result;
 }
 
+/*
+ * Return the contacts matching a /who presence filter, sorted as
+ * roster_get_contacts. The filter may be a presence, or one of online,
+ * offline, available, unavailable or any.
+ */
 GSList *
-roster_get_contacts(void)
+roster_get_contacts_by_presence(const char * const filter)
 {
     GSList *result = NULL;
-    GHashTableIter iter;
-    gpointer key;
-    gpointer value;
+    const char *single[] = { filter, NULL };
+    const char * const *presences = _filter_presences(filter, single);
+
+    int i;
+    for (i = 0; presences[i] != NULL; i++) {
+        GSequence *bucket = g_hash_table_lookup(presence_buckets, presences[i]);
+        if (bucket != NULL) {
+            result = _merge_contacts(result, _sequence_to_list(bucket));
+        }
+    }
 
-    g_hash_table_iter_init(&iter, contacts);
-    while (g_hash_table_iter_next(&iter, &key, &value)) {
-        result = g_slist_insert_sorted(result, value, (GCompareFunc)_compare_contacts);
+    return result;
+}
+
+/*
+ * Return the number of contacts matching a /who presence filter
+ */
+int
+roster_count_by_presence(const char * const filter)
+{
+    int result = 0;
+    const char *single[] = { filter, NULL };
+    const char * const *presences = _filter_presences(filter, single);
+
+    int i;
+    for (i = 0; presences[i] != NULL; i++) {
+        GSequence *bucket = g_hash_table_lookup(presence_buckets, presences[i]);
+        if (bucket != NULL) {
+            result += g_sequence_get_length(bucket);
+        }
     }
 
-    // resturn all contact structs
     return result;
 }
 
@@ -466,25 +799,13 @@ roster_get_groups(void)
 GSList *
 roster_get_group(const char * const group)
 {
-    GSList *result = NULL;
-    GHashTableIter iter;
-    gpointer key;
-    gpointer value;
-
-    g_hash_table_iter_init(&iter, contacts);
-    while (g_hash_table_iter_next(&iter, &key, &value)) {
-        GSList *groups = p_contact_groups(value);
-        while (groups != NULL) {
-            if (strcmp(groups->data, group) == 0) {
-                result = g_slist_insert_sorted(result, value, (GCompareFunc)_compare_contacts);
-                break;
-            }
-            groups = g_slist_next(groups);
-        }
+    GSequence *members = g_hash_table_lookup(group_members, group);
+    if (members == NULL) {
+        return NULL;
     }
 
     // resturn all contact structs
-    return result;
+    return _sequence_to_list(members);
 }
 
 char *
@@ -552,33 +873,13 @@ _roster_handle_push(xmpp_conn_t * const conn, xmpp_stanza_t * const stanza,
 
     // remove from roster
     if (g_strcmp0(sub, "remove") == 0) {
-        // remove barejid and name
-        if (name == NULL) {
-            name = barejid;
-        }
-        autocomplete_remove(barejid_ac, barejid);
-        autocomplete_remove(name_ac, name);
-        g_hash_table_remove(name_to_barejid, name);
-
-        // remove each fulljid
-        PContact contact = roster_get_contact(barejid);
-        if (contact != NULL) {
-            GList *resources = p_contact_get_available_resources(contact);
-            while (resources != NULL) {
-                GString *fulljid = g_string_new(strdup(barejid));
-                g_string_append(fulljid, "/");
-                g_string_append(fulljid, resources->data);
-                autocomplete_remove(fulljid_ac, fulljid->str);
-                g_string_free(fulljid, TRUE);
-                resources = g_list_next(resources);
-            }
+        // contacts removed by a bulk operation are reported when it completes
+        gboolean bulk = _bulk_removing(barejid);
+        _remove_contact(barejid);
+        if (!bulk) {
+            prof_handle_roster_remove(barejid);
         }
 
-        // remove the contact
-        g_hash_table_remove(contacts, barejid);
-
-        prof_handle_roster_remove(barejid);
-
     // otherwise update local roster
     } else {
 
@@ -594,6 +895,12 @@ _roster_handle_push(xmpp_conn_t * const conn, xmpp_stanza_t * const stanza,
         roster_update(barejid, name, groups, sub, pending_out);
     }
 
+    // pushes only carry a version when the server supports versioning
+    const char *ver = xmpp_stanza_get_attribute(query, STANZA_ATTR_VER);
+    if ((ver != NULL) && roster_received) {
+        _roster_cache_save_later(ver);
+    }
+
     return 1;
 }
 
@@ -601,12 +908,42 @@ static int
 _roster_handle_result(xmpp_conn_t * const conn, xmpp_stanza_t * const stanza,
     void * const userdata)
 {
-    const char *id = xmpp_stanza_get_attribute(stanza, STANZA_ATTR_ID);
+    gboolean sent_ver = GPOINTER_TO_INT(userdata);
+    const char *type = xmpp_stanza_get_type(stanza);
 
-    // handle initial roster response
-    if (g_strcmp0(id, "roster") == 0) {
-        xmpp_stanza_t *query = xmpp_stanza_get_child_by_name(stanza,
-            STANZA_NAME_QUERY);
+    if (g_strcmp0(type, STANZA_TYPE_ERROR) == 0) {
+        if (sent_ver) {
+            log_warning("Versioned roster request failed, requesting full roster");
+            _send_roster_request(NULL);
+        } else {
+            log_error("Roster request failed");
+        }
+        return 0;
+    }
+
+    xmpp_stanza_t *query = xmpp_stanza_get_child_by_name(stanza,
+        STANZA_NAME_QUERY);
+
+    // empty result, roster unchanged since the cached version, a stale
+    // roster is already that version
+    if (query == NULL) {
+
+        // only a versioned request may be answered without a roster, asking
+        // again would get the same answer
+        if (!sent_ver) {
+            log_error("Roster result without a roster, keeping the roster as it is");
+        } else if (!roster_stale && !_roster_cache_load()) {
+            log_warning("Could not load roster cache, requesting full roster");
+            _send_roster_request(NULL);
+            return 0;
+        }
+
+    // full roster
+    } else {
+        // barejids in the roster, to find contacts removed from a stale roster
+        GHashTable *seen = g_hash_table_new(g_str_hash, g_str_equal);
+
+        roster_bulk_add_start();
         xmpp_stanza_t *item = xmpp_stanza_get_children(query);
 
         while (item != NULL) {
@@ -625,21 +962,99 @@ _roster_handle_result(xmpp_conn_t * const conn, xmpp_stanza_t * const stanza,
 
             GSList *groups = _get_groups_from_item(item);
 
-            gboolean added = roster_add(barejid, name, groups, sub, pending_out, TRUE);
+            PContact contact = g_hash_table_lookup(contacts, barejid);
+            if (roster_stale && (contact != NULL)) {
+                if (_contact_changed(contact, name, groups, sub, pending_out)) {
+                    roster_update(barejid, name, groups, sub, pending_out);
+                } else {
+                    g_slist_free_full(groups, g_free);
+                }
+            } else {
+                // contacts new to a stale roster are shown as added
+                gboolean added = roster_add(barejid, name, groups, sub,
+                    pending_out, !roster_stale);
+
+                if (!added) {
+                    log_warning("Attempt to add contact twice: %s", barejid);
+                    g_slist_free_full(groups, g_free);
+                }
+            }
 
-            if (!added) {
-                log_warning("Attempt to add contact twice: %s", barejid);
+            contact = g_hash_table_lookup(contacts, barejid);
+            if (contact != NULL) {
+                g_hash_table_insert(seen, (gpointer)p_contact_barejid(contact),
+                    contact);
             }
 
             item = xmpp_stanza_get_next(item);
         }
+        roster_bulk_add_end();
 
-        contact_presence_t conn_presence =
-            accounts_get_login_presence(jabber_get_account_name());
-        presence_update(conn_presence, NULL, 0);
+        if (roster_stale) {
+            _remove_unseen_contacts(seen);
+        }
+        g_hash_table_destroy(seen);
+
+        _roster_cache_flush();
+        _roster_cache_save(xmpp_stanza_get_attribute(query, STANZA_ATTR_VER));
     }
 
-    return 1;
+    roster_received = TRUE;
+    roster_stale = FALSE;
+    prof_handle_roster_received();
+
+    contact_presence_t conn_presence =
+        accounts_get_login_presence(jabber_get_account_name());
+    presence_update(conn_presence, NULL, 0);
+
+    return 0;
+}
+
+/*
+ * Write the roster to the roster cache after ROSTER_CACHE_SAVE_DELAY, later
+ * calls before then only replace the version written
+ */
+static void
+_roster_cache_save_later(const char * const ver)
+{
+    gboolean scheduled = (cache_pending_ver != NULL);
+    free(cache_pending_ver);
+    cache_pending_ver = strdup(ver);
+
+    if (!scheduled) {
+        xmpp_timed_handler_add(connection_get_conn(), _roster_cache_handle_save,
+            ROSTER_CACHE_SAVE_DELAY, NULL);
+    }
+}
+
+/*
+ * Write any roster cache update waiting for its delay now
+ */
+static void
+_roster_cache_flush(void)
+{
+    if (cache_pending_ver == NULL) {
+        return;
+    }
+
+    xmpp_conn_t * const conn = connection_get_conn();
+    if (conn != NULL) {
+        xmpp_timed_handler_delete(conn, _roster_cache_handle_save);
+    }
+    _roster_cache_save(cache_pending_ver);
+    FREE_SET_NULL(cache_pending_ver);
+}
+
+static int
+_roster_cache_handle_save(xmpp_conn_t * const conn, void * const userdata)
+{
+    if (cache_pending_ver != NULL) {
+        _roster_cache_save(cache_pending_ver);
+        FREE_SET_NULL(cache_pending_ver);
+    }
+
+    // run once
+    return 0;
 }
 
 static void
@@ -647,10 +1062,12 @@ _add_name_and_barejid(const char * const name, const char * const barejid)
 {
     if (name != NULL) {
         autocomplete_add(name_ac, name);
-        g_hash_table_insert(name_to_barejid, strdup(name), strdup(barejid));
+        g_hash_table_insert(name_to_barejid, (gpointer)intern_str(name),
+            (gpointer)intern_str(barejid));
     } else {
         autocomplete_add(name_ac, barejid);
-        g_hash_table_insert(name_to_barejid, strdup(barejid), strdup(barejid));
+        g_hash_table_insert(name_to_barejid, (gpointer)intern_str(barejid),
+            (gpointer)intern_str(barejid));
     }
 }
 
@@ -671,6 +1088,459 @@ _replace_name(const char * const current_name, const char * const new_name,
     }
 }
 
+static void
+_send_roster_request(const char * const ver)
+{
+    xmpp_conn_t * const conn = connection_get_conn();
+    xmpp_ctx_t * const ctx = connection_get_ctx();
+    xmpp_stanza_t *iq = stanza_create_roster_iq(ctx, ver);
+    xmpp_id_handler_add(conn, _roster_handle_result, "roster",
+        GINT_TO_POINTER(ver != NULL));
+    xmpp_send(conn, iq);
+    xmpp_stanza_release(iq);
+}
+
+static gchar *
+_get_roster_cache_file(void)
+{
+    gchar *xdg_data = xdg_get_data_home();
+    // the account may already be gone when saving after disconnecting
+    const char *account_name = roster_account;
+    if (account_name == NULL) {
+        account_name = jabber_get_account_name();
+    }
+    gchar *account = str_replace(account_name, "@", "_at_");
+    GString *cache_file = g_string_new(xdg_data);
+    g_string_append_printf(cache_file, "/profanity/rosters/%s", account);
+    gchar *result = strdup(cache_file->str);
+    g_free(xdg_data);
+    free(account);
+    g_string_free(cache_file, TRUE);
+
+    return result;
+}
+
+/*
+ * Return the version of the cached roster, or NULL if there is none
+ */
+static char *
+_roster_cache_version(void)
+{
+    char *result = NULL;
+    gchar *cache_loc = _get_roster_cache_file();
+    GKeyFile *cache = g_key_file_new();
+
+    if (g_key_file_load_from_file(cache, cache_loc, G_KEY_FILE_NONE, NULL)) {
+        gchar *ver = g_key_file_get_string(cache, "roster", "ver", NULL);
+        if (ver != NULL) {
+            result = strdup(ver);
+            g_free(ver);
+        }
+    }
+
+    g_key_file_free(cache);
+    g_free(cache_loc);
+
+    return result;
+}
+
+/*
+ * Add the contacts in the roster cache to the roster, returns FALSE if the
+ * cache could not be read
+ */
+static gboolean
+_roster_cache_load(void)
+{
+    gchar *cache_loc = _get_roster_cache_file();
+    GKeyFile *cache = g_key_file_new();
+
+    if (!g_key_file_load_from_file(cache, cache_loc, G_KEY_FILE_NONE, NULL)) {
+        g_key_file_free(cache);
+        g_free(cache_loc);
+        return FALSE;
+    }
+
+    gchar **items = g_key_file_get_groups(cache, NULL);
+    roster_bulk_add_start();
+    int i;
+    for (i = 0; items[i] != NULL; i++) {
+        if (strcmp(items[i], "roster") == 0) {
+            continue;
+        }
+
+        gchar *barejid = g_key_file_get_string(cache, items[i], "jid", NULL);
+        if (barejid == NULL) {
+            continue;
+        }
+        gchar *name = g_key_file_get_string(cache, items[i], "name", NULL);
+        gchar *sub = g_key_file_get_string(cache, items[i], "subscription", NULL);
+        gboolean pending_out = g_key_file_get_boolean(cache, items[i],
+            "pending_out", NULL);
+
+        GSList *groups = NULL;
+        gchar **group_list = g_key_file_get_string_list(cache, items[i],
+            "groups", NULL, NULL);
+        if (group_list != NULL) {
+            int j;
+            for (j = 0; group_list[j] != NULL; j++) {
+                groups = g_slist_append(groups, strdup(group_list[j]));
+            }
+            g_strfreev(group_list);
+        }
+
+        if (!roster_add(barejid, name, groups, sub, pending_out, TRUE)) {
+            g_slist_free_full(groups, g_free);
+        }
+
+        g_free(barejid);
+        g_free(name);
+        g_free(sub);
+    }
+    roster_bulk_add_end();
+
+    g_strfreev(items);
+    g_key_file_free(cache);
+    g_free(cache_loc);
+
+    return TRUE;
+}
+
+/*
+ * Write the roster to the roster cache with the given version, or remove the
+ * cache when the server does not support roster versioning
+ */
+static void
+_roster_cache_save(const char * const ver)
+{
+    gchar *cache_loc = _get_roster_cache_file();
+
+    if (ver == NULL) {
+        remove(cache_loc);
+        g_free(cache_loc);
+        return;
+    }
+
+    GKeyFile *cache = g_key_file_new();
+    g_key_file_set_string(cache, "roster", "ver", ver);
+
+    int i = 0;
+    GSequenceIter *iter = g_sequence_get_begin_iter(sorted_contacts);
+    while (!g_sequence_iter_is_end(iter)) {
+        PContact contact = g_sequence_get(iter);
+        gchar *item = g_strdup_printf("contact%d", i++);
+
+        g_key_file_set_string(cache, item, "jid", p_contact_barejid(contact));
+        if (p_contact_name(contact) != NULL) {
+            g_key_file_set_string(cache, item, "name", p_contact_name(contact));
+        }
+        g_key_file_set_string(cache, item, "subscription",
+            p_contact_subscription(contact));
+        if (p_contact_pending_out(contact)) {
+            g_key_file_set_boolean(cache, item, "pending_out", TRUE);
+        }
+
+        GSList *groups = p_contact_groups(contact);
+        if (groups != NULL) {
+            gsize length = g_slist_length(groups);
+            const gchar **group_list = g_new(const gchar *, length);
+            int j = 0;
+            while (groups != NULL) {
+                group_list[j++] = groups->data;
+                groups = g_slist_next(groups);
+            }
+            g_key_file_set_string_list(cache, item, "groups", group_list,
+                length);
+            g_free(group_list);
+        }
+
+        g_free(item);
+        iter = g_sequence_iter_next(iter);
+    }
+
+    gsize g_data_size;
+    gchar *g_cache_data = g_key_file_to_data(cache, &g_data_size, NULL);
+    g_file_set_contents(cache_loc, g_cache_data, g_data_size, NULL);
+    g_free(g_cache_data);
+    g_key_file_free(cache);
+    g_free(cache_loc);
+}
+
+/*
+ * Set the contact's name, moving it to its new place in the sorted contacts
+ */
+static void
+_set_name(PContact contact, const char * const name)
+{
+    _index_remove(contact);
+    p_contact_set_name(contact, name);
+    _index_add(contact);
+}
+
+/*
+ * Add the contact to the sorted contacts, the members of each of its groups,
+ * and the pending subscriptions, groups new to the roster are completed
+ * unless they are added by roster_bulk_add_end
+ */
+static void
+_index_add(PContact contact)
+{
+    g_sequence_insert_sorted(sorted_contacts, contact,
+        (GCompareDataFunc)_compare_contacts, NULL);
+    g_sequence_insert_sorted(
+        g_hash_table_lookup(presence_buckets, p_contact_presence(contact)),
+        contact, (GCompareDataFunc)_compare_contacts, NULL);
+
+    GSList *groups = p_contact_groups(contact);
+    while (groups != NULL) {
+        GSequence *members = g_hash_table_lookup(group_members, groups->data);
+        if (members == NULL) {
+            members = g_sequence_new(NULL);
+            g_hash_table_insert(group_members, strdup(groups->data), members);
+            if (!bulk_adding) {
+                autocomplete_add(groups_ac, groups->data);
+            }
+        }
+        g_sequence_insert_sorted(members, contact,
+            (GCompareDataFunc)_compare_contacts, NULL);
+        groups = g_slist_next(groups);
+    }
+
+    if (p_contact_pending_out(contact)) {
+        g_sequence_insert_sorted(pending_out_contacts, contact,
+            (GCompareDataFunc)_compare_contacts, NULL);
+    }
+}
+
+/*
+ * Remove the contact from the indexes, must be called before the contact's
+ * name or groups change
+ */
+static void
+_index_remove(PContact contact)
+{
+    GSequenceIter *iter = g_sequence_lookup(sorted_contacts, contact,
+        (GCompareDataFunc)_compare_contacts, NULL);
+    if (iter != NULL) {
+        g_sequence_remove(iter);
+    }
+
+    iter = g_sequence_lookup(
+        g_hash_table_lookup(presence_buckets, p_contact_presence(contact)),
+        contact, (GCompareDataFunc)_compare_contacts, NULL);
+    if (iter != NULL) {
+        g_sequence_remove(iter);
+    }
+
+    if (p_contact_pending_out(contact)) {
+        iter = g_sequence_lookup(pending_out_contacts, contact,
+            (GCompareDataFunc)_compare_contacts, NULL);
+        if (iter != NULL) {
+            g_sequence_remove(iter);
+        }
+    }
+
+    GSList *groups = p_contact_groups(contact);
+    while (groups != NULL) {
+        GSequence *members = g_hash_table_lookup(group_members, groups->data);
+        if (members != NULL) {
+            iter = g_sequence_lookup(members, contact,
+                (GCompareDataFunc)_compare_contacts, NULL);
+            if (iter != NULL) {
+                g_sequence_remove(iter);
+            }
+
+            // forget groups with no members left
+            if (g_sequence_get_length(members) == 0) {
+                autocomplete_remove(groups_ac, groups->data);
+                g_hash_table_remove(group_members, groups->data);
+            }
+        }
+        groups = g_slist_next(groups);
+    }
+}
+
+/*
+ * Move the contact to the bucket for its new presence
+ */
+static void
+_presence_changed(PContact contact, const char * const old_presence)
+{
+    const char *new_presence = p_contact_presence(contact);
+    if (strcmp(old_presence, new_presence) == 0) {
+        return;
+    }
+
+    GSequenceIter *iter = g_sequence_lookup(
+        g_hash_table_lookup(presence_buckets, old_presence),
+        contact, (GCompareDataFunc)_compare_contacts, NULL);
+    if (iter != NULL) {
+        g_sequence_remove(iter);
+    }
+
+    g_sequence_insert_sorted(
+        g_hash_table_lookup(presence_buckets, new_presence),
+        contact, (GCompareDataFunc)_compare_contacts, NULL);
+}
+
+/*
+ * Remove the contact and its completions from the roster
+ */
+static void
+_remove_contact(const char * const barejid)
+{
+    PContact contact = g_hash_table_lookup(contacts, barejid);
+    if (contact == NULL) {
+        return;
+    }
+
+    // remove barejid and name
+    const char *name = p_contact_name_or_jid(contact);
+    autocomplete_remove(barejid_ac, barejid);
+    autocomplete_remove(name_ac, name);
+    g_hash_table_remove(name_to_barejid, name);
+
+    // remove each fulljid
+    GList *resources = p_contact_get_available_resources(contact);
+    GList *curr = resources;
+    while (curr != NULL) {
+        Resource *resource = curr->data;
+        Jid *jid = jid_create_from_bare_and_resource(barejid, resource->name);
+        autocomplete_remove(fulljid_ac, jid->fulljid);
+        jid_destroy(jid);
+        curr = g_list_next(curr);
+    }
+    g_list_free(resources);
+
+    // remove the contact
+    _index_remove(contact);
+    g_hash_table_remove(contacts, barejid);
+}
+
+static gboolean
+_contact_changed(PContact contact, const char * const name, GSList *groups,
+    const char * const subscription, gboolean pending_out)
+{
+    if (g_strcmp0(p_contact_name(contact), name) != 0) {
+        return TRUE;
+    }
+    if ((subscription != NULL) &&
+            (g_strcmp0(p_contact_subscription(contact), subscription) != 0)) {
+        return TRUE;
+    }
+    if (p_contact_pending_out(contact) != pending_out) {
+        return TRUE;
+    }
+    if (g_slist_length(p_contact_groups(contact)) != g_slist_length(groups)) {
+        return TRUE;
+    }
+    while (groups != NULL) {
+        if (!p_contact_in_group(contact, groups->data)) {
+            return TRUE;
+        }
+        groups = g_slist_next(groups);
+    }
+
+    return FALSE;
+}
+
+/*
+ * Remove the contacts of a stale roster that are no longer in the roster
+ */
+static void
+_remove_unseen_contacts(GHashTable *seen)
+{
+    GSList *removed = NULL;
+    GHashTableIter iter;
+    gpointer key;
+    gpointer value;
+
+    g_hash_table_iter_init(&iter, contacts);
+    while (g_hash_table_iter_next(&iter, &key, &value)) {
+        if (g_hash_table_lookup(seen, key) == NULL) {
+            removed = g_slist_prepend(removed, strdup(key));
+        }
+    }
+
+    GSList *curr = removed;
+    while (curr != NULL) {
+        _remove_contact(curr->data);
+        prof_handle_roster_remove(curr->data);
+        curr = g_slist_next(curr);
+    }
+
+    g_slist_free_full(removed, free);
+}
+
+static void
+_create_presence_buckets(void)
+{
+    presence_buckets = g_hash_table_new_full(g_str_hash, g_str_equal, NULL,
+        (GDestroyNotify)g_sequence_free);
+
+    int i;
+    for (i = 0; presences_any[i] != NULL; i++) {
+        g_hash_table_insert(presence_buckets, (gpointer)presences_any[i],
+            g_sequence_new(NULL));
+    }
+}
+
+static const char * const *
+_filter_presences(const char * const filter, const char **single)
+{
+    if ((filter == NULL) || (strcmp(filter, "any") == 0)) {
+        return presences_any;
+    } else if (strcmp(filter, "online") == 0) {
+        return presences_online;
+    } else if (strcmp(filter, "available") == 0) {
+        return presences_available;
+    } else if (strcmp(filter, "unavailable") == 0) {
+        return presences_unavailable;
+    } else {
+        return single;
+    }
+}
+
+static GSList *
+_sequence_to_list(GSequence *sequence)
+{
+    GSList *result = NULL;
+    GSequenceIter *iter = g_sequence_get_end_iter(sequence);
+
+    while (!g_sequence_iter_is_begin(iter)) {
+        iter = g_sequence_iter_prev(iter);
+        result = g_slist_prepend(result, g_sequence_get(iter));
+    }
+
+    return result;
+}
+
+/*
+ * Merge two sorted lists of contacts, freeing both
+ */
+static GSList *
+_merge_contacts(GSList *first, GSList *second)
+{
+    GSList *result = NULL;
+    GSList *curr_first = first;
+    GSList *curr_second = second;
+
+    while ((curr_first != NULL) || (curr_second != NULL)) {
+        if ((curr_second == NULL) || ((curr_first != NULL) &&
+                (_compare_contacts(curr_first->data, curr_second->data, NULL) <= 0))) {
+            result = g_slist_prepend(result, curr_first->data);
+            curr_first = g_slist_next(curr_first);
+        } else {
+            result = g_slist_prepend(result, curr_second->data);
+            curr_second = g_slist_next(curr_second);
+        }
+    }
+
+    g_slist_free(first);
+    g_slist_free(second);
+
+    return g_slist_reverse(result);
+}
+
 GSList *
 _get_groups_from_item(xmpp_stanza_t *item)
 {
@@ -700,30 +1570,15 @@ gboolean _key_equals(void *key1, void *key2)
 }
 
 static
-gint _compare_contacts(PContact a, PContact b)
+gint _compare_contacts(PContact a, PContact b, gpointer data)
 {
-    const char * utf8_str_a = NULL;
-    const char * utf8_str_b = NULL;
+    gint result = strcmp(p_contact_collate_key(a), p_contact_collate_key(b));
 
-    if (p_contact_name(a) != NULL) {
-        utf8_str_a = p_contact_name(a);
-    } else {
-        utf8_str_a = p_contact_barejid(a);
-    }
-    if (p_contact_name(b) != NULL) {
-        utf8_str_b = p_contact_name(b);
-    } else {
-        utf8_str_b = p_contact_barejid(b);
+    // barejids are unique, so contacts with equal names still have an order
+    if (result == 0) {
+        result = strcmp(p_contact_barejid(a), p_contact_barejid(b));
     }
 
-    gchar *key_a = g_utf8_collate_key(utf8_str_a, -1);
-    gchar *key_b = g_utf8_collate_key(utf8_str_b, -1);
-
-    gint result = g_strcmp0(key_a, key_b);
-
-    g_free(key_a);
-    g_free(key_b);
-
     return result;
 }
 
@@ -740,3 +1595,189 @@ _datetimes_equal(GDateTime *dt1, GDateTime *dt2)
         return g_date_time_equal(dt1, dt2);
     }
 }
+
+/*
+ * Queue a roster set for each matching contact that needs changing, and start
+ * sending them, at most ROSTER_BULK_WINDOW are awaiting a result at any time
+ */
+static int
+_bulk_start(roster_bulk_type_t type, const char * const group,
+    const char * const pattern)
+{
+    GSList *matches = roster_get_contacts_matching(pattern);
+    GQueue *pending = g_queue_new();
+    GHashTable *targets = g_hash_table_new_full(g_str_hash, g_str_equal, free,
+        NULL);
+
+    GSList *curr = matches;
+    while (curr != NULL) {
+        PContact contact = curr->data;
+        gboolean in_group = (group != NULL) && p_contact_in_group(contact, group);
+
+        if (((type == BULK_GROUP_ADD) && !in_group) ||
+                ((type == BULK_GROUP_REMOVE) && in_group) ||
+                (type == BULK_ROSTER_REMOVE)) {
+            g_queue_push_tail(pending, strdup(p_contact_barejid(contact)));
+            g_hash_table_add(targets, strdup(p_contact_barejid(contact)));
+        }
+        curr = g_slist_next(curr);
+    }
+    g_slist_free(matches);
+
+    int total = g_queue_get_length(pending);
+    if (total == 0) {
+        g_queue_free(pending);
+        g_hash_table_destroy(targets);
+        return 0;
+    }
+
+    BulkOperation *operation = malloc(sizeof(BulkOperation));
+    operation->type = type;
+    operation->group = (group != NULL) ? strdup(group) : NULL;
+    if (type == BULK_GROUP_ADD) {
+        operation->description = g_strdup_printf("Add to group %s", group);
+    } else if (type == BULK_GROUP_REMOVE) {
+        operation->description = g_strdup_printf("Remove from group %s", group);
+    } else {
+        operation->description = g_strdup("Remove from roster");
+    }
+    operation->targets = targets;
+    operation->pending = pending;
+    operation->in_flight = g_hash_table_new_full(g_str_hash, g_str_equal, free,
+        NULL);
+    operation->total = total;
+    operation->succeeded = 0;
+    operation->failed = 0;
+    bulk_operations = g_slist_prepend(bulk_operations, operation);
+
+    _bulk_send_next(operation);
+
+    return total;
+}
+
+/*
+ * Fill the window with queued roster sets, reporting and freeing the
+ * operation once every result has arrived
+ */
+static void
+_bulk_send_next(BulkOperation *operation)
+{
+    xmpp_conn_t * const conn = connection_get_conn();
+
+    while ((g_hash_table_size(operation->in_flight) < ROSTER_BULK_WINDOW) &&
+            !g_queue_is_empty(operation->pending)) {
+        char *barejid = g_queue_pop_head(operation->pending);
+        PContact contact = g_hash_table_lookup(contacts, barejid);
+        free(barejid);
+
+        // removed from the roster since the operation started
+        if (contact == NULL) {
+            operation->failed++;
+            continue;
+        }
+
+        char *unique_id = get_unique_id();
+        xmpp_stanza_t *iq = _bulk_create_set(operation, unique_id, contact);
+        xmpp_id_handler_add(conn, _bulk_result_handler, unique_id, operation);
+        xmpp_send(conn, iq);
+        xmpp_stanza_release(iq);
+        g_hash_table_add(operation->in_flight, unique_id);
+    }
+
+    if ((g_hash_table_size(operation->in_flight) == 0) &&
+            g_queue_is_empty(operation->pending)) {
+        bulk_operations = g_slist_remove(bulk_operations, operation);
+        prof_handle_roster_bulk_complete(operation->description,
+            operation->succeeded, operation->failed);
+        _bulk_free(operation);
+    }
+}
+
+static xmpp_stanza_t *
+_bulk_create_set(BulkOperation *operation, const char * const id,
+    PContact contact)
+{
+    xmpp_ctx_t * const ctx = connection_get_ctx();
+    const char *barejid = p_contact_barejid(contact);
+
+    if (operation->type == BULK_ROSTER_REMOVE) {
+        xmpp_stanza_t *iq = stanza_create_roster_remove_set(ctx, barejid);
+        xmpp_stanza_set_id(iq, id);
+        return iq;
+    }
+
+    GSList *new_groups = NULL;
+    GSList *groups = p_contact_groups(contact);
+    while (groups != NULL) {
+        if (strcmp(groups->data, operation->group) != 0) {
+            new_groups = g_slist_append(new_groups, strdup(groups->data));
+        }
+        groups = g_slist_next(groups);
+    }
+
+    if (operation->type == BULK_GROUP_ADD) {
+        new_groups = g_slist_append(new_groups, strdup(operation->group));
+    }
+
+    xmpp_stanza_t *iq = stanza_create_roster_set(ctx, id, barejid,
+        p_contact_name(contact), new_groups);
+    g_slist_free_full(new_groups, free);
+
+    return iq;
+}
+
+static void
+_bulk_free(BulkOperation *operation)
+{
+    if (operation != NULL) {
+        free(operation->group);
+        g_free(operation->description);
+        g_hash_table_destroy(operation->targets);
+        g_queue_free_full(operation->pending, free);
+        g_hash_table_destroy(operation->in_flight);
+        free(operation);
+    }
+}
+
+/*
+ * Abandon unfinished bulk operations, removing the handlers for their
+ * outstanding results while the connection still exists
+ */
+static void
+_bulk_cancel_all(void)
+{
+    xmpp_conn_t * const conn = connection_get_conn();
+
+    GSList *curr = bulk_operations;
+    while (curr != NULL) {
+        BulkOperation *operation = curr->data;
+        if (conn != NULL) {
+            GHashTableIter iter;
+            gpointer id;
+            g_hash_table_iter_init(&iter, operation->in_flight);
+            while (g_hash_table_iter_next(&iter, &id, NULL)) {
+                xmpp_id_handler_delete(conn, _bulk_result_handler, id);
+            }
+        }
+        _bulk_free(operation);
+        curr = g_slist_next(curr);
+    }
+    g_slist_free(bulk_operations);
+    bulk_operations = NULL;
+}
+
+static gboolean
+_bulk_removing(const char * const barejid)
+{
+    GSList *curr = bulk_operations;
+    while (curr != NULL) {
+        BulkOperation *operation = curr->data;
+        if ((operation->type == BULK_ROSTER_REMOVE) &&
+                g_hash_table_contains(operation->targets, barejid)) {
+            return TRUE;
+        }
+        curr = g_slist_next(curr);
+    }
+
+    return FALSE;
+}
@@ -26,6 +26,8 @@
 void roster_add_handlers(void);
 void roster_request(void);
 
+void roster_bulk_add_start(void);
+void roster_bulk_add_end(void);
 void roster_update(const char * const barejid, const char * const name,
     GSList *groups, const char * const subscription, gboolean pending_out);
 
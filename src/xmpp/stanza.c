@@ -318,7 +318,7 @@ stanza_create_software_version_iq(xmpp_ctx_t *ctx, const char * const fulljid)
 }
 
 xmpp_stanza_t *
-stanza_create_roster_iq(xmpp_ctx_t *ctx)
+stanza_create_roster_iq(xmpp_ctx_t *ctx, const char * const ver)
 {
     xmpp_stanza_t *iq = xmpp_stanza_new(ctx);
     xmpp_stanza_set_name(iq, STANZA_NAME_IQ);
@@ -328,6 +328,9 @@ stanza_create_roster_iq(xmpp_ctx_t *ctx)
     xmpp_stanza_t *query = xmpp_stanza_new(ctx);
     xmpp_stanza_set_name(query, STANZA_NAME_QUERY);
     xmpp_stanza_set_ns(query, XMPP_NS_ROSTER);
+    if (ver != NULL) {
+        xmpp_stanza_set_attribute(query, STANZA_ATTR_VER, ver);
+    }
 
     xmpp_stanza_add_child(iq, query);
     xmpp_stanza_release(query);
@@ -378,6 +381,50 @@ stanza_create_disco_items_iq(xmpp_ctx_t *ctx, const char * const id,
     return iq;
 }
 
+/*
+ * Create a disco#items request for at most max items following the item
+ * with the id after, or the first page when after is NULL (XEP-0059)
+ */
+xmpp_stanza_t *
+stanza_create_disco_items_page_iq(xmpp_ctx_t *ctx, const char * const id,
+    const char * const jid, int max, const char * const after)
+{
+    xmpp_stanza_t *iq = stanza_create_disco_items_iq(ctx, id, jid);
+    xmpp_stanza_t *query = xmpp_stanza_get_child_by_name(iq,
+        STANZA_NAME_QUERY);
+
+    xmpp_stanza_t *set = xmpp_stanza_new(ctx);
+    xmpp_stanza_set_name(set, STANZA_NAME_SET);
+    xmpp_stanza_set_ns(set, STANZA_NS_RSM);
+
+    xmpp_stanza_t *max_st = xmpp_stanza_new(ctx);
+    xmpp_stanza_set_name(max_st, STANZA_NAME_MAX);
+    xmpp_stanza_t *max_text = xmpp_stanza_new(ctx);
+    char *max_str = g_strdup_printf("%d", max);
+    xmpp_stanza_set_text(max_text, max_str);
+    g_free(max_str);
+    xmpp_stanza_add_child(max_st, max_text);
+    xmpp_stanza_release(max_text);
+    xmpp_stanza_add_child(set, max_st);
+    xmpp_stanza_release(max_st);
+
+    if (after != NULL) {
+        xmpp_stanza_t *after_st = xmpp_stanza_new(ctx);
+        xmpp_stanza_set_name(after_st, STANZA_NAME_AFTER);
+        xmpp_stanza_t *after_text = xmpp_stanza_new(ctx);
+        xmpp_stanza_set_text(after_text, after);
+        xmpp_stanza_add_child(after_st, after_text);
+        xmpp_stanza_release(after_text);
+        xmpp_stanza_add_child(set, after_st);
+        xmpp_stanza_release(after_st);
+    }
+
+    xmpp_stanza_add_child(query, set);
+    xmpp_stanza_release(set);
+
+    return iq;
+}
+
 gboolean
 stanza_contains_chat_state(xmpp_stanza_t *stanza)
 {
@@ -666,6 +713,27 @@ stanza_get_new_nick(xmpp_stanza_t * const stanza)
     }
 }
 
+/*
+ * Return the attribute of the muc#user item in a room presence, the result is
+ * owned by the stanza
+ */
+char *
+stanza_get_muc_item_attribute(xmpp_stanza_t * const stanza,
+    const char * const attr)
+{
+    xmpp_stanza_t *x = xmpp_stanza_get_child_by_ns(stanza, STANZA_NS_MUC_USER);
+    if (x == NULL) {
+        return NULL;
+    }
+
+    xmpp_stanza_t *item = xmpp_stanza_get_child_by_name(x, STANZA_NAME_ITEM);
+    if (item == NULL) {
+        return NULL;
+    }
+
+    return xmpp_stanza_get_attribute(item, attr);
+}
+
 int
 stanza_get_idle_time(xmpp_stanza_t * const stanza)
 {
@@ -55,6 +55,11 @@
 #define STANZA_NAME_PUBSUB "pubsub"
 #define STANZA_NAME_STORAGE "storage"
 #define STANZA_NAME_CONFERENCE "conference"
+#define STANZA_NAME_SET "set"
+#define STANZA_NAME_MAX "max"
+#define STANZA_NAME_AFTER "after"
+#define STANZA_NAME_LAST "last"
+#define STANZA_NAME_COUNT "count"
 
 #define STANZA_TYPE_CHAT "chat"
 #define STANZA_TYPE_GROUPCHAT "groupchat"
@@ -86,6 +91,8 @@
 #define STANZA_ATTR_HASH "hash"
 #define STANZA_ATTR_CATEGORY "category"
 #define STANZA_ATTR_REASON "reason"
+#define STANZA_ATTR_ROLE "role"
+#define STANZA_ATTR_AFFILIATION "affiliation"
 
 #define STANZA_TEXT_AWAY "away"
 #define STANZA_TEXT_DND "dnd"
@@ -104,6 +111,7 @@
 #define STANZA_NS_CONFERENCE "jabber:x:conference"
 #define STANZA_NS_CAPTCHA "urn:xmpp:captcha"
 #define STANZA_NS_PUBSUB "http://jabber.org/protocol/pubsub"
+#define STANZA_NS_RSM "http://jabber.org/protocol/rsm"
 
 #define STANZA_DATAFORM_SOFTWARE "urn:xmpp:dataforms:softwareinfo"
 
@@ -137,7 +145,8 @@ xmpp_stanza_t* stanza_create_room_leave_presence(xmpp_ctx_t *ctx,
 
 xmpp_stanza_t* stanza_create_presence(xmpp_ctx_t * const ctx);
 
-xmpp_stanza_t* stanza_create_roster_iq(xmpp_ctx_t *ctx);
+xmpp_stanza_t* stanza_create_roster_iq(xmpp_ctx_t *ctx,
+    const char * const ver);
 xmpp_stanza_t* stanza_create_ping_iq(xmpp_ctx_t *ctx);
 xmpp_stanza_t* stanza_create_disco_info_iq(xmpp_ctx_t *ctx, const char * const id,
     const char * const to, const char * const node);
@@ -155,6 +164,8 @@ gboolean stanza_is_muc_self_presence(xmpp_stanza_t * const stanza,
 gboolean stanza_is_room_nick_change(xmpp_stanza_t * const stanza);
 
 char * stanza_get_new_nick(xmpp_stanza_t * const stanza);
+char * stanza_get_muc_item_attribute(xmpp_stanza_t * const stanza,
+    const char * const attr);
 
 int stanza_get_idle_time(xmpp_stanza_t * const stanza);
 char * stanza_get_caps_str(xmpp_stanza_t * const stanza);
@@ -181,6 +192,9 @@ const char * stanza_get_presence_string_from_type(resource_presence_t presence_t
 xmpp_stanza_t * stanza_create_software_version_iq(xmpp_ctx_t *ctx, const char * const fulljid);
 xmpp_stanza_t * stanza_create_disco_items_iq(xmpp_ctx_t *ctx, const char * const id,
     const char * const jid);
+xmpp_stanza_t * stanza_create_disco_items_page_iq(xmpp_ctx_t *ctx,
+    const char * const id, const char * const jid, int max,
+    const char * const after);
 
 char * stanza_get_status(xmpp_stanza_t *stanza, char *def);
 char * stanza_get_show(xmpp_stanza_t *stanza, char *def);
@@ -126,6 +126,7 @@ Capabilities* caps_get(const char * const caps_str);
 void caps_close(void);
 
 void roster_clear(void);
+void roster_set_stale(void);
 gboolean roster_update_presence(const char * const barejid,
     Resource *resource, GDateTime *last_activity);
 PContact roster_get_contact(const char const *barejid);
@@ -135,7 +136,10 @@ void roster_reset_search_attempts(void);
 void roster_init(void);
 void roster_free(void);
 gboolean roster_has_pending_subscriptions(void);
+GSList * roster_get_pending_out(void);
 GSList * roster_get_contacts(void);
+GSList * roster_get_contacts_by_presence(const char * const filter);
+int roster_count_by_presence(const char * const filter);
 char * roster_find_contact(char *search_str);
 char * roster_find_jid(char *search_str);
 char * roster_find_resource(char *search_str);
@@ -151,6 +155,12 @@ GSList * roster_get_group(const char * const group);
 void roster_add_to_group(const char * const group, const char * const barejid);
 void roster_remove_from_group(const char * const group,
     const char * const barejid);
+GSList * roster_get_contacts_matching(const char * const pattern);
+int roster_add_to_group_matching(const char * const group,
+    const char * const pattern);
+int roster_remove_from_group_matching(const char * const group,
+    const char * const pattern);
+int roster_remove_matching(const char * const pattern);
 GSList * roster_get_groups(void);
 
 #endif
@@ -147,6 +147,48 @@ static void add_two_same_returns_false(void)
     autocomplete_clear(ac);
 }
 
+static void add_all_adds_sorted(void)
+{
+    Autocomplete ac = autocomplete_new();
+    GSList *items = NULL;
+    items = g_slist_append(items, "Bob");
+    items = g_slist_append(items, "Carl");
+    items = g_slist_append(items, "Adam");
+    autocomplete_add_all(ac, items);
+    GSList *result = autocomplete_get_list(ac);
+
+    assert_int_equals(3, g_slist_length(result));
+    assert_string_equals("Adam", g_slist_nth_data(result, 0));
+    assert_string_equals("Bob", g_slist_nth_data(result, 1));
+    assert_string_equals("Carl", g_slist_nth_data(result, 2));
+
+    g_slist_free(items);
+    g_slist_free_full(result, free);
+    autocomplete_clear(ac);
+}
+
+static void add_all_merges_with_existing_once(void)
+{
+    Autocomplete ac = autocomplete_new();
+    autocomplete_add(ac, "Bob");
+    autocomplete_add(ac, "Dave");
+    GSList *items = NULL;
+    items = g_slist_append(items, "Dave");
+    items = g_slist_append(items, "Carl");
+    items = g_slist_append(items, "Carl");
+    autocomplete_add_all(ac, items);
+    GSList *result = autocomplete_get_list(ac);
+
+    assert_int_equals(3, g_slist_length(result));
+    assert_string_equals("Bob", g_slist_nth_data(result, 0));
+    assert_string_equals("Carl", g_slist_nth_data(result, 1));
+    assert_string_equals("Dave", g_slist_nth_data(result, 2));
+
+    g_slist_free(items);
+    g_slist_free_full(result, free);
+    autocomplete_clear(ac);
+}
+
 void register_autocomplete_tests(void)
 {
     TEST_MODULE("autocomplete tests");
@@ -163,4 +205,6 @@ void register_autocomplete_tests(void)
     TEST(add_one_returns_true);
     TEST(add_two_different_returns_true);
     TEST(add_two_same_returns_false);
+    TEST(add_all_adds_sorted);
+    TEST(add_all_merges_with_existing_once);
 }
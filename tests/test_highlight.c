@@ -0,0 +1,165 @@
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <head-unit.h>
+#include <glib.h>
+
+#include "tools/highlight.h"
+
+static Highlighter _highlighter(const char * const word, ...);
+
+static void no_words_finds_nothing(void)
+{
+    Highlighter highlighter = highlighter_new(NULL);
+
+    assert_is_null(highlighter_find(highlighter, "hello bob"));
+    assert_false(highlighter_matches(highlighter, "hello bob"));
+
+    highlighter_free(highlighter);
+}
+
+static void finds_single_word(void)
+{
+    Highlighter highlighter = _highlighter("bob", NULL);
+    GSList *matches = highlighter_find(highlighter, "hello bob!");
+    HighlightMatch *match = matches->data;
+
+    assert_int_equals(1, g_slist_length(matches));
+    assert_int_equals(6, match->start);
+    assert_int_equals(9, match->end);
+    assert_true(highlighter_matches(highlighter, "hello bob!"));
+
+    g_slist_free_full(matches, free);
+    highlighter_free(highlighter);
+}
+
+static void ignores_case(void)
+{
+    Highlighter highlighter = _highlighter("Release", NULL);
+
+    assert_true(highlighter_matches(highlighter, "the RELEASE is out"));
+    assert_false(highlighter_matches(highlighter, "the relase is out"));
+
+    highlighter_free(highlighter);
+}
+
+static void finds_each_word_in_order(void)
+{
+    Highlighter highlighter = _highlighter("bob", "alert", "ops", NULL);
+    GSList *matches = highlighter_find(highlighter, "ops alert for bob");
+    HighlightMatch *first = matches->data;
+    HighlightMatch *second = g_slist_nth_data(matches, 1);
+    HighlightMatch *third = g_slist_nth_data(matches, 2);
+
+    assert_int_equals(3, g_slist_length(matches));
+    assert_int_equals(0, first->start);
+    assert_int_equals(4, second->start);
+    assert_int_equals(14, third->start);
+    assert_int_equals(17, third->end);
+
+    g_slist_free_full(matches, free);
+    highlighter_free(highlighter);
+}
+
+static void finds_word_inside_failed_prefix(void)
+{
+    Highlighter highlighter = _highlighter("a-bx", "bc", NULL);
+    GSList *matches = highlighter_find(highlighter, "a-bc");
+    HighlightMatch *match = matches->data;
+
+    assert_int_equals(1, g_slist_length(matches));
+    assert_int_equals(2, match->start);
+    assert_int_equals(4, match->end);
+
+    g_slist_free_full(matches, free);
+    highlighter_free(highlighter);
+}
+
+static void merges_overlapping_matches(void)
+{
+    Highlighter highlighter = _highlighter("bob", "bob smith", "smith jones",
+        NULL);
+    GSList *matches = highlighter_find(highlighter, "hi bob smith jones");
+    HighlightMatch *match = matches->data;
+
+    assert_int_equals(1, g_slist_length(matches));
+    assert_int_equals(3, match->start);
+    assert_int_equals(18, match->end);
+
+    g_slist_free_full(matches, free);
+    highlighter_free(highlighter);
+}
+
+static void ignores_word_inside_other_word(void)
+{
+    Highlighter highlighter = _highlighter("al", NULL);
+
+    assert_is_null(highlighter_find(highlighter, "totally"));
+    assert_false(highlighter_matches(highlighter, "totally"));
+    assert_false(highlighter_matches(highlighter, "also"));
+    assert_false(highlighter_matches(highlighter, "pal"));
+    assert_true(highlighter_matches(highlighter, "al: ping"));
+    assert_true(highlighter_matches(highlighter, "ping (al)"));
+
+    highlighter_free(highlighter);
+}
+
+static void finds_shorter_word_when_longer_runs_on(void)
+{
+    Highlighter highlighter = _highlighter("al", "x-al", NULL);
+    GSList *matches = highlighter_find(highlighter, "ax-al");
+    HighlightMatch *match = matches->data;
+
+    assert_int_equals(1, g_slist_length(matches));
+    assert_int_equals(3, match->start);
+    assert_int_equals(5, match->end);
+
+    g_slist_free_full(matches, free);
+    highlighter_free(highlighter);
+}
+
+static void matches_words_edged_with_punctuation(void)
+{
+    Highlighter highlighter = _highlighter("[bot]", NULL);
+
+    assert_true(highlighter_matches(highlighter, "hi [bot]s"));
+    assert_true(highlighter_matches(highlighter, "hi x[bot]"));
+    assert_false(highlighter_matches(highlighter, "hi [bot"));
+
+    highlighter_free(highlighter);
+}
+
+void register_highlight_tests(void)
+{
+    TEST_MODULE("highlight tests");
+    TEST(no_words_finds_nothing);
+    TEST(finds_single_word);
+    TEST(ignores_case);
+    TEST(finds_each_word_in_order);
+    TEST(finds_word_inside_failed_prefix);
+    TEST(merges_overlapping_matches);
+    TEST(ignores_word_inside_other_word);
+    TEST(finds_shorter_word_when_longer_runs_on);
+    TEST(matches_words_edged_with_punctuation);
+}
+
+static Highlighter
+_highlighter(const char * const word, ...)
+{
+    GSList *words = NULL;
+    va_list args;
+    va_start(args, word);
+    const char *curr = word;
+    while (curr != NULL) {
+        words = g_slist_append(words, (gpointer)curr);
+        curr = va_arg(args, const char *);
+    }
+    va_end(args);
+
+    Highlighter highlighter = highlighter_new(words);
+    g_slist_free(words);
+
+    return highlighter;
+}
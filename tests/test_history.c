@@ -214,6 +214,98 @@ void start_session_add_new_submit_previous(void)
     history_append(history, item3);
 }
 
+void previous_loads_lazy_items(void)
+{
+    History history = history_new(10);
+    history_load_lazy(history, "first\nsecond\n", 13);
+
+    char *item1 = history_previous(history, NULL);
+    char *item2 = history_previous(history, item1);
+    char *item3 = history_previous(history, item2);
+
+    assert_string_equals("second", item1);
+    assert_string_equals("first", item2);
+    assert_string_equals("first", item3);
+}
+
+void lazy_items_before_appended(void)
+{
+    History history = history_new(10);
+    history_load_lazy(history, "first\nsecond\n", 13);
+    history_append(history, "third");
+
+    char *item1 = history_previous(history, NULL);
+    char *item2 = history_previous(history, item1);
+    char *item3 = history_previous(history, item2);
+
+    assert_string_equals("third", item1);
+    assert_string_equals("second", item2);
+    assert_string_equals("first", item3);
+}
+
+void lazy_items_limited_to_size(void)
+{
+    History history = history_new(2);
+    history_load_lazy(history, "first\nsecond\nthird\n", 19);
+
+    char *item1 = history_previous(history, NULL);
+    char *item2 = history_previous(history, item1);
+    char *item3 = history_previous(history, item2);
+
+    assert_string_equals("second", item3);
+}
+
+void appended_items_limited_to_size(void)
+{
+    History history = history_new(2);
+    history_append(history, "first");
+    history_append(history, "second");
+    history_append(history, "third");
+
+    char *item1 = history_previous(history, NULL);
+    char *item2 = history_previous(history, item1);
+    char *item3 = history_previous(history, item2);
+
+    assert_string_equals("third", item1);
+    assert_string_equals("second", item2);
+    assert_string_equals("second", item3);
+}
+
+void lazy_items_limited_with_appended(void)
+{
+    History history = history_new(3);
+    history_load_lazy(history, "first\nsecond\nthird\n", 19);
+    history_append(history, "fourth");
+    history_append(history, "fifth");
+
+    char *item1 = history_previous(history, NULL);
+    char *item2 = history_previous(history, item1);
+    char *item3 = history_previous(history, item2);
+    char *item4 = history_previous(history, item3);
+
+    assert_string_equals("fifth", item1);
+    assert_string_equals("fourth", item2);
+    assert_string_equals("third", item3);
+    assert_string_equals("third", item4);
+}
+
+void edits_discarded_after_append(void)
+{
+    History history = history_new(10);
+    history_append(history, "Hello");
+    history_append(history, "again");
+
+    char *item1 = history_previous(history, NULL);
+    char *item2 = history_previous(history, "EDITED");
+    history_append(history, item2);
+    char *item3 = history_previous(history, NULL);
+    char *item4 = history_previous(history, item3);
+
+    assert_string_equals("again", item1);
+    assert_string_equals("Hello", item3);
+    assert_string_equals("again", item4);
+}
+
 void register_history_tests(void)
 {
     TEST_MODULE("history tests");
@@ -230,4 +322,10 @@ void register_history_tests(void)
     TEST(edit_item_mid_history);
     TEST(edit_previous_and_append);
     TEST(start_session_add_new_submit_previous);
+    TEST(previous_loads_lazy_items);
+    TEST(lazy_items_before_appended);
+    TEST(lazy_items_limited_to_size);
+    TEST(appended_items_limited_to_size);
+    TEST(lazy_items_limited_with_appended);
+    TEST(edits_discarded_after_append);
 }
@@ -0,0 +1,254 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <head-unit.h>
+#include <glib.h>
+
+#include "tools/history.h"
+#include "tools/history_index.h"
+
+static History history;
+static HistoryIndex hist_index;
+
+static void _add(const char * const entry);
+
+static void beforetest(void)
+{
+    history = history_new(100);
+    hist_index = history_index_new(history);
+}
+
+static void aftertest(void)
+{
+    history_index_free(hist_index);
+}
+
+static void search_on_empty_returns_null(void)
+{
+    char *result = history_index_search(hist_index, "hello");
+
+    assert_is_null(result);
+}
+
+static void search_returns_newest_match(void)
+{
+    _add("/msg bob hello");
+    _add("/msg alice hello");
+    _add("/who");
+
+    char *result = history_index_search(hist_index, "hello");
+
+    assert_string_equals("/msg alice hello", result);
+    free(result);
+}
+
+static void search_short_query_returns_newest_match(void)
+{
+    _add("/msg bob hello");
+    _add("/who");
+
+    char *result = history_index_search(hist_index, "m");
+
+    assert_string_equals("/msg bob hello", result);
+    free(result);
+}
+
+static void search_no_match_returns_null(void)
+{
+    _add("/msg bob hello");
+
+    char *result = history_index_search(hist_index, "goodbye");
+
+    assert_is_null(result);
+}
+
+static void search_narrows_as_query_grows(void)
+{
+    _add("/msg bob hello");
+    _add("/msg alice hello");
+
+    char *result1 = history_index_search(hist_index, "/ms");
+    char *result2 = history_index_search(hist_index, "/msg b");
+
+    assert_string_equals("/msg alice hello", result1);
+    assert_string_equals("/msg bob hello", result2);
+    free(result1);
+    free(result2);
+}
+
+static void search_older_returns_older_match(void)
+{
+    _add("/msg bob hello");
+    _add("/who");
+    _add("/msg alice hello");
+
+    char *result1 = history_index_search(hist_index, "msg");
+    char *result2 = history_index_search_older(hist_index);
+    char *result3 = history_index_search_older(hist_index);
+
+    assert_string_equals("/msg alice hello", result1);
+    assert_string_equals("/msg bob hello", result2);
+    assert_is_null(result3);
+    free(result1);
+    free(result2);
+}
+
+static void search_older_skips_duplicates(void)
+{
+    _add("/msg bob hello");
+    _add("/msg alice hello");
+    _add("/msg alice hello");
+
+    char *result1 = history_index_search(hist_index, "hello");
+    char *result2 = history_index_search_older(hist_index);
+
+    assert_string_equals("/msg alice hello", result1);
+    assert_string_equals("/msg bob hello", result2);
+    free(result1);
+    free(result2);
+}
+
+static void search_continues_from_current_match(void)
+{
+    _add("/msg bob hello");
+    _add("/msg bob goodbye");
+    _add("/msg alice hello");
+
+    char *result1 = history_index_search(hist_index, "msg");
+    char *result2 = history_index_search_older(hist_index);
+    char *result3 = history_index_search(hist_index, "msg bob h");
+
+    assert_string_equals("/msg bob goodbye", result2);
+    assert_string_equals("/msg bob hello", result3);
+    free(result1);
+    free(result2);
+    free(result3);
+}
+
+static void search_after_reset_starts_at_newest(void)
+{
+    _add("/msg bob hello");
+    _add("/msg alice hello");
+
+    char *result1 = history_index_search(hist_index, "hello");
+    char *result2 = history_index_search_older(hist_index);
+    history_index_reset_search(hist_index);
+    char *result3 = history_index_search(hist_index, "hello");
+
+    assert_string_equals("/msg alice hello", result3);
+    free(result1);
+    free(result2);
+    free(result3);
+}
+
+static void search_finds_entry_added_during_search(void)
+{
+    _add("/msg bob hello");
+
+    char *result1 = history_index_search(hist_index, "hello");
+    _add("/msg alice hello");
+    history_index_reset_search(hist_index);
+    char *result2 = history_index_search(hist_index, "hello");
+
+    assert_string_equals("/msg alice hello", result2);
+    free(result1);
+    free(result2);
+}
+
+static void search_restarts_when_query_shrinks(void)
+{
+    _add("/msg bob hello");
+    _add("/msg alice hello");
+
+    char *result1 = history_index_search(hist_index, "/msg b");
+    char *result2 = history_index_search(hist_index, "/msg ");
+
+    assert_string_equals("/msg bob hello", result1);
+    assert_string_equals("/msg alice hello", result2);
+    free(result1);
+    free(result2);
+}
+
+static void search_skips_removed_entries(void)
+{
+    History small = history_new(2);
+    HistoryIndex small_index = history_index_new(small);
+    history_append(small, "hello one");
+    history_append(small, "hello two");
+    history_append(small, "hello three");
+    history_index_update(small_index);
+
+    char *result1 = history_index_search(small_index, "hello");
+    char *result2 = history_index_search_older(small_index);
+    char *result3 = history_index_search_older(small_index);
+
+    assert_string_equals("hello three", result1);
+    assert_string_equals("hello two", result2);
+    assert_is_null(result3);
+    free(result1);
+    free(result2);
+    history_index_free(small_index);
+}
+
+static void removed_entries_dropped_from_postings(void)
+{
+    History small = history_new(4);
+    HistoryIndex small_index = history_index_new(small);
+    int i;
+    for (i = 0; i < 40; i++) {
+        char *entry = g_strdup_printf("abc %d", i);
+        history_append(small, entry);
+        g_free(entry);
+        history_index_update(small_index);
+    }
+
+    char *result = history_index_search(small_index, "abc 3");
+
+    assert_int_equals(4, history_index_length(small_index));
+    assert_true(history_index_postings(small_index) <= 5 * 4);
+    assert_string_equals("abc 39", result);
+    free(result);
+    history_index_free(small_index);
+}
+
+static void search_finds_lazily_loaded_entries(void)
+{
+    History loaded = history_new(10);
+    history_load_lazy(loaded, "/msg bob hello\n/who\n", 20);
+    HistoryIndex loaded_index = history_index_new(loaded);
+
+    char *result = history_index_search(loaded_index, "hello");
+
+    assert_string_equals("/msg bob hello", result);
+    free(result);
+    history_index_free(loaded_index);
+}
+
+void register_history_index_tests(void)
+{
+    TEST_MODULE("history index tests");
+    BEFORETEST(beforetest);
+    AFTERTEST(aftertest);
+    TEST(search_on_empty_returns_null);
+    TEST(search_returns_newest_match);
+    TEST(search_short_query_returns_newest_match);
+    TEST(search_no_match_returns_null);
+    TEST(search_narrows_as_query_grows);
+    TEST(search_older_returns_older_match);
+    TEST(search_older_skips_duplicates);
+    TEST(search_continues_from_current_match);
+    TEST(search_after_reset_starts_at_newest);
+    TEST(search_finds_entry_added_during_search);
+    TEST(search_restarts_when_query_shrinks);
+    TEST(search_skips_removed_entries);
+    TEST(removed_entries_dropped_from_postings);
+    TEST(search_finds_lazily_loaded_entries);
+}
+
+static void
+_add(const char * const entry)
+{
+    history_append(history, (char *)entry);
+    history_index_update(hist_index);
+}
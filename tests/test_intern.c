@@ -0,0 +1,124 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <head-unit.h>
+#include <glib.h>
+
+#include "tools/intern.h"
+
+static void intern_null_returns_null(void)
+{
+    const char *result = intern_str(NULL);
+
+    assert_is_null(result);
+}
+
+static void intern_returns_copy(void)
+{
+    char *str = strdup("james@server.org");
+    const char *result = intern_str(str);
+    free(str);
+
+    assert_string_equals("james@server.org", result);
+
+    intern_release(result);
+}
+
+static void intern_equal_strings_returns_same_pointer(void)
+{
+    const char *result1 = intern_str("bob@server.org");
+    const char *result2 = intern_str("bob@server.org");
+
+    assert_true(result1 == result2);
+
+    intern_release(result1);
+    intern_release(result2);
+}
+
+static void intern_different_strings_returns_different_pointers(void)
+{
+    const char *result1 = intern_str("bob@server.org");
+    const char *result2 = intern_str("dave@server.org");
+
+    assert_false(result1 == result2);
+
+    intern_release(result1);
+    intern_release(result2);
+}
+
+static void intern_adds_one_string_for_equal_strings(void)
+{
+    guint before = intern_count();
+    const char *result1 = intern_str("group one");
+    const char *result2 = intern_str("group one");
+
+    assert_int_equals(before + 1, intern_count());
+
+    intern_release(result1);
+    intern_release(result2);
+}
+
+static void release_keeps_string_while_referenced(void)
+{
+    guint before = intern_count();
+    const char *result1 = intern_str("group two");
+    const char *result2 = intern_str("group two");
+    intern_release(result1);
+
+    assert_int_equals(before + 1, intern_count());
+    assert_string_equals("group two", result2);
+
+    intern_release(result2);
+}
+
+static void release_last_reference_removes_string(void)
+{
+    guint before = intern_count();
+    const char *result1 = intern_str("group three");
+    const char *result2 = intern_str("group three");
+    intern_release(result1);
+    intern_release(result2);
+
+    assert_int_equals(before, intern_count());
+}
+
+static void release_of_copy_keeps_reference(void)
+{
+    guint before = intern_count();
+    const char *interned = intern_str("group six");
+    char copy[] = "group six";
+    intern_release(copy);
+
+    assert_int_equals(before + 1, intern_count());
+    assert_true(intern_lookup("group six") == interned);
+
+    intern_release(interned);
+}
+
+static void lookup_returns_interned_without_reference(void)
+{
+    guint before = intern_count();
+    const char *interned = intern_str("group four");
+
+    assert_true(intern_lookup("group four") == interned);
+    assert_is_null(intern_lookup("group five"));
+
+    intern_release(interned);
+
+    assert_int_equals(before, intern_count());
+}
+
+void register_intern_tests(void)
+{
+    TEST_MODULE("intern tests");
+    TEST(intern_null_returns_null);
+    TEST(intern_returns_copy);
+    TEST(intern_equal_strings_returns_same_pointer);
+    TEST(intern_different_strings_returns_different_pointers);
+    TEST(intern_adds_one_string_for_equal_strings);
+    TEST(release_keeps_string_while_referenced);
+    TEST(release_last_reference_removes_string);
+    TEST(release_of_copy_keeps_reference);
+    TEST(lookup_returns_interned_without_reference);
+}
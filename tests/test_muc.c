@@ -0,0 +1,341 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <head-unit.h>
+#include <glib.h>
+
+#include "contact.h"
+#include "muc.h"
+
+static void beforetest(void)
+{
+    muc_join_room("room@conference.server.org", "me");
+}
+
+static void aftertest(void)
+{
+    muc_leave_room("room@conference.server.org");
+}
+
+static void add_new_occupant_returns_updated(void)
+{
+    gboolean updated = muc_add_to_roster("room@conference.server.org", "bob",
+        "online", NULL, NULL, "participant", "none", NULL);
+
+    assert_true(updated);
+    assert_true(muc_nick_in_roster("room@conference.server.org", "bob"));
+}
+
+static void same_presence_not_updated(void)
+{
+    muc_add_to_roster("room@conference.server.org", "bob", "away", "lunch",
+        NULL, NULL, NULL, NULL);
+    PContact before = muc_get_participant("room@conference.server.org", "bob");
+    gboolean updated = muc_add_to_roster("room@conference.server.org", "bob",
+        "away", "lunch", NULL, NULL, NULL, NULL);
+    PContact after = muc_get_participant("room@conference.server.org", "bob");
+
+    assert_false(updated);
+    assert_true(before == after);
+}
+
+static void status_change_updates_in_place(void)
+{
+    muc_add_to_roster("room@conference.server.org", "bob", "online", NULL,
+        NULL, NULL, NULL, NULL);
+    PContact before = muc_get_participant("room@conference.server.org", "bob");
+    gboolean updated = muc_add_to_roster("room@conference.server.org", "bob",
+        "dnd", "busy", NULL, NULL, NULL, NULL);
+    PContact after = muc_get_participant("room@conference.server.org", "bob");
+
+    assert_true(updated);
+    assert_true(before == after);
+    assert_string_equals("dnd", p_contact_presence(after));
+    assert_string_equals("busy", p_contact_status(after));
+}
+
+static void caps_kept_when_not_in_update(void)
+{
+    muc_add_to_roster("room@conference.server.org", "bob", "online", NULL,
+        "caps-key", NULL, NULL, NULL);
+    muc_add_to_roster("room@conference.server.org", "bob", "away", NULL,
+        NULL, NULL, NULL, NULL);
+    PContact bob = muc_get_participant("room@conference.server.org", "bob");
+    Resource *resource = p_contact_get_resource(bob, "bob");
+
+    assert_string_equals("caps-key", resource->caps_str);
+}
+
+static void role_and_affiliation_updated(void)
+{
+    muc_add_to_roster("room@conference.server.org", "bob", "online", NULL,
+        NULL, "participant", "member", NULL);
+    muc_add_to_roster("room@conference.server.org", "bob", "online", NULL,
+        NULL, "moderator", NULL, NULL);
+
+    assert_string_equals("moderator",
+        muc_get_participant_role("room@conference.server.org", "bob"));
+    assert_string_equals("member",
+        muc_get_participant_affiliation("room@conference.server.org", "bob"));
+    assert_is_null(muc_get_participant_role("room@conference.server.org",
+        "dave"));
+}
+
+static void remove_occupant(void)
+{
+    muc_add_to_roster("room@conference.server.org", "bob", "online", NULL,
+        NULL, NULL, NULL, NULL);
+    muc_remove_from_roster("room@conference.server.org", "bob");
+
+    assert_false(muc_nick_in_roster("room@conference.server.org", "bob"));
+    assert_is_null(muc_get_participant("room@conference.server.org", "bob"));
+}
+
+static void roster_sorted_by_nick(void)
+{
+    muc_set_roster_received("room@conference.server.org");
+    muc_add_to_roster("room@conference.server.org", "dave", "online", NULL,
+        NULL, NULL, NULL, NULL);
+    muc_add_to_roster("room@conference.server.org", "bob", "online", NULL,
+        NULL, NULL, NULL, NULL);
+    muc_add_to_roster("room@conference.server.org", "carol", "online", NULL,
+        NULL, NULL, NULL, NULL);
+    muc_remove_from_roster("room@conference.server.org", "carol");
+    muc_add_to_roster("room@conference.server.org", "alice", "online", NULL,
+        NULL, NULL, NULL, NULL);
+
+    GList *roster = muc_get_roster("room@conference.server.org");
+
+    assert_int_equals(3, g_list_length(roster));
+    assert_string_equals("alice", p_contact_barejid(roster->data));
+    assert_string_equals("bob", p_contact_barejid(g_list_nth_data(roster, 1)));
+    assert_string_equals("dave", p_contact_barejid(g_list_nth_data(roster, 2)));
+    g_list_free(roster);
+}
+
+static void roster_indexed_when_received(void)
+{
+    muc_add_to_roster("room@conference.server.org", "dave", "online", NULL,
+        NULL, NULL, NULL, NULL);
+    muc_add_to_roster("room@conference.server.org", "carol", "online", NULL,
+        NULL, NULL, NULL, NULL);
+    muc_add_to_roster("room@conference.server.org", "bob", "online", NULL,
+        NULL, NULL, NULL, NULL);
+    muc_remove_from_roster("room@conference.server.org", "carol");
+
+    assert_is_null(muc_get_roster("room@conference.server.org"));
+
+    muc_set_roster_received("room@conference.server.org");
+    GList *roster = muc_get_roster("room@conference.server.org");
+    Autocomplete nick_ac = muc_get_roster_ac("room@conference.server.org");
+    char *completed = autocomplete_complete(nick_ac, "b");
+
+    assert_int_equals(2, g_list_length(roster));
+    assert_string_equals("bob", p_contact_barejid(roster->data));
+    assert_string_equals("dave", p_contact_barejid(g_list_nth_data(roster, 1)));
+    assert_int_equals(2, autocomplete_length(nick_ac));
+    assert_string_equals("bob", completed);
+    free(completed);
+    g_list_free(roster);
+}
+
+static void digest_counts_messages_and_keeps_recent(void)
+{
+    int i;
+    for (i = 0; i < 8; i++) {
+        char *message = g_strdup_printf("message %d", i);
+        muc_digest_add("room@conference.server.org",
+            (i % 2 == 0) ? "bot" : "bob", message);
+        g_free(message);
+    }
+
+    RoomDigest *digest = muc_take_digest("room@conference.server.org");
+    DigestLine *first = g_queue_peek_head(digest->lines);
+    DigestLine *last = g_queue_peek_tail(digest->lines);
+
+    assert_int_equals(8, digest->total);
+    assert_int_equals(4, GPOINTER_TO_INT(g_hash_table_lookup(digest->counts, "bot")));
+    assert_int_equals(4, GPOINTER_TO_INT(g_hash_table_lookup(digest->counts, "bob")));
+    assert_int_equals(5, g_queue_get_length(digest->lines));
+    assert_string_equals("message 3", first->message);
+    assert_string_equals("bob", last->nick);
+    assert_string_equals("message 7", last->message);
+    assert_true(muc_take_digest("room@conference.server.org") == NULL);
+    muc_digest_free(digest);
+}
+
+static void pending_digest_rooms_only_hold_waiting_digests(void)
+{
+    muc_join_room("other@conference.server.org", "me");
+    assert_is_null(muc_get_pending_digest_rooms());
+
+    muc_digest_add("room@conference.server.org", "bob", "hello");
+    GSList *pending = muc_get_pending_digest_rooms();
+    assert_int_equals(1, g_slist_length(pending));
+    assert_string_equals("room@conference.server.org", pending->data);
+    g_slist_free(pending);
+
+    muc_digest_add("other@conference.server.org", "bob", "hello");
+    muc_leave_room("other@conference.server.org");
+    muc_digest_free(muc_take_digest("room@conference.server.org"));
+    assert_is_null(muc_get_pending_digest_rooms());
+}
+
+static void digest_due_when_mode_switched_off(void)
+{
+    muc_set_digest("room@conference.server.org", TRUE);
+    muc_digest_add("room@conference.server.org", "bot", "hello");
+
+    assert_false(muc_digest_due("room@conference.server.org", 60));
+
+    muc_set_digest("room@conference.server.org", FALSE);
+
+    assert_true(muc_digest_due("room@conference.server.org", 60));
+}
+
+static void occupants_indexed_by_role_and_affiliation(void)
+{
+    muc_add_to_roster("room@conference.server.org", "dave", "online", NULL,
+        NULL, "moderator", "owner", NULL);
+    muc_add_to_roster("room@conference.server.org", "bob", "online", NULL,
+        NULL, "moderator", "member", NULL);
+    muc_add_to_roster("room@conference.server.org", "carol", "online", NULL,
+        NULL, "participant", "member", NULL);
+    muc_add_to_roster("room@conference.server.org", "dave", "online", NULL,
+        NULL, "participant", NULL, NULL);
+    muc_remove_from_roster("room@conference.server.org", "carol");
+
+    GList *moderators = muc_get_occupants_by_role("room@conference.server.org",
+        "moderator");
+    GList *participants = muc_get_occupants_by_role(
+        "room@conference.server.org", "participant");
+    GList *members = muc_get_occupants_by_affiliation(
+        "room@conference.server.org", "member");
+
+    assert_int_equals(1, g_list_length(moderators));
+    assert_string_equals("bob", moderators->data);
+    assert_int_equals(1, g_list_length(participants));
+    assert_string_equals("dave", participants->data);
+    assert_int_equals(1, g_list_length(members));
+    assert_string_equals("bob", members->data);
+    assert_is_null(muc_get_occupants_by_role("room@conference.server.org",
+        "visitor"));
+    g_list_free(moderators);
+    g_list_free(participants);
+    g_list_free(members);
+}
+
+static void occupants_found_by_real_jid_across_rooms(void)
+{
+    muc_join_room("other@conference.server.org", "me");
+    muc_add_to_roster("room@conference.server.org", "bob", "online", NULL,
+        NULL, NULL, NULL, "bob@server.org/laptop");
+    muc_add_to_roster("other@conference.server.org", "bobby", "online", NULL,
+        NULL, NULL, NULL, "bob@server.org/phone");
+    muc_add_to_roster("other@conference.server.org", "carol", "online", NULL,
+        NULL, NULL, NULL, "carol@server.org");
+
+    GList *found = muc_get_occupants_by_real_jid("bob@server.org");
+
+    assert_int_equals(2, g_list_length(found));
+    assert_string_equals("other@conference.server.org/bobby", found->data);
+    assert_string_equals("room@conference.server.org/bob",
+        g_list_nth_data(found, 1));
+    assert_string_equals("bob@server.org",
+        muc_get_participant_real_jid("room@conference.server.org", "bob"));
+    g_list_free_full(found, free);
+
+    muc_leave_room("other@conference.server.org");
+    found = muc_get_occupants_by_real_jid("bob@server.org");
+
+    assert_int_equals(1, g_list_length(found));
+    assert_string_equals("room@conference.server.org/bob", found->data);
+    assert_is_null(muc_get_occupants_by_real_jid("carol@server.org"));
+    g_list_free_full(found, free);
+}
+
+static void lurk_counts_occupants_without_roster(void)
+{
+    muc_add_to_roster("room@conference.server.org", "bob", "online", NULL,
+        NULL, NULL, NULL, NULL);
+    muc_set_lurk("room@conference.server.org", TRUE);
+    gboolean added = muc_add_to_roster("room@conference.server.org", "dave",
+        "online", NULL, NULL, NULL, NULL, NULL);
+
+    assert_true(added);
+    assert_int_equals(2, muc_get_occupant_count("room@conference.server.org"));
+    assert_is_null(muc_get_participant("room@conference.server.org", "bob"));
+
+    muc_remove_from_roster("room@conference.server.org", "bob");
+    muc_remove_from_roster("room@conference.server.org", "dave");
+    muc_remove_from_roster("room@conference.server.org", "dave");
+
+    assert_int_equals(0, muc_get_occupant_count("room@conference.server.org"));
+}
+
+static void lurk_speaker_presence_not_counted(void)
+{
+    muc_set_lurk("room@conference.server.org", TRUE);
+    muc_add_to_roster("room@conference.server.org", "bob", "online", NULL,
+        NULL, NULL, NULL, NULL);
+    muc_add_speaker("room@conference.server.org", "bob");
+    gboolean updated = muc_add_to_roster("room@conference.server.org", "bob",
+        "away", NULL, NULL, NULL, NULL, NULL);
+
+    assert_false(updated);
+    assert_int_equals(1, muc_get_occupant_count("room@conference.server.org"));
+    assert_true(muc_nick_in_roster("room@conference.server.org", "bob"));
+
+    muc_remove_from_roster("room@conference.server.org", "bob");
+
+    assert_int_equals(0, muc_get_occupant_count("room@conference.server.org"));
+    assert_false(muc_nick_in_roster("room@conference.server.org", "bob"));
+    assert_int_equals(0,
+        autocomplete_length(muc_get_roster_ac("room@conference.server.org")));
+}
+
+static void lurk_keeps_recent_speakers(void)
+{
+    muc_set_lurk("room@conference.server.org", TRUE);
+    int i;
+    for (i = 0; i < 150; i++) {
+        char *nick = g_strdup_printf("user%d", i);
+        muc_add_speaker("room@conference.server.org", nick);
+        g_free(nick);
+    }
+    muc_add_speaker("room@conference.server.org", "user60");
+
+    GList *speakers = muc_get_speakers("room@conference.server.org");
+    Autocomplete nick_ac = muc_get_roster_ac("room@conference.server.org");
+
+    assert_int_equals(100, g_list_length(speakers));
+    assert_string_equals("user60", speakers->data);
+    assert_string_equals("user149", g_list_nth_data(speakers, 1));
+    assert_string_equals("user50", g_list_last(speakers)->data);
+    assert_int_equals(100, autocomplete_length(nick_ac));
+    g_list_free(speakers);
+}
+
+void register_muc_tests(void)
+{
+    TEST_MODULE("muc tests");
+    BEFORETEST(beforetest);
+    AFTERTEST(aftertest);
+    TEST(add_new_occupant_returns_updated);
+    TEST(same_presence_not_updated);
+    TEST(status_change_updates_in_place);
+    TEST(caps_kept_when_not_in_update);
+    TEST(role_and_affiliation_updated);
+    TEST(remove_occupant);
+    TEST(roster_sorted_by_nick);
+    TEST(roster_indexed_when_received);
+    TEST(digest_counts_messages_and_keeps_recent);
+    TEST(digest_due_when_mode_switched_off);
+    TEST(pending_digest_rooms_only_hold_waiting_digests);
+    TEST(occupants_indexed_by_role_and_affiliation);
+    TEST(occupants_found_by_real_jid_across_rooms);
+    TEST(lurk_counts_occupants_without_roster);
+    TEST(lurk_speaker_presence_not_counted);
+    TEST(lurk_keeps_recent_speakers);
+}
@@ -0,0 +1,91 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <head-unit.h>
+#include <glib.h>
+
+#include "tools/pool.h"
+
+typedef struct test_object_t {
+    char *name;
+    int value;
+} TestObject;
+
+static void alloc_returns_distinct_objects(void)
+{
+    Pool pool = pool_new(sizeof(TestObject));
+    TestObject *first = pool_alloc(pool);
+    TestObject *second = pool_alloc(pool);
+    first->value = 1;
+    second->value = 2;
+
+    assert_true(first != second);
+    assert_int_equals(1, first->value);
+    assert_int_equals(2, second->value);
+    assert_int_equals(1, pool_slab_count(pool));
+
+    pool_destroy(pool);
+}
+
+static void freed_object_reused(void)
+{
+    Pool pool = pool_new(sizeof(TestObject));
+    TestObject *first = pool_alloc(pool);
+    pool_free(pool, first);
+
+    assert_int_equals(1, pool_free_count(pool));
+
+    TestObject *second = pool_alloc(pool);
+
+    assert_true(first == second);
+    assert_int_equals(0, pool_free_count(pool));
+
+    pool_destroy(pool);
+}
+
+static void churn_does_not_grow_pool(void)
+{
+    Pool pool = pool_new(sizeof(TestObject));
+    TestObject *objects[100];
+    int round;
+    int i;
+    for (round = 0; round < 10; round++) {
+        for (i = 0; i < 100; i++) {
+            objects[i] = pool_alloc(pool);
+            objects[i]->value = i;
+        }
+        for (i = 0; i < 100; i++) {
+            assert_int_equals(i, objects[i]->value);
+            pool_free(pool, objects[i]);
+        }
+    }
+
+    assert_int_equals(2, pool_slab_count(pool));
+    assert_int_equals(100, pool_free_count(pool));
+
+    pool_destroy(pool);
+}
+
+static void small_objects_hold_free_link(void)
+{
+    Pool pool = pool_new(1);
+    char *first = pool_alloc(pool);
+    char *second = pool_alloc(pool);
+    pool_free(pool, first);
+    pool_free(pool, second);
+
+    assert_true(pool_alloc(pool) == second);
+    assert_true(pool_alloc(pool) == first);
+
+    pool_destroy(pool);
+}
+
+void register_pool_tests(void)
+{
+    TEST_MODULE("pool tests");
+    TEST(alloc_returns_distinct_objects);
+    TEST(freed_object_reused);
+    TEST(churn_does_not_grow_pool);
+    TEST(small_objects_hold_free_link);
+}
@@ -0,0 +1,214 @@
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <head-unit.h>
+#include <glib.h>
+
+#include "room_list.h"
+
+#define SERVICE "conference.test.example"
+
+static void beforetest(void)
+{
+    room_list_start(SERVICE);
+}
+
+static void aftertest(void)
+{
+    room_list_clear();
+}
+
+static void _add_page(const char * const jid, const char * const name, ...);
+
+static void new_list_is_empty(void)
+{
+    gint total = 0;
+
+    assert_int_equals(0, room_list_count(SERVICE));
+    assert_is_null(room_list_get_page(SERVICE, NULL, 0, &total));
+    assert_int_equals(0, total);
+}
+
+static void new_list_is_not_fresh(void)
+{
+    assert_false(room_list_is_fresh(SERVICE));
+}
+
+static void pages_added_in_order(void)
+{
+    _add_page("one@" SERVICE, "One", "two@" SERVICE, NULL, NULL);
+    _add_page("three@" SERVICE, "Three", NULL);
+
+    gint total = 0;
+    GList *rooms = room_list_get_page(SERVICE, NULL, 0, &total);
+    DiscoItem *first = g_list_nth_data(rooms, 0);
+    DiscoItem *second = g_list_nth_data(rooms, 1);
+    DiscoItem *third = g_list_nth_data(rooms, 2);
+
+    assert_int_equals(3, room_list_count(SERVICE));
+    assert_int_equals(3, g_list_length(rooms));
+    assert_string_equals("one@" SERVICE, first->jid);
+    assert_string_equals("One", first->name);
+    assert_string_equals("two@" SERVICE, second->jid);
+    assert_is_null(second->name);
+    assert_string_equals("three@" SERVICE, third->jid);
+
+    g_list_free(rooms);
+}
+
+static void start_discards_previous_pages(void)
+{
+    _add_page("one@" SERVICE, "One", NULL);
+    room_list_start(SERVICE);
+
+    assert_int_equals(0, room_list_count(SERVICE));
+}
+
+static void pages_found_by_service_as_typed(void)
+{
+    room_list_start("Conference.Test.Example");
+    _add_page("one@" SERVICE, "One", NULL);
+
+    assert_int_equals(1, room_list_count("Conference.Test.Example"));
+    assert_int_equals(1, room_list_count(SERVICE));
+}
+
+static void search_matches_jid(void)
+{
+    _add_page("linux@" SERVICE, "Penguins", "bsd@" SERVICE, "Daemons", NULL);
+
+    gint total = 0;
+    GList *rooms = room_list_get_page(SERVICE, "linux", 0, &total);
+    DiscoItem *room = rooms->data;
+
+    assert_int_equals(1, g_list_length(rooms));
+    assert_string_equals("linux@" SERVICE, room->jid);
+
+    g_list_free(rooms);
+}
+
+static void search_matches_name_ignoring_case(void)
+{
+    _add_page("linux@" SERVICE, "Penguins", "bsd@" SERVICE, "Daemons", NULL);
+
+    gint total = 0;
+    GList *rooms = room_list_get_page(SERVICE, "DAEMON", 0, &total);
+    DiscoItem *room = rooms->data;
+
+    assert_int_equals(1, g_list_length(rooms));
+    assert_string_equals("bsd@" SERVICE, room->jid);
+
+    g_list_free(rooms);
+}
+
+static void search_returns_matches_in_order(void)
+{
+    _add_page("dev@" SERVICE, NULL, "users@" SERVICE, "Support",
+        "devops@" SERVICE, "Deploys", NULL);
+
+    gint total = 0;
+    GList *rooms = room_list_get_page(SERVICE, "dev", 0, &total);
+    DiscoItem *first = g_list_nth_data(rooms, 0);
+    DiscoItem *second = g_list_nth_data(rooms, 1);
+
+    assert_int_equals(2, g_list_length(rooms));
+    assert_string_equals("dev@" SERVICE, first->jid);
+    assert_string_equals("devops@" SERVICE, second->jid);
+
+    g_list_free(rooms);
+}
+
+static void search_without_match_returns_null(void)
+{
+    _add_page("linux@" SERVICE, "Penguins", NULL);
+
+    gint total = 0;
+
+    assert_is_null(room_list_get_page(SERVICE, "windows", 0, &total));
+    assert_int_equals(0, total);
+}
+
+static void page_holds_its_share_of_rooms(void)
+{
+    int i;
+    for (i = 0; i < 250; i++) {
+        gchar *jid = g_strdup_printf("room%d@" SERVICE, i);
+        _add_page(jid, (i % 2 == 0) ? "Even" : "Odd", NULL);
+        g_free(jid);
+    }
+
+    gint total = 0;
+    GList *rooms = room_list_get_page(SERVICE, NULL, 2, &total);
+    DiscoItem *first = rooms->data;
+
+    assert_int_equals(250, total);
+    assert_int_equals(50, g_list_length(rooms));
+    assert_string_equals("room200@" SERVICE, first->jid);
+    g_list_free(rooms);
+
+    rooms = room_list_get_page(SERVICE, "even", 1, &total);
+    first = rooms->data;
+
+    assert_int_equals(125, total);
+    assert_int_equals(25, g_list_length(rooms));
+    assert_string_equals("room200@" SERVICE, first->jid);
+    g_list_free(rooms);
+}
+
+static void page_past_the_end_is_empty(void)
+{
+    _add_page("linux@" SERVICE, "Penguins", NULL);
+
+    gint total = 0;
+    GList *rooms = room_list_get_page(SERVICE, NULL, 1, &total);
+
+    assert_is_null(rooms);
+    assert_int_equals(1, total);
+}
+
+void register_room_list_tests(void)
+{
+    TEST_MODULE("room_list tests");
+    BEFORETEST(beforetest);
+    AFTERTEST(aftertest);
+    TEST(new_list_is_empty);
+    TEST(new_list_is_not_fresh);
+    TEST(pages_added_in_order);
+    TEST(start_discards_previous_pages);
+    TEST(pages_found_by_service_as_typed);
+    TEST(search_matches_jid);
+    TEST(search_matches_name_ignoring_case);
+    TEST(search_returns_matches_in_order);
+    TEST(search_without_match_returns_null);
+    TEST(page_holds_its_share_of_rooms);
+    TEST(page_past_the_end_is_empty);
+}
+
+/*
+ * Add a page of rooms, given as jid and name pairs ending with a NULL jid
+ */
+static void
+_add_page(const char * const jid, const char * const name, ...)
+{
+    GSList *items = NULL;
+    va_list args;
+    va_start(args, name);
+    const char *curr_jid = jid;
+    const char *curr_name = name;
+    while (curr_jid != NULL) {
+        DiscoItem *item = malloc(sizeof(DiscoItem));
+        item->jid = (char *)curr_jid;
+        item->name = (char *)curr_name;
+        items = g_slist_append(items, item);
+        curr_jid = va_arg(args, const char *);
+        if (curr_jid != NULL) {
+            curr_name = va_arg(args, const char *);
+        }
+    }
+    va_end(args);
+
+    room_list_add(SERVICE, items);
+    g_slist_free_full(items, free);
+}
@@ -6,7 +6,9 @@
 #include <glib.h>
 
 #include "contact.h"
+#include "resource.h"
 #include "xmpp/xmpp.h"
+#include "xmpp/roster.h"
 
 static void beforetest(void)
 {
@@ -160,6 +162,137 @@ static void test_status_when_no_value(void)
     assert_is_null(p_contact_status(james));
 }
 
+static void test_presence_from_highest_priority_resource(void)
+{
+    roster_add("james@server.org", NULL, NULL, NULL, FALSE, TRUE);
+    Resource *laptop = resource_new("laptop", RESOURCE_AWAY, "at lunch", 10, NULL);
+    Resource *phone = resource_new("phone", RESOURCE_CHAT, "on the phone", 5, NULL);
+    roster_update_presence("james@server.org", laptop, NULL);
+    roster_update_presence("james@server.org", phone, NULL);
+    PContact james = roster_get_contact("james@server.org");
+
+    assert_string_equals("away", p_contact_presence(james));
+    assert_string_equals("at lunch", p_contact_status(james));
+    assert_false(p_contact_is_available(james));
+
+    roster_contact_offline("james@server.org", "laptop", NULL);
+
+    assert_string_equals("chat", p_contact_presence(james));
+    assert_string_equals("on the phone", p_contact_status(james));
+    assert_true(p_contact_is_available(james));
+
+    roster_contact_offline("james@server.org", "phone", NULL);
+
+    assert_string_equals("offline", p_contact_presence(james));
+}
+
+static void resources_kept_beyond_inline_limit(void)
+{
+    roster_add("james@server.org", NULL, NULL, NULL, FALSE, TRUE);
+    roster_update_presence("james@server.org",
+        resource_new("laptop", RESOURCE_AWAY, NULL, 0, NULL), NULL);
+    roster_update_presence("james@server.org",
+        resource_new("phone", RESOURCE_XA, NULL, 0, NULL), NULL);
+    roster_update_presence("james@server.org",
+        resource_new("desktop", RESOURCE_CHAT, "at my desk", 0, NULL), NULL);
+    roster_update_presence("james@server.org",
+        resource_new("desktop", RESOURCE_ONLINE, "still here", 0, NULL), NULL);
+    PContact james = roster_get_contact("james@server.org");
+    GList *resources = p_contact_get_available_resources(james);
+
+    assert_int_equals(3, g_list_length(resources));
+    assert_string_equals("online", p_contact_presence(james));
+    assert_string_equals("still here", p_contact_status(james));
+    assert_is_not_null(p_contact_get_resource(james, "laptop"));
+    g_list_free(resources);
+
+    roster_contact_offline("james@server.org", "desktop", NULL);
+    roster_contact_offline("james@server.org", "laptop", NULL);
+
+    assert_string_equals("xa", p_contact_presence(james));
+    assert_is_null(p_contact_get_resource(james, "laptop"));
+
+    roster_contact_offline("james@server.org", "phone", NULL);
+
+    assert_false(p_contact_has_available_resource(james));
+}
+
+static void subscription_stored_as_known_values(void)
+{
+    roster_add("james@server.org", NULL, NULL, "both", FALSE, TRUE);
+    roster_add("bob@server.org", NULL, NULL, NULL, FALSE, TRUE);
+    PContact james = roster_get_contact("james@server.org");
+    PContact bob = roster_get_contact("bob@server.org");
+
+    assert_string_equals("both", p_contact_subscription(james));
+    assert_true(p_contact_subscribed(james));
+    assert_string_equals("none", p_contact_subscription(bob));
+    assert_false(p_contact_subscribed(bob));
+
+    p_contact_set_subscription(bob, "to");
+
+    assert_string_equals("to", p_contact_subscription(bob));
+    assert_true(p_contact_subscribed(bob));
+}
+
+static void contacts_by_presence_sorted_and_counted(void)
+{
+    roster_add("james@server.org", NULL, NULL, NULL, FALSE, TRUE);
+    roster_add("bob@server.org", NULL, NULL, NULL, FALSE, TRUE);
+    roster_add("dave@server.org", NULL, NULL, NULL, FALSE, TRUE);
+    roster_update_presence("james@server.org",
+        resource_new("laptop", RESOURCE_CHAT, NULL, 0, NULL), NULL);
+    roster_update_presence("bob@server.org",
+        resource_new("laptop", RESOURCE_ONLINE, NULL, 0, NULL), NULL);
+
+    GSList *available = roster_get_contacts_by_presence("available");
+    GSList *offline = roster_get_contacts_by_presence("offline");
+
+    assert_int_equals(2, g_slist_length(available));
+    assert_string_equals("bob@server.org", p_contact_barejid(available->data));
+    assert_string_equals("james@server.org",
+        p_contact_barejid(g_slist_next(available)->data));
+    assert_int_equals(1, g_slist_length(offline));
+    assert_string_equals("dave@server.org", p_contact_barejid(offline->data));
+    assert_int_equals(1, roster_count_by_presence("chat"));
+    assert_int_equals(2, roster_count_by_presence("online"));
+    assert_int_equals(3, roster_count_by_presence("any"));
+    g_slist_free(available);
+    g_slist_free(offline);
+}
+
+static void contacts_by_presence_updated_when_offline(void)
+{
+    roster_add("james@server.org", NULL, NULL, NULL, FALSE, TRUE);
+    roster_update_presence("james@server.org",
+        resource_new("laptop", RESOURCE_AWAY, NULL, 0, NULL), NULL);
+
+    assert_int_equals(1, roster_count_by_presence("away"));
+    assert_int_equals(0, roster_count_by_presence("offline"));
+
+    roster_contact_offline("james@server.org", "laptop", NULL);
+
+    assert_int_equals(0, roster_count_by_presence("away"));
+    assert_int_equals(1, roster_count_by_presence("offline"));
+}
+
+static void set_stale_keeps_contacts_offline(void)
+{
+    roster_add("james@server.org", "James", NULL, NULL, FALSE, TRUE);
+    roster_update_presence("james@server.org",
+        resource_new("laptop", RESOURCE_ONLINE, NULL, 0, NULL), NULL);
+    roster_set_stale();
+
+    PContact james = roster_get_contact("james@server.org");
+    char *name = roster_find_contact("Jam");
+
+    assert_string_equals("James", p_contact_name(james));
+    assert_string_equals("offline", p_contact_presence(james));
+    assert_int_equals(1, roster_count_by_presence("offline"));
+    assert_string_equals("James", name);
+    free(name);
+}
+
 static void find_first_exists(void)
 {
     roster_add("James", NULL, NULL, NULL, FALSE, TRUE);
@@ -266,6 +399,194 @@ static void find_twice_returns_first_when_two_match_and_reset(void)
     free(result2);
 }
 
+static void sorted_by_name_when_name_set(void)
+{
+    roster_add("james@server.org", "Zed", NULL, NULL, FALSE, TRUE);
+    roster_add("bob@server.org", "Adam", NULL, NULL, FALSE, TRUE);
+    GSList *list = roster_get_contacts();
+
+    PContact first = list->data;
+    PContact second = (g_slist_next(list))->data;
+
+    assert_string_equals("bob@server.org", p_contact_barejid(first));
+    assert_string_equals("james@server.org", p_contact_barejid(second));
+    g_slist_free(list);
+}
+
+static void resorted_when_name_updated(void)
+{
+    roster_add("james@server.org", "Adam", NULL, NULL, FALSE, TRUE);
+    roster_add("bob@server.org", "Bob", NULL, NULL, FALSE, TRUE);
+    roster_update("james@server.org", "Zed", NULL, NULL, FALSE);
+    GSList *list = roster_get_contacts();
+
+    PContact first = list->data;
+    PContact second = (g_slist_next(list))->data;
+
+    assert_int_equals(2, g_slist_length(list));
+    assert_string_equals("bob@server.org", p_contact_barejid(first));
+    assert_string_equals("james@server.org", p_contact_barejid(second));
+    g_slist_free(list);
+}
+
+static void get_group_returns_sorted_members(void)
+{
+    GSList *groups1 = g_slist_append(NULL, strdup("friends"));
+    GSList *groups2 = g_slist_append(NULL, strdup("friends"));
+    GSList *groups3 = g_slist_append(NULL, strdup("work"));
+    roster_add("james@server.org", "Zed", groups1, NULL, FALSE, TRUE);
+    roster_add("bob@server.org", "Adam", groups2, NULL, FALSE, TRUE);
+    roster_add("dave@server.org", "Dave", groups3, NULL, FALSE, TRUE);
+    GSList *list = roster_get_group("friends");
+
+    PContact first = list->data;
+    PContact second = (g_slist_next(list))->data;
+
+    assert_int_equals(2, g_slist_length(list));
+    assert_string_equals("bob@server.org", p_contact_barejid(first));
+    assert_string_equals("james@server.org", p_contact_barejid(second));
+    g_slist_free(list);
+}
+
+static void get_group_updated_when_groups_change(void)
+{
+    GSList *groups1 = g_slist_append(NULL, strdup("friends"));
+    GSList *groups2 = g_slist_append(NULL, strdup("work"));
+    roster_add("james@server.org", NULL, groups1, NULL, FALSE, TRUE);
+    roster_update("james@server.org", NULL, groups2, NULL, FALSE);
+
+    GSList *friends = roster_get_group("friends");
+    GSList *work = roster_get_group("work");
+    PContact james = roster_get_contact("james@server.org");
+
+    assert_is_null(friends);
+    assert_int_equals(1, g_slist_length(work));
+    assert_true(p_contact_in_group(james, "work"));
+    assert_false(p_contact_in_group(james, "friends"));
+    g_slist_free(work);
+}
+
+static void duplicate_groups_indexed_once(void)
+{
+    GSList *groups = g_slist_append(NULL, strdup("friends"));
+    groups = g_slist_append(groups, strdup("friends"));
+    roster_add("james@server.org", NULL, groups, NULL, FALSE, TRUE);
+
+    PContact james = roster_get_contact("james@server.org");
+    GSList *friends = roster_get_group("friends");
+
+    assert_int_equals(1, g_slist_length(p_contact_groups(james)));
+    assert_int_equals(1, g_slist_length(friends));
+    g_slist_free(friends);
+
+    roster_update("james@server.org", NULL, g_slist_append(NULL, strdup("work")),
+        NULL, FALSE);
+    friends = roster_get_group("friends");
+
+    assert_is_null(friends);
+}
+
+static void groups_listed_after_add_and_update(void)
+{
+    roster_add("james@server.org", NULL, g_slist_append(NULL, strdup("friends")),
+        NULL, FALSE, TRUE);
+    roster_update("bob@server.org", NULL, g_slist_append(NULL, strdup("work")),
+        NULL, FALSE);
+    roster_update("james@server.org", NULL, g_slist_append(NULL,
+        strdup("family")), NULL, FALSE);
+
+    GSList *groups = roster_get_groups();
+    assert_true(g_slist_find_custom(groups, "friends", (GCompareFunc)g_strcmp0) == NULL);
+    assert_true(g_slist_find_custom(groups, "work", (GCompareFunc)g_strcmp0) != NULL);
+    assert_true(g_slist_find_custom(groups, "family", (GCompareFunc)g_strcmp0) != NULL);
+    g_slist_free_full(groups, g_free);
+}
+
+static void group_kept_when_only_member_renamed(void)
+{
+    roster_add("james@server.org", NULL, g_slist_append(NULL, strdup("friends")),
+        NULL, FALSE, TRUE);
+    roster_change_name("james@server.org", "Jim");
+
+    GSList *groups = roster_get_groups();
+    GSList *friends = roster_get_group("friends");
+
+    assert_int_equals(1, g_slist_length(groups));
+    assert_string_equals("friends", groups->data);
+    assert_int_equals(1, g_slist_length(friends));
+
+    g_slist_free_full(groups, g_free);
+    g_slist_free(friends);
+}
+
+static void bulk_add_completes_after_end(void)
+{
+    GSList *groups = g_slist_append(NULL, strdup("friends"));
+    roster_bulk_add_start();
+    roster_add("james@server.org", "James", groups, NULL, FALSE, TRUE);
+    roster_add("bob@server.org", NULL, NULL, NULL, FALSE, TRUE);
+    roster_bulk_add_end();
+
+    char *name = roster_find_contact("Jam");
+    char *barejid = roster_find_jid("bob");
+    GSList *group_list = roster_get_groups();
+
+    assert_string_equals("James", name);
+    assert_string_equals("bob@server.org", barejid);
+    assert_string_equals("bob@server.org", roster_barejid_from_name("bob@server.org"));
+    assert_int_equals(1, g_slist_length(group_list));
+    assert_string_equals("friends", group_list->data);
+    free(name);
+    free(barejid);
+    g_slist_free_full(group_list, free);
+}
+
+static void contacts_matching_jid_or_name(void)
+{
+    roster_add("james@work.org", NULL, NULL, NULL, FALSE, TRUE);
+    roster_add("bob@home.org", "Bob", NULL, NULL, FALSE, TRUE);
+    roster_add("dave@work.org", "Dave", NULL, NULL, FALSE, TRUE);
+
+    GSList *work = roster_get_contacts_matching("*@work.org");
+    GSList *named = roster_get_contacts_matching("?o?");
+    GSList *none = roster_get_contacts_matching("*@other.org");
+
+    assert_int_equals(2, g_slist_length(work));
+    assert_string_equals("dave@work.org", p_contact_barejid(work->data));
+    assert_string_equals("james@work.org",
+        p_contact_barejid(g_slist_next(work)->data));
+    assert_int_equals(1, g_slist_length(named));
+    assert_string_equals("bob@home.org", p_contact_barejid(named->data));
+    assert_is_null(none);
+    g_slist_free(work);
+    g_slist_free(named);
+}
+
+static void pending_out_tracked_on_update(void)
+{
+    roster_add("james@server.org", NULL, NULL, NULL, TRUE, TRUE);
+    roster_add("bob@server.org", NULL, NULL, NULL, FALSE, TRUE);
+
+    GSList *pending = roster_get_pending_out();
+
+    assert_true(roster_has_pending_subscriptions());
+    assert_int_equals(1, g_slist_length(pending));
+    assert_string_equals("james@server.org", p_contact_barejid(pending->data));
+    g_slist_free(pending);
+
+    roster_update("james@server.org", NULL, NULL, "to", FALSE);
+    roster_update("bob@server.org", "Bob", NULL, NULL, TRUE);
+    pending = roster_get_pending_out();
+
+    assert_int_equals(1, g_slist_length(pending));
+    assert_string_equals("bob@server.org", p_contact_barejid(pending->data));
+    g_slist_free(pending);
+
+    roster_update("bob@server.org", "Bob", NULL, "to", FALSE);
+
+    assert_false(roster_has_pending_subscriptions());
+}
+
 void register_roster_tests(void)
 {
     TEST_MODULE("roster tests");
@@ -283,6 +604,12 @@ void register_roster_tests(void)
     TEST(add_twice_at_end_adds_once);
     TEST(test_show_online_when_no_value);
     TEST(test_status_when_no_value);
+    TEST(test_presence_from_highest_priority_resource);
+    TEST(resources_kept_beyond_inline_limit);
+    TEST(subscription_stored_as_known_values);
+    TEST(contacts_by_presence_sorted_and_counted);
+    TEST(contacts_by_presence_updated_when_offline);
+    TEST(set_stale_keeps_contacts_offline);
     TEST(find_first_exists);
     TEST(find_second_exists);
     TEST(find_third_exists);
@@ -291,4 +618,14 @@ void register_roster_tests(void)
     TEST(find_twice_returns_second_when_two_match);
     TEST(find_twice_returns_first_when_two_match_and_reset);
     TEST(find_five_times_finds_fifth);
+    TEST(sorted_by_name_when_name_set);
+    TEST(resorted_when_name_updated);
+    TEST(get_group_returns_sorted_members);
+    TEST(get_group_updated_when_groups_change);
+    TEST(duplicate_groups_indexed_once);
+    TEST(groups_listed_after_add_and_update);
+    TEST(group_kept_when_only_member_renamed);
+    TEST(bulk_add_completes_after_end);
+    TEST(contacts_matching_jid_or_name);
+    TEST(pending_out_tracked_on_update);
 }
@@ -9,6 +9,12 @@ int main(void)
     register_autocomplete_tests();
     register_parser_tests();
     register_jid_tests();
+    register_history_index_tests();
+    register_intern_tests();
+    register_muc_tests();
+    register_highlight_tests();
+    register_room_list_tests();
+    register_pool_tests();
     run_suite();
     return 0;
 }
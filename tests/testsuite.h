@@ -7,5 +7,11 @@ void register_common_tests(void);
 void register_autocomplete_tests(void);
 void register_parser_tests(void);
 void register_jid_tests(void);
+void register_history_index_tests(void);
+void register_intern_tests(void);
+void register_pool_tests(void);
+void register_muc_tests(void);
+void register_highlight_tests(void);
+void register_room_list_tests(void);
 
 #endif